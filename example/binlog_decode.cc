@@ -0,0 +1,309 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * 二进制日志解码工具  把BinaryLogger写出的文件还原成与Logger相同格式的文本
+ *
+ * 用法: ./binlog_decode <binlog文件> [-v]
+ *   -v 在每行末尾附加 tid 和 源文件:行号
+ */
+
+namespace
+{
+
+struct Format
+{
+    int level;
+    int line;
+    std::string file;
+    std::string fmt;
+};
+
+// 一个已解码的参数
+struct Arg
+{
+    char type;       // 'i' 'd' 'p' 's'
+    int64_t i;
+    double d;
+    std::string s;
+};
+
+const char* levelName(int level)
+{
+    static const char* names[] = { "[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]" };
+    return level >= 0 && level < 4 ? names[level] : "";
+}
+
+// 读取定长字段
+template <typename T>
+bool readValue(const char*& p, const char* end, T* value)
+{
+    if (end - p < static_cast<ptrdiff_t>(sizeof(T)))
+    {
+        return false;
+    }
+    ::memcpy(value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool decodeArgs(const char* p, const char* end, std::vector<Arg>* args)
+{
+    while (p < end)
+    {
+        Arg arg;
+        arg.type = *p++;
+        arg.i = 0;
+        arg.d = 0;
+        switch (arg.type)
+        {
+        case 'i':
+        case 'p':
+            if (!readValue(p, end, &arg.i)) return false;
+            break;
+        case 'd':
+            if (!readValue(p, end, &arg.d)) return false;
+            break;
+        case 's':
+        {
+            uint32_t len = 0;
+            if (!readValue(p, end, &len) || end - p < static_cast<ptrdiff_t>(len)) return false;
+            arg.s.assign(p, len);
+            p += len;
+            break;
+        }
+        default:
+            return false;
+        }
+        args->push_back(std::move(arg));
+    }
+    return true;
+}
+
+// 按printf格式串把参数渲染成文本  每个转换说明单独交给snprintf
+std::string render(const std::string& fmt, const std::vector<Arg>& args)
+{
+    std::string out;
+    size_t next = 0; // 下一个参数
+    char buf[4096];
+
+    for (size_t i = 0; i < fmt.size(); )
+    {
+        if (fmt[i] != '%')
+        {
+            out.push_back(fmt[i++]);
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%')
+        {
+            out.push_back('%');
+            i += 2;
+            continue;
+        }
+
+        // 解析 %[flags][width][.precision][length]conversion  去掉length，按记录的类型重新指定
+        std::string spec = "%";
+        int stars[2];
+        int starCount = 0;
+        size_t j = i + 1;
+        while (j < fmt.size() && strchr("-+ #0", fmt[j])) spec.push_back(fmt[j++]);
+        for (int part = 0; part < 2; ++part)
+        {
+            if (part == 1)
+            {
+                if (j >= fmt.size() || fmt[j] != '.') break;
+                spec.push_back(fmt[j++]);
+            }
+            if (j < fmt.size() && fmt[j] == '*')
+            {
+                spec.push_back(fmt[j++]);
+                stars[starCount++] = next < args.size() ? static_cast<int>(args[next++].i) : 0;
+            }
+            while (j < fmt.size() && fmt[j] >= '0' && fmt[j] <= '9') spec.push_back(fmt[j++]);
+        }
+        while (j < fmt.size() && strchr("hlLqjzt", fmt[j])) ++j;
+        if (j >= fmt.size())
+        {
+            break;
+        }
+        char conv = fmt[j];
+        i = j + 1;
+
+        if (next >= args.size())
+        {
+            out += "<missing>";
+            continue;
+        }
+        const Arg& arg = args[next++];
+
+        int n = 0;
+        switch (conv)
+        {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            spec += "ll";
+            spec.push_back(conv);
+            if (starCount == 0) n = snprintf(buf, sizeof buf, spec.c_str(), static_cast<long long>(arg.i));
+            else if (starCount == 1) n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], static_cast<long long>(arg.i));
+            else n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], stars[1], static_cast<long long>(arg.i));
+            break;
+        case 'c':
+            spec.push_back(conv);
+            n = snprintf(buf, sizeof buf, spec.c_str(), static_cast<int>(arg.i));
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec.push_back(conv);
+            if (starCount == 0) n = snprintf(buf, sizeof buf, spec.c_str(), arg.type == 'd' ? arg.d : static_cast<double>(arg.i));
+            else if (starCount == 1) n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], arg.type == 'd' ? arg.d : static_cast<double>(arg.i));
+            else n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], stars[1], arg.type == 'd' ? arg.d : static_cast<double>(arg.i));
+            break;
+        case 's':
+            spec.push_back(conv);
+            if (starCount == 0) n = snprintf(buf, sizeof buf, spec.c_str(), arg.s.c_str());
+            else if (starCount == 1) n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], arg.s.c_str());
+            else n = snprintf(buf, sizeof buf, spec.c_str(), stars[0], stars[1], arg.s.c_str());
+            break;
+        case 'p':
+            n = snprintf(buf, sizeof buf, "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(arg.i)));
+            break;
+        default:
+            n = 0;
+            break;
+        }
+        if (n > 0)
+        {
+            out.append(buf, static_cast<size_t>(n) < sizeof buf ? n : sizeof buf - 1);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <binlog file> [-v]\n", argv[0]);
+        return 1;
+    }
+    bool verbose = argc > 2 && strcmp(argv[2], "-v") == 0;
+
+    FILE* fp = ::fopen(argv[1], "rb");
+    if (fp == nullptr)
+    {
+        perror("fopen");
+        return 1;
+    }
+    std::string data;
+    char chunk[65536];
+    size_t n;
+    while ((n = ::fread(chunk, 1, sizeof chunk, fp)) > 0)
+    {
+        data.append(chunk, n);
+    }
+    ::fclose(fp);
+
+    if (data.compare(0, 8, "MUBLOG01") != 0)
+    {
+        fprintf(stderr, "%s: not a binary log file\n", argv[1]);
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, Format> formats;
+    const char* p = data.data() + 8;
+    const char* end = data.data() + data.size();
+    size_t records = 0;
+    std::vector<Arg> args;
+
+    while (p < end)
+    {
+        char type = *p++;
+        if (type == 'F')
+        {
+            uint32_t id, fileLen, fmtLen;
+            int32_t level, line;
+            Format format;
+            if (!readValue(p, end, &id) || !readValue(p, end, &level) || !readValue(p, end, &line)
+                || !readValue(p, end, &fileLen) || end - p < static_cast<ptrdiff_t>(fileLen))
+            {
+                break;
+            }
+            format.file.assign(p, fileLen);
+            p += fileLen;
+            if (!readValue(p, end, &fmtLen) || end - p < static_cast<ptrdiff_t>(fmtLen))
+            {
+                break;
+            }
+            format.fmt.assign(p, fmtLen);
+            p += fmtLen;
+            format.level = level;
+            format.line = line;
+            formats[id] = std::move(format);
+        }
+        else if (type == 'R')
+        {
+            const char* start = p;
+            uint32_t len, id;
+            int64_t usec;
+            int32_t tid;
+            if (!readValue(p, end, &len) || len < 20 || end - start < static_cast<ptrdiff_t>(len)
+                || !readValue(p, end, &id) || !readValue(p, end, &usec) || !readValue(p, end, &tid))
+            {
+                break;
+            }
+            const char* recordEnd = start + len;
+            args.clear();
+            bool ok = decodeArgs(p, recordEnd, &args);
+            p = recordEnd;
+
+            auto it = formats.find(id);
+            if (it == formats.end() || !ok)
+            {
+                fprintf(stderr, "bad record (format id %u)\n", id);
+                continue;
+            }
+            const Format& format = it->second;
+
+            // 时间格式与Logger一致 (精确到微秒)
+            time_t seconds = static_cast<time_t>(usec / 1000000);
+            struct tm tmTime;
+            ::localtime_r(&seconds, &tmTime);
+            char timebuf[64];
+            snprintf(timebuf, sizeof timebuf, "%4d%02d%02d %02d:%02d:%02d.%06d",
+                     tmTime.tm_year + 1900, tmTime.tm_mon + 1, tmTime.tm_mday,
+                     tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec, static_cast<int>(usec % 1000000));
+
+            std::string msg = render(format.fmt, args);
+            if (!msg.empty() && msg[msg.size() - 1] == '\n')
+            {
+                msg.resize(msg.size() - 1);
+            }
+            if (verbose)
+            {
+                printf("%s%s : %s  [tid=%d %s:%d]\n", levelName(format.level), timebuf, msg.c_str(),
+                       tid, format.file.c_str(), format.line);
+            }
+            else
+            {
+                printf("%s%s : %s\n", levelName(format.level), timebuf, msg.c_str());
+            }
+            ++records;
+        }
+        else
+        {
+            fprintf(stderr, "corrupted file at offset %ld\n", static_cast<long>(p - 1 - data.data()));
+            break;
+        }
+    }
+
+    fprintf(stderr, "%lu records, %lu formats\n", static_cast<unsigned long>(records),
+            static_cast<unsigned long>(formats.size()));
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "LengthHeaderCodec.h"
+#include "Crc32c.h"
+#include "Logger.h"
+
+/**
+ * LengthHeaderCodec / CRC32C 压测
+ *
+ * 用法: ./codec_bench [帧大小] [秒数] [checksum 0/1] [在途帧数]
+ *   1. CRC32C吞吐 (本机是否使用SSE4.2)
+ *   2. 回环回显: 客户端保持若干帧在途，服务端用codec解帧后原样send回去 (帧数据不拷贝)
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19100;
+
+static void benchCrc()
+{
+    const char check[] = "123456789";
+    fprintf(stderr, "crc32c(\"123456789\") = %08x (expect e3069283), sse4.2: %s\n",
+            Crc32c::value(check, 9), Crc32c::hardwareAccelerated() ? "yes" : "no");
+
+    std::string data(1024 * 1024, 'x');
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>(i * 131);
+    }
+    const int rounds = 2000;
+    uint32_t crc = 0;
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        crc = Crc32c::extend(crc, data.data(), data.size());
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    fprintf(stderr, "crc32c: %.2f GB/s (%08x)\n", rounds * data.size() / seconds / 1e9, crc);
+}
+
+
+class EchoClient
+{
+public:
+    EchoClient(EventLoop* loop, size_t frameSize, bool checksum, int window)
+        : client_(loop, InetAddress(kPort), "codec_bench")
+        , codec_(std::bind(&EchoClient::onFrame, this, std::placeholders::_1,
+                           std::placeholders::_2, std::placeholders::_3), checksum)
+        , payload_(frameSize, 'p')
+        , window_(window)
+        , frames_(0)
+        , running_(true)
+    {
+        client_.setConnectionCallback(std::bind(&EchoClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+    long frames() const { return frames_; }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            for (int i = 0; i < window_; ++i)
+            {
+                codec_.send(conn, payload_);
+            }
+        }
+    }
+
+    void onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp)
+    {
+        if (frame.size() != payload_.size())
+        {
+            fprintf(stderr, "bad frame size %zu\n", frame.size());
+        }
+        ++frames_;
+        if (running_)
+        {
+            codec_.send(conn, payload_);
+        }
+    }
+
+    TcpClient client_;
+    LengthHeaderCodec codec_;
+    const std::string payload_;
+    const int window_;
+    long frames_;
+    bool running_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    size_t frameSize = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 256;
+    double seconds = argc > 2 ? atof(argv[2]) : 3.0;
+    bool checksum = argc > 3 ? atoi(argv[3]) != 0 : true;
+    int window = argc > 4 ? atoi(argv[4]) : 64;
+
+    benchCrc();
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    TcpServer server(serverLoop, InetAddress(kPort), "codec_bench");
+    LengthHeaderCodec serverCodec(
+        [&serverCodec](const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp) {
+            serverCodec.send(conn, frame); // 帧直接指向输入缓冲区 原样sendv回去
+        },
+        checksum);
+    server.setConnectionCallback([](const TcpConnectionPtr&) { });
+    server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &serverCodec, std::placeholders::_1,
+                                        std::placeholders::_2, std::placeholders::_3));
+    server.start();
+
+    EventLoop loop;
+    EchoClient client(&loop, frameSize, checksum, window);
+    Timestamp start;
+    loop.runAfter(0.1, [&]() { // 等服务端开始监听
+        start = Timestamp::now();
+        client.start();
+    });
+    loop.runAfter(0.1 + seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        client.stop();
+        fprintf(stderr, "echo: frame %zu bytes, checksum %s, window %d: %.0f frames/s, %.1f MB/s\n",
+                frameSize, checksum ? "on" : "off", window,
+                client.frames() / elapsed, client.frames() * frameSize / elapsed / 1e6);
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "TcpServer.h"
+#include "Logger.h"
+
+/**
+ * 热路径日志开销压测：echo服务器 + 多个ping-pong客户端
+ * EPollPoller::poll / Channel::handleEventWithGuard 每轮循环、每个事件都有LOG_DEBUG
+ *
+ * 用法: ./echo_log_bench [debug 0/1] [连接数] [消息字节数] [秒数] > /dev/null
+ *   ./echo_log_bench 0 > /dev/null   运行期级别INFO 热路径日志在格式化前被过滤
+ *   ./echo_log_bench 1 > /dev/null   运行期级别DEBUG 热路径日志全部格式化并输出
+ * 用 -DMUDUO_MIN_LOG_LEVEL=1 编译库时，LOG_DEBUG在编译期被去掉，两种模式结果相同
+ * 结果输出到stderr (stdout为日志)
+ */
+
+
+class EchoServer
+{
+public:
+    EchoServer(EventLoop* loop, const InetAddress& addr)
+        : server_(loop, addr, "EchoServer")
+    {
+        server_.setConnectionCallback([](const TcpConnectionPtr&) { });
+        server_.setMessageCallback(
+            std::bind(&EchoServer::onMessage, this,
+                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        server_.setThreadNum(2);
+    }
+
+    void start() { server_.start(); }
+
+private:
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp time)
+    {
+        conn->send(buf->retrieveAllAsString());
+    }
+
+    TcpServer server_;
+};
+
+
+// 客户端线程：阻塞socket 发一条消息，收回完整的回显后再发下一条
+static void clientThread(uint16_t port, size_t msgSize, std::atomic_bool* stop, std::atomic_long* completed)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        return;
+    }
+
+    std::string msg(msgSize, 'x');
+    std::vector<char> resp(msgSize);
+    long count = 0;
+    while (!*stop)
+    {
+        if (::write(fd, msg.data(), msg.size()) != static_cast<ssize_t>(msg.size()))
+        {
+            break;
+        }
+        size_t got = 0;
+        while (got < resp.size())
+        {
+            ssize_t n = ::read(fd, &resp[got], resp.size() - got);
+            if (n <= 0)
+            {
+                ::close(fd);
+                *completed += count;
+                return;
+            }
+            got += n;
+        }
+        ++count;
+    }
+    *completed += count;
+    ::close(fd);
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool debug     = argc > 1 ? atoi(argv[1]) != 0 : false;
+    int conns      = argc > 2 ? atoi(argv[2]) : 8;
+    size_t msgSize = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 64;
+    int seconds    = argc > 4 ? atoi(argv[4]) : 5;
+    const uint16_t port = 9982;
+
+    Logger::setLogLevel(debug ? DEBUG : INFO);
+
+    EventLoop loop;
+    EchoServer server(&loop, InetAddress(port));
+    server.start();
+
+    std::atomic_bool stop(false);
+    std::atomic_long completed(0);
+    std::thread driver([&]() {
+        ::usleep(100 * 1000); // 等待服务端开始监听
+        std::vector<std::thread> clients;
+        for (int i = 0; i < conns; ++i)
+        {
+            clients.emplace_back(clientThread, port, msgSize, &stop, &completed);
+        }
+        auto start = std::chrono::steady_clock::now();
+        ::sleep(seconds);
+        stop = true;
+        for (std::thread& t : clients)
+        {
+            t.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "log level=%s conns=%d msg=%lu: %.0f round trips/s\n",
+                debug ? "DEBUG" : "INFO", conns, msgSize, completed / elapsed);
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * HTTP压测 (类似wrk，回环)  服务端在另一个IO线程中
+ *
+ * 用法: ./http_bench [连接数] [流水线深度] [秒数] [服务端IO线程数]
+ *       ./http_bench server [端口] [IO线程数]     只启动服务端 用外部wrk/ab压测
+ *   每个连接保持"流水线深度"个请求在途，收到一个应答就补发一个
+ *   GET /hello 返回固定短文本；POST /echo 原样返回body (支持chunked)
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 18080;
+static const char kHello[] = "Hello, World!\n";
+
+static void onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+    if (req.path() == "/hello")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBodyPiece(StringPiece(kHello, sizeof kHello - 1)); // 静态内容 不拷贝
+    }
+    else if (req.path() == "/echo" && req.method() == HttpRequest::kPost)
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("application/octet-stream");
+        resp->mutableBody()->assign(req.body().data(), req.body().size());
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setCloseConnection(true);
+    }
+}
+
+
+class BenchClient
+{
+public:
+    BenchClient(EventLoop* loop, int id, int depth, const std::string& request)
+        : client_(loop, InetAddress(kPort), "http_bench" + std::to_string(id))
+        , depth_(depth)
+        , request_(request)
+        , completed_(0)
+        , running_(true)
+    {
+        client_.setConnectionCallback(std::bind(&BenchClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&BenchClient::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+    long completed() const { return completed_; }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            std::string batch;
+            for (int i = 0; i < depth_; ++i)
+            {
+                batch += request_;
+            }
+            conn->send(batch);
+        }
+        else if (running_)
+        {
+            fprintf(stderr, "connection closed by server\n");
+        }
+    }
+
+    // 按Content-Length切分应答  每收完一个就补发一个请求
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        int done = 0;
+        for (;;)
+        {
+            const char* begin = buf->peek();
+            size_t readable = buf->readableBytes();
+            const char* end = static_cast<const char*>(::memmem(begin, readable, "\r\n\r\n", 4));
+            if (end == nullptr)
+            {
+                break;
+            }
+            const char* length = static_cast<const char*>(::memmem(begin, end - begin, "Content-Length: ", 16));
+            size_t total = end + 4 - begin + (length ? static_cast<size_t>(atol(length + 16)) : 0);
+            if (readable < total)
+            {
+                break;
+            }
+            buf->retrieve(total);
+            ++done;
+        }
+        completed_ += done;
+        if (running_ && done > 0)
+        {
+            std::string batch;
+            for (int i = 0; i < done; ++i)
+            {
+                batch += request_;
+            }
+            conn->send(batch);
+        }
+    }
+
+    TcpClient client_;
+    const int depth_;
+    const std::string request_;
+    long completed_;
+    bool running_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "server") == 0)
+    {
+        uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : kPort);
+        EventLoop loop;
+        HttpServer server(&loop, InetAddress(port), "http_bench");
+        server.setHttpCallback(onRequest);
+        server.setThreadNum(argc > 3 ? atoi(argv[3]) : 0);
+        server.start();
+        loop.loop();
+        return 0;
+    }
+
+    int connections = argc > 1 ? atoi(argv[1]) : 10;
+    int depth = argc > 2 ? atoi(argv[2]) : 1;
+    double seconds = argc > 3 ? atof(argv[3]) : 5.0;
+    int threads = argc > 4 ? atoi(argv[4]) : 0;
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    HttpServer server(serverLoop, InetAddress(kPort), "http_bench");
+    server.setHttpCallback(onRequest);
+    server.setThreadNum(threads);
+    server.start();
+
+    EventLoop loop;
+    const std::string request = "GET /hello HTTP/1.1\r\nHost: localhost\r\nUser-Agent: http_bench\r\n\r\n";
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    for (int i = 0; i < connections; ++i)
+    {
+        clients.emplace_back(new BenchClient(&loop, i, depth, request));
+    }
+
+    Timestamp start;
+    loop.runAfter(0.1, [&]() { // 等服务端开始监听
+        start = Timestamp::now();
+        for (auto& c : clients) c->start();
+    });
+    loop.runAfter(0.1 + seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        long total = 0;
+        for (auto& c : clients)
+        {
+            total += c->completed();
+            c->stop();
+        }
+        double qps = total / elapsed;
+        fprintf(stderr, "%d connections, pipeline %d, server threads %d\n", connections, depth, threads);
+        fprintf(stderr, "%ld requests in %.2fs, %.0f req/s, avg latency %.1f us\n",
+                total, elapsed, qps, qps > 0 ? connections * depth / qps * 1e6 : 0.0);
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    return 0;
+}
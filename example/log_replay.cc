@@ -0,0 +1,354 @@
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "SegmentLog.h"
+#include "LengthHeaderCodec.h"
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * 持久化消息流 + 断线重放  基于SegmentLog，消息帧为LengthHeaderCodec(开启校验)
+ *
+ * 客户端 -> 服务端:
+ *   'P' data           发布一条消息，追加到日志
+ *   'S' int64 fromSeq  订阅：从fromSeq开始重放，之后持续推送新消息
+ * 服务端 -> 客户端:
+ *   发布者: 'A' int64 syncedSeq  组提交完成，序号小于syncedSeq的消息已经落盘
+ *   订阅者: 日志中的记录帧原样发出 (sendfile)，payload为 int64 seq + data
+ *
+ * 追赶和实时推送都走sendfile；每个订阅者同时最多有一批在途，发完再追上新写入的记录 (慢订阅者不会堆积)
+ *
+ * 用法: ./log_replay <目录> server [端口]
+ *       ./log_replay <目录> bench [消息数] [消息字节]   在目录下新建临时子目录，先发布再从0重放，结束后删除
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kBenchPort = 19400;
+
+static int64_t readInt64(const char* p)
+{
+    uint64_t be64 = 0;
+    ::memcpy(&be64, p, sizeof be64);
+    return static_cast<int64_t>(be64toh(be64));
+}
+
+static void writeInt64(char* p, int64_t x)
+{
+    uint64_t be64 = htobe64(static_cast<uint64_t>(x));
+    ::memcpy(p, &be64, sizeof be64);
+}
+
+
+class LogServer
+{
+public:
+    LogServer(EventLoop* loop, uint16_t port, const std::string& dir)
+        : server_(loop, InetAddress(port), "log_replay")
+        , log_(loop, dir)
+        , codec_(std::bind(&LogServer::onFrame, this, std::placeholders::_1,
+                           std::placeholders::_2, std::placeholders::_3), true)
+        , syncs_(0)
+    {
+        server_.setConnectionCallback(std::bind(&LogServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        log_.setSyncCallback(std::bind(&LogServer::onSync, this, std::placeholders::_1));
+    }
+
+    // 日志和所有连接都在同一个loop中
+    bool start()
+    {
+        if (!log_.open())
+        {
+            return false;
+        }
+        server_.start();
+        return true;
+    }
+
+    int64_t syncs() const { return syncs_; }
+
+private:
+    struct Subscriber
+    {
+        TcpConnectionPtr conn;
+        int64_t next;  // 下一条要发的记录
+        bool inflight; // 有一批sendfile还没发完
+    };
+
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (!conn->connected())
+        {
+            producers_.erase(conn.get());
+            subscribers_.erase(conn.get());
+        }
+    }
+
+    void onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp)
+    {
+        if (frame.size() >= 1 && frame[0] == 'P')
+        {
+            char seq[8];
+            writeInt64(seq, log_.nextSeq());
+            StringPiece pieces[2] = { StringPiece(seq, sizeof seq), StringPiece(frame.data() + 1, frame.size() - 1) };
+            if (log_.append(pieces, 2) < 0)
+            {
+                conn->shutdown();
+                return;
+            }
+            producers_[conn.get()] = conn;
+        }
+        else if (frame.size() == 9 && frame[0] == 'S')
+        {
+            Subscriber& sub = subscribers_[conn.get()];
+            sub.conn = conn;
+            sub.next = readInt64(frame.data() + 1);
+            sub.inflight = false;
+            pump(&sub);
+        }
+        else
+        {
+            conn->shutdown();
+        }
+    }
+
+    // 把订阅者还没收到的记录用sendfile发出
+    void pump(Subscriber* sub)
+    {
+        if (sub->inflight || sub->next >= log_.nextSeq())
+        {
+            return;
+        }
+        sub->inflight = true;
+        log_.replay(sub->conn, sub->next, std::bind(&LogServer::onReplayDone, this, std::placeholders::_1, std::placeholders::_2));
+        sub->next = log_.nextSeq();
+    }
+
+    void onReplayDone(const TcpConnectionPtr& conn, bool completed)
+    {
+        if (!completed) // 连接已关闭 (订阅者由连接回调移除)
+        {
+            return;
+        }
+        auto it = subscribers_.find(conn.get());
+        if (it != subscribers_.end())
+        {
+            it->second.inflight = false;
+            pump(&it->second);
+        }
+    }
+
+    // 组提交完成: 通知发布者，并把新记录推给订阅者
+    void onSync(int64_t syncedSeq)
+    {
+        ++syncs_;
+        char ack[9];
+        ack[0] = 'A';
+        writeInt64(ack + 1, syncedSeq);
+        for (auto& p : producers_)
+        {
+            codec_.send(p.second, StringPiece(ack, sizeof ack));
+        }
+        for (auto& s : subscribers_)
+        {
+            pump(&s.second);
+        }
+    }
+
+    TcpServer server_;
+    SegmentLog log_;
+    LengthHeaderCodec codec_;
+    std::unordered_map<TcpConnection*, TcpConnectionPtr> producers_;
+    std::unordered_map<TcpConnection*, Subscriber> subscribers_;
+    int64_t syncs_;
+};
+
+
+// 压测客户端: 保持window条未确认的发布；或者从0开始订阅并校验序号
+class BenchClient
+{
+public:
+    BenchClient(EventLoop* loop, bool subscriber, int64_t total, size_t bytes)
+        : client_(loop, InetAddress(kBenchPort), subscriber ? "log_sub" : "log_pub")
+        , codec_(std::bind(&BenchClient::onFrame, this, std::placeholders::_1,
+                           std::placeholders::_2, std::placeholders::_3), true)
+        , subscriber_(subscriber)
+        , total_(total)
+        , message_(1 + bytes, 'x')
+        , sent_(0)
+        , done_(0)
+        , errors_(0)
+    {
+        message_[0] = 'P';
+        client_.setConnectionCallback(std::bind(&BenchClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start(const std::function<void ()>& finished) { finished_ = finished; start_ = Timestamp::now(); client_.connect(); }
+    void stop() { client_.disconnect(); }
+    double seconds() const { return timeDifference(end_, start_); }
+    int64_t errors() const { return errors_; }
+
+private:
+    static const int64_t kWindow = 4096;
+
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        if (subscriber_)
+        {
+            char sub[9];
+            sub[0] = 'S';
+            writeInt64(sub + 1, 0);
+            codec_.send(conn, StringPiece(sub, sizeof sub));
+        }
+        else
+        {
+            publish(conn);
+        }
+    }
+
+    void publish(const TcpConnectionPtr& conn)
+    {
+        while (sent_ < total_ && sent_ - done_ < kWindow)
+        {
+            codec_.send(conn, message_);
+            ++sent_;
+        }
+    }
+
+    void onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp)
+    {
+        if (subscriber_)
+        {
+            if (frame.size() != 8 + message_.size() - 1 || readInt64(frame.data()) != done_)
+            {
+                ++errors_;
+            }
+            ++done_;
+        }
+        else if (frame.size() == 9 && frame[0] == 'A')
+        {
+            done_ = readInt64(frame.data() + 1); // 已落盘的条数
+            publish(conn);
+        }
+        if (done_ == total_ && finished_)
+        {
+            end_ = Timestamp::now();
+            std::function<void ()> cb;
+            cb.swap(finished_);
+            cb();
+        }
+    }
+
+    TcpClient client_;
+    LengthHeaderCodec codec_;
+    const bool subscriber_;
+    const int64_t total_;
+    std::string message_;
+    int64_t sent_;
+    int64_t done_;
+    int64_t errors_;
+    Timestamp start_;
+    Timestamp end_;
+    std::function<void ()> finished_;
+};
+
+
+static void removeDir(const std::string& dir)
+{
+    if (DIR* d = ::opendir(dir.c_str()))
+    {
+        while (struct dirent* entry = ::readdir(d))
+        {
+            if (::strstr(entry->d_name, ".seg"))
+            {
+                ::unlink((dir + "/" + entry->d_name).c_str());
+            }
+        }
+        ::closedir(d);
+    }
+    ::rmdir(dir.c_str());
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <dir> server [port]\n       %s <dir> bench [messages] [bytes]\n", argv[0], argv[0]);
+        return 1;
+    }
+    ::signal(SIGPIPE, SIG_IGN);
+    std::string dir = argv[1];
+
+    if (strcmp(argv[2], "server") == 0)
+    {
+        EventLoop loop;
+        LogServer server(&loop, static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9400), dir);
+        if (!server.start())
+        {
+            return 1;
+        }
+        loop.loop();
+        return 0;
+    }
+
+    int64_t messages = argc > 3 ? atoll(argv[3]) : 1000000;
+    size_t bytes = argc > 4 ? static_cast<size_t>(atol(argv[4])) : 100;
+    std::string benchDir = dir + "/log_replay_bench." + std::to_string(::getpid());
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::unique_ptr<LogServer> server;
+    bool ok = false;
+    serverLoop->runInLoop([&]() {
+        server.reset(new LogServer(serverLoop, kBenchPort, benchDir));
+        ok = server->start();
+    });
+    usleep(100 * 1000);
+    if (!ok)
+    {
+        return 1;
+    }
+
+    EventLoop loop;
+    BenchClient producer(&loop, false, messages, bytes);
+    BenchClient consumer(&loop, true, messages, bytes);
+    double mb = static_cast<double>(messages) * (SegmentLog::kHeaderLen + 8 + bytes) / (1024 * 1024);
+    producer.start([&]() {
+        fprintf(stderr, "append: %lld messages x %zu bytes in %.3fs, %.0f msg/s, %.1f MB/s, %lld group commits\n",
+                static_cast<long long>(messages), bytes, producer.seconds(), messages / producer.seconds(),
+                mb / producer.seconds(), static_cast<long long>(server->syncs()));
+        consumer.start([&]() {
+            fprintf(stderr, "replay: %.3fs, %.0f msg/s, %.1f MB/s (sendfile), sequence errors %lld\n",
+                    consumer.seconds(), messages / consumer.seconds(), mb / consumer.seconds(),
+                    static_cast<long long>(consumer.errors()));
+            producer.stop();
+            consumer.stop();
+            loop.runAfter(0.1, [&]() { loop.quit(); });
+        });
+    });
+    loop.loop();
+
+    serverLoop->runInLoop([&]() { server.reset(); });
+    usleep(100 * 1000);
+    removeDir(benchDir);
+    return 0;
+}
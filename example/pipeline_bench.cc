@@ -0,0 +1,162 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "TcpServer.h"
+#include "Logger.h"
+
+/**
+ * 写合并(延迟flush)压测：流水线请求，每个请求服务端调用5次send拼出响应
+ *
+ * 用法: ./pipeline_bench [deferred 0/1] [cork 0/1] [连接数] [流水线深度] [秒数]
+ *   ./pipeline_bench 0 > /dev/null   每次send直接write
+ *   ./pipeline_bench 1 > /dev/null   每轮循环每个连接flush一次
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const char kRequest[] = "PING\n";            // 5字节请求
+static const size_t kRequestLen = sizeof(kRequest) - 1;
+static const size_t kResponseLen = 10;              // "+" "PONG" " " "ok" "\r\n"
+
+
+class PipelineServer
+{
+public:
+    PipelineServer(EventLoop* loop, const InetAddress& addr, bool deferred, bool cork)
+        : server_(loop, addr, "PipelineServer")
+        , deferred_(deferred)
+        , cork_(cork)
+    {
+        server_.setConnectionCallback(
+            std::bind(&PipelineServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(
+            std::bind(&PipelineServer::onMessage, this,
+                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        server_.setThreadNum(2);
+    }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            conn->setDeferredFlush(deferred_, cork_);
+        }
+    }
+
+    // 一次可能收到多个流水线请求 每个请求分5次send回复
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp time)
+    {
+        static const std::string parts[] = { "+", "PONG", " ", "ok", "\r\n" };
+        size_t requests = buf->readableBytes() / kRequestLen;
+        for (size_t i = 0; i < requests; ++i)
+        {
+            for (const std::string& part : parts)
+            {
+                conn->send(part);
+            }
+        }
+        buf->retrieve(requests * kRequestLen);
+    }
+
+    TcpServer server_;
+    bool deferred_;
+    bool cork_;
+};
+
+
+// 客户端线程：阻塞socket 每次写depth个请求，再读回depth个响应
+static void clientThread(uint16_t port, int depth, std::atomic_bool* stop, std::atomic_long* completed)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        return;
+    }
+
+    std::string batch;
+    for (int i = 0; i < depth; ++i)
+    {
+        batch += kRequest;
+    }
+    std::vector<char> resp(kResponseLen * depth);
+
+    while (!*stop)
+    {
+        if (::write(fd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size()))
+        {
+            break;
+        }
+        size_t got = 0;
+        while (got < resp.size())
+        {
+            ssize_t n = ::read(fd, &resp[got], resp.size() - got);
+            if (n <= 0)
+            {
+                ::close(fd);
+                return;
+            }
+            got += n;
+        }
+        *completed += depth;
+    }
+    ::close(fd);
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool deferred = argc > 1 ? atoi(argv[1]) != 0 : true;
+    bool cork     = argc > 2 ? atoi(argv[2]) != 0 : false;
+    int conns     = argc > 3 ? atoi(argv[3]) : 8;
+    int depth     = argc > 4 ? atoi(argv[4]) : 32;
+    int seconds   = argc > 5 ? atoi(argv[5]) : 5;
+    const uint16_t port = 9981;
+
+    EventLoop loop;
+    PipelineServer server(&loop, InetAddress(port), deferred, cork);
+    server.start();
+
+    std::atomic_bool stop(false);
+    std::atomic_long completed(0);
+    std::thread driver([&]() {
+        ::usleep(100 * 1000); // 等待服务端开始监听
+        std::vector<std::thread> clients;
+        for (int i = 0; i < conns; ++i)
+        {
+            clients.emplace_back(clientThread, port, depth, &stop, &completed);
+        }
+        auto start = std::chrono::steady_clock::now();
+        ::sleep(seconds);
+        stop = true;
+        for (std::thread& t : clients)
+        {
+            t.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "deferred=%d cork=%d conns=%d depth=%d: %.0f requests/s\n",
+                deferred, cork, conns, depth, completed / elapsed);
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
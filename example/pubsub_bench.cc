@@ -0,0 +1,189 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "PubSubServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * 发布/订阅扇出压测 (回环)  服务端在另一个线程中，有若干IO线程
+ *
+ * 用法: ./pubsub_bench [订阅者数] [消息字节] [秒数] [服务端IO线程数] [积压上限KB]
+ *   一个发布者连接不停地发布到主题bench (每次写完成后再发一批)，订阅者统计收到的消息数
+ *   另有一个订阅后不再读数据的慢订阅者，积压超过上限后应当被服务端断开 (结束时恢复读以确认)
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19300;
+static const char* const kTopic = "bench";
+
+class Subscriber
+{
+public:
+    Subscriber(EventLoop* loop, int id, size_t messageBytes, bool slow)
+        : client_(loop, InetAddress(kPort), "pubsub_sub" + std::to_string(id))
+        , messageBytes_(messageBytes)
+        , slow_(slow)
+        , connected_(false)
+        , dropped_(false)
+        , bytes_(0)
+    {
+        client_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+            if (conn->connected())
+            {
+                connected_ = true;
+                conn->send(std::string("sub ") + kTopic + "\r\n");
+                if (slow_)
+                {
+                    conn->stopRead(); // 只订阅不读 服务端的积压不断增长
+                }
+            }
+            else if (connected_)
+            {
+                dropped_ = true;
+            }
+        });
+        client_.setMessageCallback([this](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+            bytes_ += buf->readableBytes();
+            buf->retrieveAll();
+        });
+    }
+
+    void start() { client_.connect(); }
+    void stop() { client_.disconnect(); }
+    void resume() // 恢复读 读到EOF才知道自己被断开了
+    {
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->startRead();
+        }
+    }
+
+    long messages() const { return static_cast<long>(bytes_ / messageBytes_); }
+    bool dropped() const { return dropped_; }
+
+private:
+    TcpClient client_;
+    const size_t messageBytes_; // 订阅者收到的每条消息的字节数
+    const bool slow_;
+    bool connected_;
+    bool dropped_;
+    size_t bytes_;
+};
+
+
+class Publisher
+{
+public:
+    Publisher(EventLoop* loop, const std::string& content)
+        : client_(loop, InetAddress(kPort), "pubsub_pub")
+        , running_(true)
+        , sent_(0)
+    {
+        for (int i = 0; i < kBatch; ++i)
+        {
+            batch_ += std::string("pub ") + kTopic + "\r\n" + content + "\r\n";
+        }
+        client_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+            if (conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                publish(conn);
+            }
+        });
+        client_.setWriteCompleteCallback([this](const TcpConnectionPtr& conn) { publish(conn); });
+    }
+
+    void start() { client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+    long sent() const { return sent_; }
+
+private:
+    static const int kBatch = 64;
+
+    void publish(const TcpConnectionPtr& conn)
+    {
+        if (running_)
+        {
+            conn->send(batch_);
+            sent_ += kBatch;
+        }
+    }
+
+    TcpClient client_;
+    std::string batch_;
+    bool running_;
+    long sent_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    int subscribers = argc > 1 ? atoi(argv[1]) : 100;
+    size_t messageSize = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 64;
+    double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    int ioThreads = argc > 4 ? atoi(argv[4]) : 2;
+    size_t maxLag = (argc > 5 ? static_cast<size_t>(atol(argv[5])) : 4096) * 1024;
+    ::signal(SIGPIPE, SIG_IGN); // 被断开的连接上可能还有写
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::unique_ptr<PubSubServer> server(new PubSubServer(serverLoop, InetAddress(kPort), "pubsub_bench"));
+    server->setThreadNum(ioThreads);
+    server->setMaxLagBytes(maxLag);
+    serverLoop->runInLoop([&server]() { server->start(); });
+
+    EventLoop loop;
+    std::string content(messageSize, 'm');
+    size_t wireBytes = 4 + strlen(kTopic) + 2 + messageSize + 2;
+    std::vector<std::unique_ptr<Subscriber>> subs;
+    for (int i = 0; i < subscribers; ++i)
+    {
+        subs.emplace_back(new Subscriber(&loop, i, wireBytes, false));
+    }
+    Subscriber slow(&loop, subscribers, wireBytes, true);
+    Publisher publisher(&loop, content);
+
+    Timestamp start;
+    loop.runAfter(0.1, [&]() { // 等服务端开始监听
+        for (auto& s : subs) s->start();
+        slow.start();
+    });
+    loop.runAfter(0.3, [&]() { // 等订阅生效
+        start = Timestamp::now();
+        publisher.start();
+    });
+    loop.runAfter(0.3 + seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        publisher.stop();
+        long received = 0;
+        for (auto& s : subs)
+        {
+            received += s->messages();
+            s->stop();
+        }
+        slow.resume();
+        fprintf(stderr, "%d subscribers, message %zu bytes, %d io threads, lag limit %zu KB\n",
+                subscribers, messageSize, ioThreads, maxLag / 1024);
+        fprintf(stderr, "published %ld msg (%.0f msg/s), delivered %ld (%.0f msg/s), received %.0f msg/s\n",
+                server->publishedMessages(), server->publishedMessages() / elapsed,
+                server->deliveredMessages(), server->deliveredMessages() / elapsed, received / elapsed);
+        loop.runAfter(0.5, [&]() {
+            fprintf(stderr, "dropped subscribers: %ld, slow subscriber %s\n",
+                    server->droppedSubscribers(), slow.dropped() ? "dropped" : "NOT dropped");
+            slow.stop();
+            serverLoop->runInLoop([&server]() { server.reset(); }); // 在服务端loop线程中析构
+            loop.runAfter(0.1, [&]() { loop.quit(); });
+        });
+    });
+    loop.loop();
+    return 0;
+}
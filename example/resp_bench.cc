@@ -0,0 +1,190 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+/**
+ * RESP流水线压测客户端 (类似 redis-benchmark -P)  可以压resp_server也可以压redis
+ *
+ * 用法: ./resp_bench [端口] [连接数] [流水线深度] [秒数] [key数量] [value字节] [SET比例%]
+ *   每个连接保持"流水线深度"个命令在途，每收到一批应答就补发同样数量的命令
+ *   key从 key:0 ~ key:(N-1) 中随机选取
+ * 结果输出到stderr (stdout为日志)
+ */
+
+class BenchConnection
+{
+public:
+    BenchConnection(EventLoop* loop, uint16_t port, int id, int depth, int keys,
+                    const std::string& value, int setPercent)
+        : client_(loop, InetAddress(port), "resp_bench" + std::to_string(id))
+        , depth_(depth)
+        , keys_(keys)
+        , value_(value)
+        , setPercent_(setPercent)
+        , seed_(static_cast<unsigned>(id * 7919 + 1))
+        , running_(true)
+        , completed_(0)
+        , hits_(0)
+        , misses_(0)
+        , errors_(0)
+    {
+        client_.setConnectionCallback(std::bind(&BenchConnection::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&BenchConnection::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+
+    long completed() const { return completed_; }
+    long hits() const { return hits_; }
+    long misses() const { return misses_; }
+    long errors() const { return errors_; }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            sendCommands(conn, depth_);
+        }
+    }
+
+    // 追加n个随机GET/SET命令 一次发出
+    void sendCommands(const TcpConnectionPtr& conn, int n)
+    {
+        out_.clear();
+        char key[32];
+        char line[64];
+        for (int i = 0; i < n; ++i)
+        {
+            int keyLen = snprintf(key, sizeof key, "key:%d", static_cast<int>(rand_r(&seed_) % keys_));
+            bool set = static_cast<int>(rand_r(&seed_) % 100) < setPercent_;
+            int len;
+            if (set)
+            {
+                len = snprintf(line, sizeof line, "*3\r\n$3\r\nSET\r\n$%d\r\n", keyLen);
+                out_.append(line, len);
+                out_.append(key, keyLen);
+                len = snprintf(line, sizeof line, "\r\n$%zu\r\n", value_.size());
+                out_.append(line, len);
+                out_.append(value_);
+                out_.append("\r\n", 2);
+            }
+            else
+            {
+                len = snprintf(line, sizeof line, "*2\r\n$3\r\nGET\r\n$%d\r\n", keyLen);
+                out_.append(line, len);
+                out_.append(key, keyLen);
+                out_.append("\r\n", 2);
+            }
+        }
+        conn->send(out_);
+    }
+
+    // 解析应答: +OK / -ERR / :n / $-1 / $len\r\n data\r\n
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        int done = 0;
+        for (;;)
+        {
+            const char* begin = buf->peek();
+            size_t readable = buf->readableBytes();
+            const char* crlf = static_cast<const char*>(::memmem(begin, readable, "\r\n", 2));
+            if (crlf == nullptr)
+            {
+                break;
+            }
+            size_t total = crlf + 2 - begin;
+            if (begin[0] == '$')
+            {
+                long len = atol(begin + 1);
+                if (len >= 0)
+                {
+                    total += len + 2;
+                    if (readable < total)
+                    {
+                        break;
+                    }
+                    ++hits_;
+                }
+                else
+                {
+                    ++misses_;
+                }
+            }
+            else if (begin[0] == '-')
+            {
+                ++errors_;
+            }
+            buf->retrieve(total);
+            ++done;
+        }
+        completed_ += done;
+        if (running_ && done > 0)
+        {
+            sendCommands(conn, done);
+        }
+    }
+
+    TcpClient client_;
+    const int depth_;
+    const int keys_;
+    const std::string value_;
+    const int setPercent_;
+    unsigned seed_;
+    bool running_;
+    long completed_;
+    long hits_;
+    long misses_;
+    long errors_;
+    std::string out_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 6380);
+    int connections = argc > 2 ? atoi(argv[2]) : 50;
+    int depth = argc > 3 ? atoi(argv[3]) : 16;
+    double seconds = argc > 4 ? atof(argv[4]) : 5.0;
+    int keys = argc > 5 ? atoi(argv[5]) : 100000;
+    size_t valueSize = argc > 6 ? static_cast<size_t>(atol(argv[6])) : 32;
+    int setPercent = argc > 7 ? atoi(argv[7]) : 10;
+
+    EventLoop loop;
+    std::string value(valueSize, 'v');
+    std::vector<std::unique_ptr<BenchConnection>> conns;
+    for (int i = 0; i < connections; ++i)
+    {
+        conns.emplace_back(new BenchConnection(&loop, port, i, depth, keys, value, setPercent));
+    }
+
+    Timestamp start = Timestamp::now();
+    for (auto& c : conns) c->start();
+    loop.runAfter(seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        long completed = 0, hits = 0, misses = 0, errors = 0;
+        for (auto& c : conns)
+        {
+            c->stop();
+            completed += c->completed();
+            hits += c->hits();
+            misses += c->misses();
+            errors += c->errors();
+        }
+        fprintf(stderr, "%d connections, pipeline %d, %d keys, value %zu, SET %d%%\n",
+                connections, depth, keys, valueSize, setPercent);
+        fprintf(stderr, "%.0f ops/s, GET hit %ld miss %ld, errors %ld\n", completed / elapsed, hits, misses, errors);
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    return 0;
+}
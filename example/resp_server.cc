@@ -0,0 +1,672 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "StringPiece.h"
+#include "Logger.h"
+
+/**
+ * Redis协议 (RESP) 兼容的内存缓存服务器  支持 GET/SET/DEL (多key)/PING/ECHO，LRU淘汰
+ *
+ * - 键空间按hash分片，每个subloop拥有一个分片，分片只在自己的loop线程中访问，不加锁
+ * - 连接所在loop的分片直接执行；其他分片的命令按目标分片攒成一批，每批一次runInLoop转发，
+ *   结果再一次runInLoop送回连接所在的loop
+ * - 流水线: 每个命令占一个应答槽，远端结果乱序返回，按槽顺序输出；本地命令在没有等待中的槽时直接写出
+ *
+ * 用法: ./resp_server [端口] [IO线程数] [内存上限MB]
+ *   redis-cli -p 6380 / redis-benchmark -p 6380 -t set,get -P 16  或 resp_bench 压测
+ */
+
+namespace
+{
+const size_t kMaxBulkLen = 64 * 1024 * 1024;
+const int kMaxArgs = 1024 * 1024;
+const size_t kItemOverhead = 64; // 每个键值对的估计额外开销 (节点/指针)
+
+// FNV-1a  选择分片
+uint64_t hashKey(const StringPiece& key)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void appendBulk(std::string* out, const char* data, size_t len)
+{
+    char line[32];
+    int n = snprintf(line, sizeof line, "$%zu\r\n", len);
+    out->append(line, n);
+    out->append(data, len);
+    out->append("\r\n", 2);
+}
+
+void appendInteger(std::string* out, long long x)
+{
+    char line[32];
+    int n = snprintf(line, sizeof line, ":%lld\r\n", x);
+    out->append(line, n);
+}
+
+const char kOk[] = "+OK\r\n";
+const char kNull[] = "$-1\r\n";
+
+bool equalsIgnoreCase(const StringPiece& s, const char* literal)
+{
+    size_t n = ::strlen(literal);
+    return s.size() == n && ::strncasecmp(s.data(), literal, n) == 0;
+}
+
+// 读取 "<整数>\r\n"  返回消耗的字节数，0表示不完整，-1表示格式错误
+int parseLineInt(const char* p, const char* end, long long* value)
+{
+    const char* crlf = static_cast<const char*>(::memchr(p, '\r', end - p));
+    if (crlf == nullptr || crlf + 1 >= end)
+    {
+        return (end - p > 32) ? -1 : 0;
+    }
+    if (crlf[1] != '\n' || crlf == p)
+    {
+        return -1;
+    }
+    bool negative = *p == '-';
+    long long x = 0;
+    for (const char* q = negative ? p + 1 : p; q < crlf; ++q)
+    {
+        if (*q < '0' || *q > '9' || x > (1LL << 40))
+        {
+            return -1;
+        }
+        x = x * 10 + (*q - '0');
+    }
+    *value = negative ? -x : x;
+    return static_cast<int>(crlf + 2 - p);
+}
+
+/**
+ * 从缓冲区解析一条命令  参数是指向缓冲区的切片
+ * 返回消耗的字节数，0表示数据不完整，-1表示协议错误
+ * 支持RESP数组 (*N\r\n$len\r\n...) 和内联命令 ("PING\r\n"，方便telnet调试)
+ */
+long parseCommand(const char* begin, size_t len, std::vector<StringPiece>* args)
+{
+    args->clear();
+    const char* p = begin;
+    const char* end = begin + len;
+    if (len == 0)
+    {
+        return 0;
+    }
+    if (*p != '*')
+    {
+        const char* nl = static_cast<const char*>(::memchr(p, '\n', len));
+        if (nl == nullptr)
+        {
+            return len > 64 * 1024 ? -1 : 0;
+        }
+        const char* lineEnd = (nl > p && nl[-1] == '\r') ? nl - 1 : nl;
+        for (const char* q = p; q < lineEnd; )
+        {
+            while (q < lineEnd && *q == ' ') ++q;
+            const char* word = q;
+            while (q < lineEnd && *q != ' ') ++q;
+            if (q > word)
+            {
+                args->push_back(StringPiece(word, q - word));
+            }
+        }
+        return nl + 1 - begin;
+    }
+
+    long long count = 0;
+    int n = parseLineInt(p + 1, end, &count);
+    if (n <= 0)
+    {
+        return n;
+    }
+    if (count > kMaxArgs)
+    {
+        return -1;
+    }
+    p += 1 + n;
+    for (long long i = 0; i < count; ++i)
+    {
+        if (p >= end)
+        {
+            return 0;
+        }
+        if (*p != '$')
+        {
+            return -1;
+        }
+        long long bulkLen = 0;
+        n = parseLineInt(p + 1, end, &bulkLen);
+        if (n <= 0)
+        {
+            return n;
+        }
+        if (bulkLen < 0 || static_cast<size_t>(bulkLen) > kMaxBulkLen)
+        {
+            return -1;
+        }
+        p += 1 + n;
+        if (static_cast<size_t>(end - p) < static_cast<size_t>(bulkLen) + 2)
+        {
+            return 0;
+        }
+        if (p[bulkLen] != '\r' || p[bulkLen + 1] != '\n')
+        {
+            return -1;
+        }
+        args->push_back(StringPiece(p, bulkLen));
+        p += bulkLen + 2;
+    }
+    return p - begin;
+}
+}
+
+
+/**
+ * 一个分片  只在所属loop线程中访问
+ * LRU链表保存指向map中key的指针 (unordered_map节点地址稳定)，最近使用的在表头
+ */
+class Shard
+{
+public:
+    Shard(EventLoop* loop, size_t maxBytes)
+        : loop_(loop)
+        , maxBytes_(maxBytes)
+        , bytes_(0)
+        , evictions_(0)
+    {
+    }
+
+    EventLoop* loop() const { return loop_; }
+
+    // 返回nullptr表示不存在  命中时移到LRU表头
+    const std::string* get(const StringPiece& key)
+    {
+        keyScratch_.assign(key.data(), key.size()); // 复用容量 查找时不分配
+        auto it = items_.find(keyScratch_);
+        if (it == items_.end())
+        {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return &it->second.value;
+    }
+
+    void set(const StringPiece& key, const StringPiece& value)
+    {
+        keyScratch_.assign(key.data(), key.size());
+        auto it = items_.find(keyScratch_);
+        if (it != items_.end())
+        {
+            bytes_ = bytes_ - it->second.value.size() + value.size();
+            it->second.value.assign(value.data(), value.size());
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+        }
+        else
+        {
+            it = items_.emplace(keyScratch_, Item()).first;
+            it->second.value.assign(value.data(), value.size());
+            lru_.push_front(&it->first);
+            it->second.lru = lru_.begin();
+            bytes_ += key.size() + value.size() + kItemOverhead;
+        }
+        evict();
+    }
+
+    bool del(const StringPiece& key)
+    {
+        keyScratch_.assign(key.data(), key.size());
+        auto it = items_.find(keyScratch_);
+        if (it == items_.end())
+        {
+            return false;
+        }
+        bytes_ -= it->first.size() + it->second.value.size() + kItemOverhead;
+        lru_.erase(it->second.lru);
+        items_.erase(it);
+        return true;
+    }
+
+    size_t size() const { return items_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t evictions() const { return evictions_; }
+
+private:
+    struct Item
+    {
+        std::string value;
+        std::list<const std::string*>::iterator lru;
+    };
+
+    // 超过内存上限时从LRU表尾淘汰
+    void evict()
+    {
+        while (bytes_ > maxBytes_ && items_.size() > 1)
+        {
+            auto it = items_.find(*lru_.back());
+            bytes_ -= it->first.size() + it->second.value.size() + kItemOverhead;
+            lru_.pop_back();
+            items_.erase(it);
+            ++evictions_;
+        }
+    }
+
+    EventLoop* loop_;
+    const size_t maxBytes_;
+    size_t bytes_;
+    size_t evictions_;
+    std::unordered_map<std::string, Item> items_;
+    std::list<const std::string*> lru_;
+    std::string keyScratch_;
+};
+
+
+// 转发到其他分片的命令 (参数已拷贝)
+struct Command
+{
+    enum Op { kGet, kSet, kDel };
+    Op op;
+    uint64_t seq; // 应答槽序号
+    std::string key;
+    std::string value;
+};
+
+// 远端执行结果
+struct Result
+{
+    uint64_t seq;
+    long long deleted; // DEL删除的个数
+    std::string reply; // GET/SET的完整应答
+};
+
+using CommandBatch = std::vector<Command>;
+using ResultBatch = std::vector<Result>;
+
+
+/**
+ * 每个连接的状态  只在连接所属loop线程中访问
+ * slots_[i] 对应序号 firstSeq_ + i 的命令，pending为0时可以输出
+ */
+class Session
+{
+public:
+    explicit Session(size_t shards)
+        : batches_(shards)
+        , firstSeq_(0)
+    {
+    }
+
+    std::vector<StringPiece>& args() { return args_; }
+    std::vector<CommandBatch>& batches() { return batches_; }
+
+    // 前面没有等待中的槽时，本地应答直接追加到输出
+    bool canReplyDirectly() const { return slots_.empty(); }
+    std::string* out() { return &out_; }
+
+    // 新建一个应答槽 返回序号  pending为需要等待的远端结果数
+    uint64_t addSlot(int pending, bool isDel, long long deleted, const std::string& reply)
+    {
+        Slot slot;
+        slot.pending = pending;
+        slot.isDel = isDel;
+        slot.deleted = deleted;
+        slot.reply = reply;
+        slots_.push_back(std::move(slot));
+        return firstSeq_ + slots_.size() - 1;
+    }
+
+    // 远端结果到达  按顺序把已完成的槽移到输出
+    void complete(ResultBatch& results)
+    {
+        for (Result& r : results)
+        {
+            Slot& slot = slots_[r.seq - firstSeq_];
+            if (slot.isDel)
+            {
+                slot.deleted += r.deleted;
+            }
+            else
+            {
+                slot.reply.swap(r.reply);
+            }
+            --slot.pending;
+        }
+        while (!slots_.empty() && slots_.front().pending == 0)
+        {
+            Slot& slot = slots_.front();
+            if (slot.isDel)
+            {
+                appendInteger(&out_, slot.deleted);
+            }
+            else
+            {
+                out_.append(slot.reply);
+            }
+            slots_.pop_front();
+            ++firstSeq_;
+        }
+    }
+
+    void flush(const TcpConnectionPtr& conn)
+    {
+        if (!out_.empty())
+        {
+            conn->send(out_);
+            out_.clear();
+        }
+    }
+
+private:
+    struct Slot
+    {
+        int pending;
+        bool isDel;
+        long long deleted;
+        std::string reply;
+    };
+
+    std::vector<StringPiece> args_;      // 当前命令的参数 (指向输入缓冲区)
+    std::vector<CommandBatch> batches_;  // 本次onMessage中发往各分片的命令
+    std::deque<Slot> slots_;
+    uint64_t firstSeq_;
+    std::string out_;
+};
+using SessionPtr = std::shared_ptr<Session>;
+
+
+class RespServer
+{
+public:
+    RespServer(EventLoop* loop, const InetAddress& addr, int threads, size_t maxBytes)
+        : server_(loop, addr, "RespServer")
+        , threads_(threads)
+        , maxBytes_(maxBytes)
+    {
+        server_.setThreadNum(threads);
+        server_.setThreadInitCallback(std::bind(&RespServer::onThreadInit, this, std::placeholders::_1));
+        server_.setConnectionCallback(std::bind(&RespServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(std::bind(&RespServer::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    // 返回后所有分片都已创建 (线程池启动时逐个执行初始化回调)
+    void start() { server_.start(); }
+
+private:
+    // 每个IO线程创建自己的分片 (0个线程时只有baseLoop一个分片)
+    void onThreadInit(EventLoop* loop)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t shards = threads_ > 0 ? threads_ : 1;
+        shards_.push_back(std::unique_ptr<Shard>(new Shard(loop, maxBytes_ / shards)));
+    }
+
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            conn->setContext(std::make_shared<Session>(shards_.size()));
+        }
+    }
+
+    size_t shardIndex(const StringPiece& key) const { return hashKey(key) % shards_.size(); }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        SessionPtr session = std::static_pointer_cast<Session>(conn->getContext());
+        if (!session)
+        {
+            buf->retrieveAll();
+            return;
+        }
+
+        for (;;)
+        {
+            long n = parseCommand(buf->peek(), buf->readableBytes(), &session->args());
+            if (n == 0)
+            {
+                break;
+            }
+            if (n < 0)
+            {
+                reply(session.get(), "-ERR Protocol error\r\n");
+                session->flush(conn);
+                buf->retrieveAll();
+                conn->setContext(nullptr);
+                conn->shutdown();
+                break;
+            }
+            if (!session->args().empty())
+            {
+                execute(conn, session.get());
+            }
+            buf->retrieve(n); // 参数切片用完后再取走
+        }
+
+        dispatch(conn, session);
+        session->flush(conn);
+    }
+
+    // 本地应答: 前面有等待中的槽时也要排队
+    void reply(Session* session, const StringPiece& data)
+    {
+        if (session->canReplyDirectly())
+        {
+            session->out()->append(data.data(), data.size());
+        }
+        else
+        {
+            session->addSlot(0, false, 0, data.as_string());
+        }
+    }
+
+    void replyValue(Session* session, const std::string* value)
+    {
+        if (value == nullptr)
+        {
+            reply(session, StringPiece(kNull, sizeof kNull - 1));
+        }
+        else if (session->canReplyDirectly())
+        {
+            appendBulk(session->out(), value->data(), value->size());
+        }
+        else
+        {
+            std::string r;
+            appendBulk(&r, value->data(), value->size());
+            session->addSlot(0, false, 0, r);
+        }
+    }
+
+    // 发往其他分片的命令先攒在batches中 (参数拷贝一份)
+    void forward(Session* session, size_t index, Command::Op op, uint64_t seq,
+                 const StringPiece& key, const StringPiece& value = StringPiece())
+    {
+        session->batches()[index].push_back(Command{ op, seq, key.as_string(), value.as_string() });
+    }
+
+    void execute(const TcpConnectionPtr& conn, Session* session)
+    {
+        const std::vector<StringPiece>& args = session->args();
+        const StringPiece& cmd = args[0];
+        EventLoop* local = conn->getLoop();
+
+        if (equalsIgnoreCase(cmd, "GET") && args.size() == 2)
+        {
+            size_t index = shardIndex(args[1]);
+            if (shards_[index]->loop() == local)
+            {
+                replyValue(session, shards_[index]->get(args[1]));
+            }
+            else
+            {
+                forward(session, index, Command::kGet, session->addSlot(1, false, 0, std::string()), args[1]);
+            }
+        }
+        else if (equalsIgnoreCase(cmd, "SET") && args.size() == 3)
+        {
+            size_t index = shardIndex(args[1]);
+            if (shards_[index]->loop() == local)
+            {
+                shards_[index]->set(args[1], args[2]);
+                reply(session, StringPiece(kOk, sizeof kOk - 1));
+            }
+            else
+            {
+                forward(session, index, Command::kSet, session->addSlot(1, false, 0, std::string()), args[1], args[2]);
+            }
+        }
+        else if (equalsIgnoreCase(cmd, "DEL") && args.size() >= 2)
+        {
+            long long deleted = 0;
+            int remote = 0;
+            for (size_t i = 1; i < args.size(); ++i)
+            {
+                Shard* shard = shards_[shardIndex(args[i])].get();
+                if (shard->loop() == local)
+                {
+                    deleted += shard->del(args[i]) ? 1 : 0;
+                }
+                else
+                {
+                    ++remote;
+                }
+            }
+            if (remote == 0)
+            {
+                std::string r;
+                appendInteger(&r, deleted);
+                reply(session, r);
+                return;
+            }
+            uint64_t seq = session->addSlot(remote, true, deleted, std::string());
+            for (size_t i = 1; i < args.size(); ++i)
+            {
+                size_t index = shardIndex(args[i]);
+                if (shards_[index]->loop() != local)
+                {
+                    forward(session, index, Command::kDel, seq, args[i]);
+                }
+            }
+        }
+        else if (equalsIgnoreCase(cmd, "PING"))
+        {
+            if (args.size() > 1)
+            {
+                std::string r;
+                appendBulk(&r, args[1].data(), args[1].size());
+                reply(session, r);
+            }
+            else
+            {
+                reply(session, "+PONG\r\n");
+            }
+        }
+        else if (equalsIgnoreCase(cmd, "ECHO") && args.size() == 2)
+        {
+            std::string r;
+            appendBulk(&r, args[1].data(), args[1].size());
+            reply(session, r);
+        }
+        else if (equalsIgnoreCase(cmd, "CONFIG") || equalsIgnoreCase(cmd, "COMMAND"))
+        {
+            reply(session, "*0\r\n"); // redis-benchmark/redis-cli启动时的探测
+        }
+        else
+        {
+            std::string r = "-ERR unknown command or wrong number of arguments for '";
+            r.append(cmd.data(), cmd.size() < 64 ? cmd.size() : 64);
+            r.append("'\r\n");
+            reply(session, r);
+        }
+    }
+
+    // 把本次攒下的远端命令按分片各一次runInLoop发出  结果一次runInLoop送回
+    void dispatch(const TcpConnectionPtr& conn, const SessionPtr& session)
+    {
+        std::vector<CommandBatch>& batches = session->batches();
+        for (size_t i = 0; i < batches.size(); ++i)
+        {
+            if (batches[i].empty())
+            {
+                continue;
+            }
+            Shard* shard = shards_[i].get();
+            std::shared_ptr<CommandBatch> batch = std::make_shared<CommandBatch>();
+            batch->swap(batches[i]);
+            shard->loop()->runInLoop([shard, batch, conn, session]() {
+                std::shared_ptr<ResultBatch> results = std::make_shared<ResultBatch>(batch->size());
+                for (size_t j = 0; j < batch->size(); ++j)
+                {
+                    Command& c = (*batch)[j];
+                    Result& r = (*results)[j];
+                    r.seq = c.seq;
+                    r.deleted = 0;
+                    if (c.op == Command::kGet)
+                    {
+                        const std::string* value = shard->get(c.key);
+                        if (value)
+                        {
+                            appendBulk(&r.reply, value->data(), value->size());
+                        }
+                        else
+                        {
+                            r.reply.assign(kNull, sizeof kNull - 1);
+                        }
+                    }
+                    else if (c.op == Command::kSet)
+                    {
+                        shard->set(c.key, c.value);
+                        r.reply.assign(kOk, sizeof kOk - 1);
+                    }
+                    else
+                    {
+                        r.deleted = shard->del(c.key) ? 1 : 0;
+                    }
+                }
+                conn->getLoop()->runInLoop([conn, session, results]() {
+                    session->complete(*results);
+                    session->flush(conn);
+                });
+            });
+        }
+    }
+
+    TcpServer server_;
+    const int threads_;
+    const size_t maxBytes_;
+    std::mutex mutex_;                    // 只在初始化分片时使用
+    std::vector<std::unique_ptr<Shard>> shards_; // start之后只读
+};
+
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 6380);
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    size_t maxMB = argc > 3 ? static_cast<size_t>(atol(argv[3])) : 1024;
+
+    EventLoop loop;
+    RespServer server(&loop, InetAddress(port), threads, maxMB * 1024 * 1024);
+    server.start();
+    LOG_INFO("RespServer listening on %d, %d shards, %zu MB\n", port, threads > 0 ? threads : 1, maxMB);
+    loop.loop();
+    return 0;
+}
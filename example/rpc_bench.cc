@@ -0,0 +1,158 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RpcServer.h"
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * RPC吞吐/延迟压测 (回环)  服务端在另一个IO线程中
+ *
+ * 用法: ./rpc_bench [每连接在途调用数] [连接数] [秒数] [loop|pool] [payload字节] [超时ms]
+ *   每个连接保持固定数量的在途调用 (1~1000)，完成一个立即补发一个
+ *   loop  echo在服务端IO线程中执行；pool  echo投递到计算线程池
+ *   超时ms>0时每个调用都挂一个loop定时器
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19200;
+
+class BenchConnection
+{
+public:
+    BenchConnection(EventLoop* loop, int id, int inflight, const std::string& method,
+                    const std::string& payload, double timeout)
+        : loop_(loop)
+        , client_(loop, InetAddress(kPort), "rpc_bench" + std::to_string(id))
+        , inflight_(inflight)
+        , method_(method)
+        , payload_(payload)
+        , timeout_(timeout)
+        , running_(false)
+        , completed_(0)
+        , failed_(0)
+    {
+        client_.setConnectionCallback([this](bool connected) {
+            if (connected)
+            {
+                for (int i = 0; i < inflight_; ++i)
+                {
+                    issue();
+                }
+            }
+        });
+    }
+
+    void start() { running_ = true; client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+
+    long completed() const { return completed_; }
+    long failed() const { return failed_; }
+    std::vector<int>& latencies() { return latencies_; }
+
+private:
+    void issue()
+    {
+        Timestamp start = Timestamp::now();
+        client_.call(method_, payload_, [this, start](RpcStatus status, const StringPiece& response) {
+            if (!running_)
+            {
+                return;
+            }
+            if (status == kRpcOk && response.size() == payload_.size())
+            {
+                ++completed_;
+                if ((completed_ & 15) == 0) // 抽样记录延迟
+                {
+                    latencies_.push_back(static_cast<int>(Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()));
+                }
+            }
+            else
+            {
+                ++failed_;
+            }
+            issue();
+        }, timeout_);
+    }
+
+    EventLoop* loop_;
+    RpcClient client_;
+    const int inflight_;
+    const std::string method_;
+    const std::string payload_;
+    const double timeout_;
+    bool running_;
+    long completed_;
+    long failed_;
+    std::vector<int> latencies_; // 微秒
+};
+
+
+int main(int argc, char* argv[])
+{
+    int inflight = argc > 1 ? atoi(argv[1]) : 64;
+    int connections = argc > 2 ? atoi(argv[2]) : 1;
+    double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    bool pool = argc > 4 && strcmp(argv[4], "pool") == 0;
+    size_t payloadSize = argc > 5 ? static_cast<size_t>(atol(argv[5])) : 32;
+    double timeout = argc > 6 ? atof(argv[6]) / 1000.0 : 0;
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    RpcServer server(serverLoop, InetAddress(kPort), "rpc_bench");
+    RpcServer::RpcHandler echo = [](const StringPiece& request, std::string* response) {
+        response->assign(request.data(), request.size());
+        return kRpcOk;
+    };
+    server.registerMethod("echo", echo, RpcServer::kInLoop);
+    server.registerMethod("echo_pool", echo, RpcServer::kInPool);
+    serverLoop->runInLoop([&server]() { server.start(); });
+
+    EventLoop loop;
+    std::string payload(payloadSize, 'r');
+    std::vector<std::unique_ptr<BenchConnection>> conns;
+    for (int i = 0; i < connections; ++i)
+    {
+        conns.emplace_back(new BenchConnection(&loop, i, inflight, pool ? "echo_pool" : "echo", payload, timeout));
+    }
+
+    Timestamp start;
+    loop.runAfter(0.1, [&]() { // 等服务端开始监听
+        start = Timestamp::now();
+        for (auto& c : conns) c->start();
+    });
+    loop.runAfter(0.1 + seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        long completed = 0;
+        long failed = 0;
+        std::vector<int> latencies;
+        for (auto& c : conns)
+        {
+            c->stop();
+            completed += c->completed();
+            failed += c->failed();
+            latencies.insert(latencies.end(), c->latencies().begin(), c->latencies().end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double avg = 0;
+        for (int l : latencies) avg += l;
+        avg = latencies.empty() ? 0 : avg / latencies.size();
+        fprintf(stderr, "%d conn x %d in-flight, %s, payload %zu: %.0f calls/s, failed %ld\n",
+                connections, inflight, pool ? "pool" : "loop", payloadSize, completed / elapsed, failed);
+        if (!latencies.empty())
+        {
+            fprintf(stderr, "latency us: avg %.1f  p50 %d  p99 %d  max %d\n", avg,
+                    latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+        }
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <string>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "TlsContext.h"
+#include "Logger.h"
+
+/**
+ * TLS压测 (回环 自签名证书)  服务端在另一个IO线程中
+ *
+ * 生成自签名证书:
+ *   openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -days 365 -subj /CN=localhost
+ *
+ * 用法: ./tls_bench <cert.pem> <key.pem> [pingpong|stream|sendfile] [次数或MB] [tls|tls12|plain]
+ *   pingpong  64字节回显 统计往返延迟
+ *   stream    客户端连续发送 服务端计数
+ *   sendfile  服务端用sendFile发送一个临时文件 客户端计数 (kTLS时文件内容不经过用户态)
+ *   tls12     限制为TLS1.2 (OpenSSL 3.0只支持TLS1.2接收方向的kTLS)
+ *   plain     不加密 作为对照
+ * 客户端用cert.pem作为CA校验服务端证书 (主机名localhost)
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19443;
+static const size_t kChunk = 64 * 1024;
+static const char* kFilePath = "/tmp/tls_bench.dat";
+
+enum Mode { kPingPong, kStream, kSendFile };
+
+class Bench
+{
+public:
+    Bench(EventLoop* loop, Mode mode, long count, std::atomic<long>* serverReceived)
+        : loop_(loop)
+        , client_(loop, InetAddress(kPort), "tls_bench")
+        , mode_(mode)
+        , message_(mode == kPingPong ? 64 : kChunk, 'm')
+        , count_(count)
+        , done_(0)
+        , sent_(0)
+        , received_(0)
+        , serverReceived_(serverReceived)
+    {
+        client_.setConnectionCallback(std::bind(&Bench::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Bench::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.setWriteCompleteCallback(std::bind(&Bench::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    TcpClient& client() { return client_; }
+    void start() { client_.connect(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (!conn->connected())
+        {
+            if (done_ < count_ && mode_ != kStream)
+            {
+                fprintf(stderr, "connection closed early\n");
+                loop_->quit();
+            }
+            return;
+        }
+        fprintf(stderr, "client kTLS tx:%d rx:%d\n", conn->ktlsSend(), conn->ktlsRecv());
+        start_ = Timestamp::now();
+        if (mode_ == kPingPong)
+        {
+            conn->send(message_);
+        }
+        else if (mode_ == kStream)
+        {
+            for (int i = 0; i < 4 && sent_ < count_; ++i)
+            {
+                conn->send(message_);
+                ++sent_;
+            }
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        received_ += buf->readableBytes();
+        buf->retrieveAll();
+        if (mode_ == kSendFile)
+        {
+            if (received_ >= static_cast<size_t>(count_) * kChunk)
+            {
+                report(static_cast<double>(received_));
+            }
+            return;
+        }
+        while (received_ >= message_.size())
+        {
+            received_ -= message_.size();
+            if (++done_ >= count_)
+            {
+                report(static_cast<double>(done_) * 2 * message_.size());
+                return;
+            }
+            conn->send(message_);
+        }
+    }
+
+    void onWriteComplete(const TcpConnectionPtr& conn)
+    {
+        if (mode_ != kStream)
+        {
+            return;
+        }
+        if (sent_ < count_)
+        {
+            conn->send(message_);
+            ++sent_;
+        }
+        else if (sent_ == count_)
+        {
+            ++sent_;
+            waitDrained();
+        }
+    }
+
+    void waitDrained()
+    {
+        long total = count_ * static_cast<long>(kChunk);
+        if (serverReceived_->load() >= total)
+        {
+            report(static_cast<double>(total));
+            return;
+        }
+        loop_->runAfter(0.001, std::bind(&Bench::waitDrained, this));
+    }
+
+    void report(double bytes)
+    {
+        double seconds = timeDifference(Timestamp::now(), start_);
+        if (mode_ == kPingPong)
+        {
+            fprintf(stderr, "pingpong: %ld round trips in %.3fs, avg %.2f us\n", done_, seconds, seconds * 1e6 / done_);
+        }
+        else
+        {
+            fprintf(stderr, "%s: %.0f MB in %.3fs, %.1f MB/s\n", mode_ == kStream ? "stream" : "sendfile",
+                    bytes / 1e6, seconds, bytes / 1e6 / seconds);
+        }
+        done_ = count_;
+        client_.disconnect();
+        loop_->quit();
+    }
+
+    EventLoop* loop_;
+    TcpClient client_;
+    const Mode mode_;
+    const std::string message_;
+    const long count_;
+    long done_;
+    long sent_;
+    size_t received_;
+    std::atomic<long>* serverReceived_;
+    Timestamp start_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <cert.pem> <key.pem> [pingpong|stream|sendfile] [count|MB] [tls|tls12|plain]\n", argv[0]);
+        return 1;
+    }
+    std::string modeArg = argc > 3 ? argv[3] : "pingpong";
+    Mode mode = modeArg == "stream" ? kStream : modeArg == "sendfile" ? kSendFile : kPingPong;
+    long count = argc > 4 ? atol(argv[4]) : (mode == kPingPong ? 50000 : 1000);
+    std::string security = argc > 5 ? argv[5] : "tls";
+    if (mode != kPingPong)
+    {
+        count = count * 1024 * 1024 / static_cast<long>(kChunk); // MB -> 块数
+    }
+
+    TlsContextPtr serverCtx;
+    TlsContextPtr clientCtx;
+    if (security != "plain")
+    {
+        serverCtx = TlsContext::newServerContext(argv[1], argv[2]);
+        clientCtx = TlsContext::newClientContext(argv[1]); // 自签名证书本身就是CA
+        if (!serverCtx || !clientCtx)
+        {
+            fprintf(stderr, "failed to create TLS context\n");
+            return 1;
+        }
+        serverCtx->setMaxTls12(security == "tls12");
+    }
+
+    // sendfile模式的源文件
+    int fileFd = -1;
+    if (mode == kSendFile)
+    {
+        fileFd = ::open(kFilePath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        std::string block(kChunk, 'f');
+        for (long i = 0; i < count; ++i)
+        {
+            if (::write(fileFd, block.data(), block.size()) != static_cast<ssize_t>(block.size()))
+            {
+                perror("write");
+                return 1;
+            }
+        }
+    }
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::atomic<long> serverReceived(0);
+    TcpServer server(serverLoop, InetAddress(kPort), "tls");
+    server.setTlsContext(serverCtx);
+    server.setConnectionCallback([mode, fileFd, count](const TcpConnectionPtr& conn) {
+        if (!conn->connected())
+        {
+            return;
+        }
+        fprintf(stderr, "server kTLS tx:%d rx:%d\n", conn->ktlsSend(), conn->ktlsRecv());
+        if (mode == kSendFile)
+        {
+            conn->sendFile(fileFd, 0, static_cast<size_t>(count) * kChunk);
+        }
+    });
+    server.setMessageCallback([mode, &serverReceived](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        if (mode == kPingPong)
+        {
+            conn->send(buf->retrieveAllAsString());
+        }
+        else
+        {
+            serverReceived += static_cast<long>(buf->readableBytes());
+            buf->retrieveAll();
+        }
+    });
+    server.start();
+
+    EventLoop loop;
+    Bench bench(&loop, mode, count, &serverReceived);
+    bench.client().setTlsContext(clientCtx, "localhost");
+    loop.runAfter(0.1, std::bind(&Bench::start, &bench)); // 等服务端开始监听
+    loop.loop();
+
+    if (fileFd >= 0)
+    {
+        ::close(fileFd);
+        ::unlink(kFilePath);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+/**
+ * UDP接收压测：发送线程用sendmmsg往UdpServer灌数据报，统计服务端每秒收到的数据报数
+ *
+ * 用法: ./udp_bench [IO线程数] [发送线程数] [每线程数据报数] [数据报大小] [gso 0/1] [gro 0/1]
+ *   gso=1  发送端用UDP_SEGMENT把每批同长度的数据报合并发送 (配合服务端GRO可以整包交给recvmmsg)
+ *   gro=0  服务端不开启UDP_GRO
+ * 结果输出到stderr (stdout为日志)   UDP在接收跟不上时会丢包，结果中给出丢包率
+ */
+
+static const uint16_t kPort = 19991;
+static const int kSendBatch = 32;
+
+// 发送线程  每个线程一个socket(源端口不同)，SO_REUSEPORT按四元组把它们分到不同的IO线程
+static void sender(int count, size_t size, bool gso, std::atomic<long>* sent)
+{
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ::connect(fd, (sockaddr*)&addr, sizeof addr);
+    if (gso)
+    {
+        int segment = static_cast<int>(size);
+        if (::setsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, sizeof segment) < 0)
+        {
+            fprintf(stderr, "UDP_SEGMENT not supported, sending without GSO\n");
+            gso = false;
+        }
+    }
+
+    std::vector<char> payload(size * kSendBatch, 'u');
+    std::vector<struct mmsghdr> msgs(kSendBatch);
+    std::vector<struct iovec> iovs(kSendBatch);
+    long done = 0;
+    while (done < count)
+    {
+        int batch = count - done < kSendBatch ? static_cast<int>(count - done) : kSendBatch;
+        int n;
+        if (gso) // 一次send发出batch个数据报 由内核切分
+        {
+            n = ::send(fd, payload.data(), size * batch, 0) > 0 ? batch : -1;
+        }
+        else
+        {
+            for (int i = 0; i < batch; ++i)
+            {
+                iovs[i].iov_base = &payload[i * size];
+                iovs[i].iov_len = size;
+                ::memset(&msgs[i], 0, sizeof msgs[i]);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            n = ::sendmmsg(fd, msgs.data(), batch, 0);
+        }
+        if (n <= 0)
+        {
+            if (errno == ENOBUFS || errno == EAGAIN)
+            {
+                continue;
+            }
+            perror("send");
+            break;
+        }
+        done += n;
+    }
+    *sent += done;
+    ::close(fd);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int ioThreads   = argc > 1 ? atoi(argv[1]) : 2;
+    int senders     = argc > 2 ? atoi(argv[2]) : 4;
+    int perSender   = argc > 3 ? atoi(argv[3]) : 500000;
+    size_t size     = argc > 4 ? atoi(argv[4]) : 200;
+    bool gso        = argc > 5 && atoi(argv[5]) != 0;
+    bool gro        = argc <= 6 || atoi(argv[6]) != 0;
+
+    EventLoop loop;
+    UdpServer server(&loop, InetAddress(kPort), "udp");
+    server.setThreadNum(ioThreads);
+    server.enableGro(gro);
+    server.setMessageCallback([](UdpSocket*, const char*, size_t, const InetAddress&, Timestamp) { });
+    server.start();
+
+    std::atomic<long> sent(0);
+    Timestamp start;
+    std::vector<std::thread> threads;
+    loop.runAfter(0.1, [&]() {
+        start = Timestamp::now();
+        for (int i = 0; i < senders; ++i)
+        {
+            threads.emplace_back(sender, perSender, size, gso, &sent);
+        }
+    });
+
+    // 接收数不再增长时结束
+    uint64_t last = 0;
+    loop.runEvery(0.2, [&]() {
+        uint64_t received = server.receivedDatagrams();
+        if (threads.size() == static_cast<size_t>(senders) && sent == static_cast<long>(senders) * perSender
+            && received == last)
+        {
+            double seconds = timeDifference(Timestamp::now(), start) - 0.2;
+            uint64_t calls = server.receiveCalls();
+            uint64_t groPackets = 0;
+            bool groOn = false;
+            for (UdpSocket* s : server.sockets())
+            {
+                groPackets += s->groPackets();
+                groOn = groOn || s->groEnabled();
+            }
+            fprintf(stderr, "io=%d senders=%d size=%lu gso=%d gro=%d: received %lu/%ld (loss %.2f%%) in %.3fs, "
+                    "%.0f datagrams/s, %.1f datagrams per recvmmsg, %lu GRO packets\n",
+                    ioThreads, senders, static_cast<unsigned long>(size), gso, groOn,
+                    static_cast<unsigned long>(received), sent.load(),
+                    100.0 * (sent - static_cast<long>(received)) / sent, seconds, received / seconds,
+                    calls ? static_cast<double>(received) / calls : 0.0, static_cast<unsigned long>(groPackets));
+            loop.quit();
+        }
+        last = received;
+    });
+    loop.loop();
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    return 0;
+}
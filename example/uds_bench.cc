@@ -0,0 +1,189 @@
+#include <string>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * 同机通信压测：回环TCP vs Unix域套接字  两端都走同样的TcpServer/TcpClient/TcpConnection/Buffer
+ * 服务端在另一个IO线程中
+ *
+ * 用法: ./uds_bench [tcp|tcp6|unix] [pingpong|stream] [消息大小] [次数或总MB]
+ *   pingpong  一条连接上收到回显再发下一条，统计往返延迟
+ *   stream    客户端连续发送总MB数据，服务端只计数，统计吞吐
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19771;
+static const char* kUnixPath = "/tmp/uds_bench.sock"; // "@uds_bench" 则使用抽象命名空间
+
+class Bench
+{
+public:
+    Bench(EventLoop* loop, const InetAddress& serverAddr, bool pingpong, size_t size, long count,
+          std::atomic<long>* serverReceived)
+        : loop_(loop)
+        , client_(loop, serverAddr, serverAddr.toIpPort())
+        , pingpong_(pingpong)
+        , message_(size, 'm')
+        , count_(count)
+        , done_(0)
+        , sent_(0)
+        , received_(0)
+        , serverReceived_(serverReceived)
+    {
+        client_.setConnectionCallback(std::bind(&Bench::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Bench::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.setWriteCompleteCallback(std::bind(&Bench::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    void start() { client_.connect(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        start_ = Timestamp::now();
+        if (pingpong_)
+        {
+            conn->send(message_);
+        }
+        else
+        {
+            // 先放几块进输出缓冲区 之后每次写完再补一块，保持管道满
+            for (int i = 0; i < 4 && sent_ < count_; ++i)
+            {
+                conn->send(message_);
+                ++sent_;
+            }
+        }
+    }
+
+    // pingpong: 收齐一条回显后发下一条
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        received_ += buf->readableBytes();
+        buf->retrieveAll();
+        while (received_ >= message_.size())
+        {
+            received_ -= message_.size();
+            if (++done_ >= count_)
+            {
+                report(static_cast<double>(done_) * 2 * message_.size());
+                return;
+            }
+            conn->send(message_);
+        }
+    }
+
+    // stream: 输出缓冲区发空后继续发送
+    void onWriteComplete(const TcpConnectionPtr& conn)
+    {
+        if (pingpong_)
+        {
+            return;
+        }
+        if (sent_ < count_)
+        {
+            conn->send(message_);
+            ++sent_;
+        }
+        else if (sent_ == count_)
+        {
+            ++sent_;
+            waitDrained();
+        }
+    }
+
+    // 等服务端收完全部数据
+    void waitDrained()
+    {
+        long total = count_ * static_cast<long>(message_.size());
+        if (serverReceived_->load() >= total)
+        {
+            report(static_cast<double>(total));
+            return;
+        }
+        loop_->runAfter(0.001, std::bind(&Bench::waitDrained, this));
+    }
+
+    void report(double bytes)
+    {
+        double seconds = timeDifference(Timestamp::now(), start_);
+        if (pingpong_)
+        {
+            fprintf(stderr, "%s pingpong size=%lu: %ld round trips in %.3fs, %.0f rtt/s, avg %.2f us\n",
+                    client_.name().c_str(), static_cast<unsigned long>(message_.size()), done_, seconds,
+                    done_ / seconds, seconds * 1e6 / done_);
+        }
+        else
+        {
+            fprintf(stderr, "%s stream size=%lu: %.0f MB in %.3fs, %.1f MB/s\n",
+                    client_.name().c_str(), static_cast<unsigned long>(message_.size()), bytes / 1e6, seconds,
+                    bytes / 1e6 / seconds);
+        }
+        client_.disconnect();
+        loop_->quit();
+    }
+
+    EventLoop* loop_;
+    TcpClient client_;
+    const bool pingpong_;
+    const std::string message_;
+    const long count_;
+    long done_;
+    long sent_;
+    size_t received_;
+    std::atomic<long>* serverReceived_;
+    Timestamp start_;
+};
+
+
+int main(int argc, char* argv[])
+{
+    std::string transport = argc > 1 ? argv[1] : "unix";
+    bool pingpong         = argc <= 2 || std::string(argv[2]) != "stream";
+    size_t size           = argc > 3 ? atoi(argv[3]) : (pingpong ? 64 : 65536);
+    long count            = argc > 4 ? atol(argv[4]) : (pingpong ? 100000 : 2000);
+    if (!pingpong)
+    {
+        count = count * 1024 * 1024 / static_cast<long>(size); // 总MB -> 块数
+    }
+
+    InetAddress addr = transport == "unix" ? InetAddress::fromUnixPath(kUnixPath)
+                     : transport == "tcp6" ? InetAddress(kPort, "::1")
+                     : InetAddress(kPort);
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::atomic<long> serverReceived(0);
+    TcpServer server(serverLoop, addr, transport);
+    server.setConnectionCallback([](const TcpConnectionPtr&) { });
+    server.setMessageCallback([pingpong, &serverReceived](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        if (pingpong)
+        {
+            conn->send(buf->retrieveAllAsString());
+        }
+        else
+        {
+            serverReceived += static_cast<long>(buf->readableBytes());
+            buf->retrieveAll();
+        }
+    });
+    server.start();
+
+    EventLoop loop;
+    Bench bench(&loop, addr, pingpong, size, count, &serverReceived);
+    loop.runAfter(0.1, std::bind(&Bench::start, &bench)); // 等服务端开始监听
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "UpstreamPool.h"
+#include "Logger.h"
+
+/**
+ * 上游连接池压测：模拟代理向上游发请求  上游是另一个线程中的echo服务
+ * 同时有concurrency个请求在进行，每个请求: checkout -> 发64字节 -> 收到回显 -> checkin
+ *
+ * 用法: ./upstream_pool_bench [pool|short] [请求数] [并发数] [连接池上限]
+ *   pool   连接用完放回池中复用
+ *   short  每个请求用完就关闭 (checkin reusable=false)，相当于每个请求新建一次连接
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const size_t kRequestLen = 64;
+static const uint16_t kPort = 19881;
+
+class ProxyBench
+{
+public:
+    ProxyBench(EventLoop* loop, bool reuse, int requests, int concurrency, size_t maxSize)
+        : loop_(loop)
+        , pool_(loop, InetAddress(kPort), "upstream")
+        , reuse_(reuse)
+        , request_(kRequestLen, 'x')
+        , remaining_(requests)
+        , inflight_(0)
+        , completed_(0)
+        , failed_(0)
+        , concurrency_(concurrency)
+    {
+        pool_.setMaxSize(maxSize);
+        pool_.setMinSize(reuse ? maxSize : 0);
+        pool_.setCheckoutTimeout(5.0);
+        pool_.setMaxWaiters(concurrency);
+        pool_.setMessageCallback(std::bind(&ProxyBench::onResponse, this,
+                                           std::placeholders::_1, std::placeholders::_2));
+    }
+
+    void start()
+    {
+        pool_.start();
+        start_ = Timestamp::now();
+        for (int i = 0; i < concurrency_; ++i)
+        {
+            issue();
+        }
+    }
+
+private:
+    // 发起一个请求
+    void issue()
+    {
+        if (remaining_ == 0)
+        {
+            if (inflight_ == 0)
+            {
+                finish();
+            }
+            return;
+        }
+        --remaining_;
+        ++inflight_;
+        pool_.checkout([this](const TcpConnectionPtr& conn) {
+            if (!conn)
+            {
+                ++failed_;
+                --inflight_;
+                issue();
+                return;
+            }
+            received_[conn.get()] = 0;
+            conn->send(request_);
+        });
+    }
+
+    // 上游响应  收齐一个请求的回显后归还连接
+    void onResponse(const TcpConnectionPtr& conn, Buffer* buf)
+    {
+        size_t& got = received_[conn.get()];
+        got += buf->readableBytes();
+        buf->retrieveAll();
+        if (got < kRequestLen)
+        {
+            return;
+        }
+        received_.erase(conn.get());
+        pool_.checkin(conn, reuse_);
+        ++completed_;
+        --inflight_;
+        issue();
+    }
+
+    void finish()
+    {
+        double seconds = timeDifference(Timestamp::now(), start_);
+        fprintf(stderr, "%s: %d requests in %.3fs, %.0f req/s, failed %d\n",
+                reuse_ ? "pool" : "short", completed_, seconds, completed_ / seconds, failed_);
+        fprintf(stderr, "%s\n", pool_.statsString().c_str());
+        loop_->quit();
+    }
+
+    EventLoop* loop_;
+    UpstreamPool pool_;
+    const bool reuse_;
+    const std::string request_;
+    int remaining_;
+    int inflight_;
+    int completed_;
+    int failed_;
+    const int concurrency_;
+    Timestamp start_;
+    std::unordered_map<TcpConnection*, size_t> received_; // 每个借出连接已收到的响应字节数
+};
+
+
+int main(int argc, char* argv[])
+{
+    bool reuse      = argc <= 1 || std::string(argv[1]) != "short";
+    int requests    = argc > 2 ? atoi(argv[2]) : 20000;
+    int concurrency = argc > 3 ? atoi(argv[3]) : 8;
+    size_t maxSize  = argc > 4 ? atoi(argv[4]) : 8;
+
+    // 上游echo服务
+    EventLoopThread upstreamThread;
+    EventLoop* upstreamLoop = upstreamThread.startLoop();
+    TcpServer upstream(upstreamLoop, InetAddress(kPort), "echo");
+    upstream.setConnectionCallback([](const TcpConnectionPtr&) { });
+    upstream.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    upstream.start();
+
+    EventLoop loop;
+    ProxyBench bench(&loop, reuse, requests, concurrency, maxSize);
+    loop.runAfter(0.1, std::bind(&ProxyBench::start, &bench)); // 等上游开始监听
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <signal.h>
+
+#include "WebSocketServer.h"
+#include "WebSocketFrame.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * WebSocket压测
+ *   1. 解掩码吞吐：标量实现 vs 运行时选定的实现 (sse2/avx2)，并校验两者结果一致
+ *   2. 回环echo：服务端在另一个线程中，有若干IO线程；每个客户端握手后流水线发送一批带掩码的帧，
+ *      收齐echo后再发下一批，统计每秒往返的消息数
+ *      (客户端的帧在启动时编码并加掩码一次，之后重复发送，不计入客户端开销)
+ *
+ * 用法: ./websocket_bench [客户端数] [消息字节] [秒数] [服务端IO线程数]
+ * 结果输出到stderr (stdout为日志)
+ */
+
+static const uint16_t kPort = 19500;
+
+static void benchUnmask()
+{
+    const char key[4] = { 0x37, static_cast<char>(0xfa), 0x21, 0x3d };
+
+    // 随机长度和起始偏移 两种实现结果一致
+    std::vector<char> a(4096 + 64), b;
+    srand(1);
+    for (int round = 0; round < 1000; ++round)
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            a[i] = static_cast<char>(rand());
+        }
+        b = a;
+        size_t offset = rand() % 64;
+        size_t n = rand() % 4096;
+        WebSocketFrame::unmask(&a[offset], n, key);
+        WebSocketFrame::unmaskPortable(&b[offset], n, key);
+        if (a != b)
+        {
+            fprintf(stderr, "unmask mismatch: offset %zu length %zu\n", offset, n);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr, "unmask implementation: %s\n", WebSocketFrame::unmaskImplementation());
+    const size_t sizes[] = { 16, 125, 1024, 16 * 1024, 1024 * 1024 };
+    for (size_t size : sizes)
+    {
+        std::vector<char> data(size + 1, 'x');
+        size_t rounds = (512u * 1024 * 1024) / size; // 每种实现处理512MB
+        double gbps[2];
+        for (int impl = 0; impl < 2; ++impl)
+        {
+            Timestamp start = Timestamp::now();
+            for (size_t r = 0; r < rounds; ++r)
+            {
+                if (impl == 0)
+                {
+                    WebSocketFrame::unmaskPortable(&data[1], size, key); // 从奇数地址开始 和真实的payload一样不对齐
+                }
+                else
+                {
+                    WebSocketFrame::unmask(&data[1], size, key);
+                }
+            }
+            gbps[impl] = static_cast<double>(rounds) * size / timeDifference(Timestamp::now(), start) / 1e9;
+        }
+        fprintf(stderr, "unmask %7zu bytes: scalar %6.2f GB/s, %s %6.2f GB/s (%.1fx)\n",
+                size, gbps[0], WebSocketFrame::unmaskImplementation(), gbps[1], gbps[1] / gbps[0]);
+    }
+}
+
+
+// 客户端: 握手后一批批发送带掩码的帧 解析服务端发回的不带掩码的帧
+class Client
+{
+public:
+    Client(EventLoop* loop, int id, const std::string& batch, int batchMessages)
+        : client_(loop, InetAddress(kPort), "ws_client" + std::to_string(id))
+        , batch_(batch)
+        , batchMessages_(batchMessages)
+        , upgraded_(false)
+        , running_(true)
+        , outstanding_(0)
+        , received_(0)
+    {
+        client_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+            if (conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                conn->send("GET /echo HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                           "Sec-WebSocket-Version: 13\r\n\r\n");
+            }
+        });
+        client_.setMessageCallback(std::bind(&Client::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { client_.connect(); }
+    void stop() { running_ = false; client_.disconnect(); }
+    long received() const { return received_; }
+    bool upgraded() const { return upgraded_; }
+
+private:
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        if (!upgraded_)
+        {
+            const char* end = static_cast<const char*>(::memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4));
+            if (end == nullptr)
+            {
+                return;
+            }
+            if (::strncmp(buf->peek(), "HTTP/1.1 101", 12) != 0)
+            {
+                fprintf(stderr, "handshake failed: %s\n", std::string(buf->peek(), end).c_str());
+                conn->shutdown();
+                return;
+            }
+            buf->retrieve(end + 4 - buf->peek());
+            upgraded_ = true;
+            sendBatch(conn);
+        }
+
+        while (buf->readableBytes() >= 2)
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+            size_t length = p[1] & 0x7F;
+            size_t headerLen = 2;
+            if (length == 126)
+            {
+                if (buf->readableBytes() < 4) break;
+                uint16_t be16;
+                ::memcpy(&be16, p + 2, sizeof be16);
+                length = be16toh(be16);
+                headerLen = 4;
+            }
+            else if (length == 127)
+            {
+                if (buf->readableBytes() < 10) break;
+                uint64_t be64;
+                ::memcpy(&be64, p + 2, sizeof be64);
+                length = static_cast<size_t>(be64toh(be64));
+                headerLen = 10;
+            }
+            if (buf->readableBytes() < headerLen + length)
+            {
+                break;
+            }
+            buf->retrieve(headerLen + length);
+            ++received_;
+            if (--outstanding_ == 0)
+            {
+                sendBatch(conn);
+            }
+        }
+    }
+
+    void sendBatch(const TcpConnectionPtr& conn)
+    {
+        if (running_)
+        {
+            conn->send(batch_);
+            outstanding_ = batchMessages_;
+        }
+    }
+
+    TcpClient client_;
+    const std::string& batch_;
+    const int batchMessages_;
+    bool upgraded_;
+    bool running_;
+    int outstanding_;
+    long received_;
+};
+
+
+// 一批带掩码的客户端帧
+static std::string makeBatch(size_t messageBytes, int messages)
+{
+    const char key[4] = { 0x12, 0x34, 0x56, 0x78 };
+    std::string payload(messageBytes, 'w');
+    WebSocketFrame::unmask(&payload[0], payload.size(), key); // 异或是对称的 加掩码和解掩码是同一个操作
+
+    char header[WebSocketFrame::kMaxHeaderLen];
+    size_t headerLen = WebSocketFrame::encodeHeader(header, WebSocketFrame::kBinary, messageBytes);
+    header[1] |= static_cast<char>(0x80); // MASK位
+    ::memcpy(header + headerLen, key, 4);
+    headerLen += 4;
+
+    std::string batch;
+    for (int i = 0; i < messages; ++i)
+    {
+        batch.append(header, headerLen);
+        batch.append(payload);
+    }
+    return batch;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int clients = argc > 1 ? atoi(argv[1]) : 10;
+    size_t messageBytes = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 64;
+    double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    int ioThreads = argc > 4 ? atoi(argv[4]) : 2;
+    ::signal(SIGPIPE, SIG_IGN);
+
+    benchUnmask();
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::unique_ptr<WebSocketServer> server(new WebSocketServer(serverLoop, InetAddress(kPort), "websocket_bench"));
+    server->setThreadNum(ioThreads);
+    server->setMessageCallback([](const TcpConnectionPtr& conn, const StringPiece& message, bool binary, Timestamp) {
+        WebSocketServer::send(conn, message, binary);
+    });
+    serverLoop->runInLoop([&server]() { server->start(); });
+
+    const int kBatch = 16;
+    std::string batch = makeBatch(messageBytes, kBatch);
+    EventLoop loop;
+    std::vector<std::unique_ptr<Client>> all;
+    for (int i = 0; i < clients; ++i)
+    {
+        all.emplace_back(new Client(&loop, i, batch, kBatch));
+    }
+
+    Timestamp start;
+    loop.runAfter(0.1, [&]() { // 等服务端开始监听
+        start = Timestamp::now();
+        for (auto& c : all) c->start();
+    });
+    loop.runAfter(0.1 + seconds, [&]() {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        long received = 0;
+        int upgraded = 0;
+        for (auto& c : all)
+        {
+            received += c->received();
+            upgraded += c->upgraded() ? 1 : 0;
+            c->stop();
+        }
+        fprintf(stderr, "echo: %d/%d clients upgraded, message %zu bytes, %d io threads, pipeline %d\n",
+                upgraded, clients, messageBytes, ioThreads, kBatch);
+        fprintf(stderr, "echo: %.0f msg/s, %.1f MB/s each way\n",
+                received / elapsed, received * static_cast<double>(messageBytes) / elapsed / (1024 * 1024));
+        loop.runAfter(0.2, [&]() { // 等服务端处理完断开的连接
+            serverLoop->runInLoop([&server]() { server.reset(); }); // 在服务端loop线程中析构
+            loop.runAfter(0.1, [&]() { loop.quit(); });
+        });
+    });
+    loop.loop();
+    return 0;
+}
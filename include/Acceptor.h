@@ -1,6 +1,8 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <string>
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
@@ -33,6 +35,9 @@ public:
 private:
     // 处理新用户的连接事件
     void handleRead(); 
+    // 内存预算紧张时暂停accept  解除后恢复
+    void pauseAccepting();
+    void resumeAccepting();
 
     EventLoop* loop_; // Acceptor用的就是用户定义的那个baseLoop，也就是mainLoop
 
@@ -42,5 +47,8 @@ private:
     NewConnectionCallback NewConnectionCallback_; // 新连接的回调函数，由外部设置
 
     bool listenning_; // 是否在监听
+    bool paused_;     // 是否因内存预算紧张暂停了accept (新连接留在内核的全连接队列中)
+    std::shared_ptr<bool> alive_; // 解除回调通过weak_ptr判断Acceptor是否已析构
+    std::string unixPath_;        // 监听Unix域套接字时bind创建的文件 析构时删除
 
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+/**
+ * 异步日志后端 (双缓冲)
+ *
+ * 前端(IO线程)调用append，只把日志行拷贝进内存中的currentBuffer_，不做任何IO
+ * 后端线程把写满的缓冲区成批写入文件，前后端只在交换缓冲区时短暂持锁
+ *
+ *   currentBuffer_  前端正在写的缓冲区
+ *   nextBuffer_     预备缓冲区 currentBuffer_写满时直接换上，不用在前端分配内存
+ *   buffers_        写满待写入文件的缓冲区
+ *
+ * - 后端线程至少每flushInterval秒醒来一次，把未写满的currentBuffer_也写出并fflush，
+ *   进程崩溃时最多丢失这段时间内的日志
+ * - 前端写得过快、积压超过kMaxPendingBuffers个缓冲区时丢弃多余的日志，避免内存无限增长
+ * - rollSize>0 时写入按大小和日期滚动的文件 basename.YYYYmmdd-HHMMSS.hostname.pid.log (见LogFile)，
+ *   fdatasync 也由后端线程每fsyncInterval秒做一次；rollSize为0时直接追加到basename
+ *
+ * 用法:
+ *   AsyncLogging log("/var/log/server", 3, 512 * 1024 * 1024);
+ *   log.start();
+ *   Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+ *   Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log));
+ */
+
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string& basename,
+                 int flushInterval = 3,   // 后端fflush的间隔(秒)
+                 off_t rollSize = 0,      // 单个日志文件的大小上限 0表示不滚动
+                 int fsyncInterval = 10); // fdatasync的间隔(秒)
+    ~AsyncLogging();
+
+    // 前端写日志 线程安全
+    void append(const char* logline, size_t len);
+
+    // 阻塞等待此前append的日志全部写入文件 (如FATAL日志退出进程前)
+    void flush();
+
+    // 启动/停止后端线程  停止前append的日志都会写入文件
+    void start();
+    void stop();
+
+private:
+    // 后端线程函数
+    void threadFunc();
+
+    // 固定大小的日志缓冲区
+    class LogBuffer : noncopyable
+    {
+    public:
+        static const size_t kSize = 4 * 1024 * 1024; // 4MB
+
+        LogBuffer() : cur_(data_) { }
+
+        void append(const char* buf, size_t len)
+        {
+            if (avail() > len)
+            {
+                ::memcpy(cur_, buf, len);
+                cur_ += len;
+            }
+        }
+
+        const char* data() const { return data_; }
+        size_t length() const { return static_cast<size_t>(cur_ - data_); }
+        size_t avail() const { return static_cast<size_t>(data_ + kSize - cur_); }
+        void reset() { cur_ = data_; }
+
+    private:
+        char data_[kSize];
+        char* cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    static const size_t kMaxPendingBuffers = 25; // 积压的缓冲区超过该数量时丢弃
+
+    const int flushInterval_;     // 定期flush的间隔(秒)
+    const std::string basename_;
+    const off_t rollSize_;
+    const int fsyncInterval_;
+    std::atomic_bool running_;
+    Thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_;
+
+    // flush()请求  后端写完一轮后更新flushCompleted_
+    int64_t flushRequested_;
+    int64_t flushCompleted_;
+    std::condition_variable flushCond_;
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "noncopyable.h"
+#include "CurrentThread.h"
+
+class Thread;
+
+/**
+ * 二进制日志 (延迟格式化，类似NanoLog)
+ *
+ * 开启后LOG_DEBUG/INFO/ERROR不再在IO线程中snprintf，而是记录:
+ *   格式串id(每个调用点第一次执行时注册一次) + 时间戳 + tid + 原始参数
+ * 写入本线程独占的无锁环形缓冲区 (单生产者单消费者)，后台线程把各线程的记录连同格式串字典
+ * 写入文件，由离线工具 example/binlog_decode 还原成文本
+ *
+ * 文件格式 (小端):
+ *   "MUBLOG01"
+ *   'F' id:u32 level:i32 line:i32 fileLen:u32 file fmtLen:u32 fmt     格式串字典 出现在引用它的记录之前
+ *   'R' len:u32 id:u32 usec:i64 tid:i32 args...                       一条日志 len包含len字段本身
+ *   参数: 'i' i64 | 'd' double | 'p' u64 | 's' len:u32 bytes
+ *
+ * - 环形缓冲区满时丢弃记录并计数 (不阻塞IO线程)
+ * - 同一线程的记录保持顺序，不同线程的记录按后台线程的收集顺序交错
+ * - LOG_FATAL 仍然走文本日志
+ */
+
+class BinaryLogger : noncopyable
+{
+public:
+    static const size_t kMaxStringArg = 1024; // 字符串参数最多记录的字节数
+
+    static BinaryLogger& instance();
+
+    // 是否处于二进制日志模式  LOG_*宏据此选择路径
+    static bool active() { return s_active.load(std::memory_order_relaxed); }
+
+    // 开始写二进制日志到filename  ringBytes为每个线程环形缓冲区的大小
+    void start(const std::string& filename, size_t ringBytes = 1024 * 1024);
+    void stop();
+
+    // 注册调用点的格式串 返回id (每个调用点通过函数内static只注册一次)
+    static uint32_t registerFormat(int level, const char* file, int line, const char* fmt);
+
+    // 记录一条日志 (在当前线程的环形缓冲区中编码参数)
+    template <typename... Args>
+    static void record(uint32_t fmtId, Args... args)
+    {
+        const size_t size = kRecordHeader + argsSize(args...);
+        char* p = reserve(size);
+        if (p == nullptr)
+        {
+            return; // 缓冲区已满 丢弃
+        }
+
+        struct timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        int64_t usec = static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        uint32_t len = static_cast<uint32_t>(size);
+        int32_t tid = CurrentThread::tid();
+
+        p = put(p, len);
+        p = put(p, fmtId);
+        p = put(p, usec);
+        p = put(p, tid);
+        encodeArgs(p, args...);
+        commit(size);
+    }
+
+    // 因缓冲区满而丢弃的记录数 (所有线程)
+    uint64_t droppedRecords() const { return dropped_.load(); }
+
+private:
+    // 每个线程一个单生产者单消费者环形缓冲区  位置单调递增，取模得到下标
+    struct Ring
+    {
+        explicit Ring(size_t cap)
+            : data(new char[cap]), capacity(cap), head(0), tail(0), retired(false)
+        {
+            ::memset(data.get(), 0, cap); // 预先触碰所有页 热路径上不再产生缺页
+        }
+
+        std::unique_ptr<char[]> data;
+        const size_t capacity;
+        std::atomic<uint64_t> head; // 生产者写到的位置
+        std::atomic<uint64_t> tail; // 消费者读到的位置
+        std::atomic_bool retired;   // 所属线程已退出 读空后由后台线程释放
+    };
+
+    static const size_t kRecordHeader = 4 + 4 + 8 + 4; // len id usec tid
+
+    BinaryLogger();
+    ~BinaryLogger();
+
+    static char* reserve(size_t size); // 在本线程的缓冲区中预留连续的size字节 失败返回nullptr
+    static void commit(size_t size);
+    static Ring* threadRing(); // 线程退出阶段(ring已交出)返回nullptr
+
+    void threadFunc();
+    bool drainRings(std::string* out); // 收集所有线程的记录 返回是否有数据
+    void writeFormats(std::string* out);
+
+    template <typename T>
+    static char* put(char* p, T value)
+    {
+        ::memcpy(p, &value, sizeof value);
+        return p + sizeof value;
+    }
+
+    // 参数编码长度
+    static size_t stringSize(const char* s)
+    {
+        size_t len = s ? ::strnlen(s, kMaxStringArg) : 0;
+        return 1 + 4 + len;
+    }
+    static size_t argSize(const char* s)        { return stringSize(s); }
+    static size_t argSize(char* s)              { return stringSize(s); }
+    static size_t argSize(const std::string& s) { return 1 + 4 + (s.size() < kMaxStringArg ? s.size() : kMaxStringArg); }
+    template <typename T>
+    static size_t argSize(T) { return 1 + 8; } // 整数 浮点 指针
+
+    static size_t argsSize() { return 0; }
+    template <typename T, typename... Rest>
+    static size_t argsSize(const T& first, const Rest&... rest) { return argSize(first) + argsSize(rest...); }
+
+    // 参数编码
+    static char* encodeString(char* p, const char* s, size_t len)
+    {
+        *p++ = 's';
+        p = put(p, static_cast<uint32_t>(len));
+        ::memcpy(p, s, len);
+        return p + len;
+    }
+    static char* encodeArg(char* p, const char* s) { return encodeString(p, s, s ? ::strnlen(s, kMaxStringArg) : 0); }
+    static char* encodeArg(char* p, char* s)       { return encodeArg(p, static_cast<const char*>(s)); }
+    static char* encodeArg(char* p, const std::string& s)
+    {
+        return encodeString(p, s.data(), s.size() < kMaxStringArg ? s.size() : kMaxStringArg);
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, char*>::type
+    encodeArg(char* p, T value)
+    {
+        *p++ = 'i';
+        return put(p, static_cast<int64_t>(value));
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, char*>::type
+    encodeArg(char* p, T value)
+    {
+        *p++ = 'd';
+        return put(p, static_cast<double>(value));
+    }
+    template <typename T>
+    static char* encodeArg(char* p, T* value)
+    {
+        *p++ = 'p';
+        return put(p, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    }
+
+    static void encodeArgs(char*) { }
+    template <typename T, typename... Rest>
+    static void encodeArgs(char* p, const T& first, const Rest&... rest)
+    {
+        encodeArgs(encodeArg(p, first), rest...);
+    }
+
+    // 格式串字典
+    struct Format
+    {
+        int level;
+        int line;
+        std::string file;
+        std::string fmt;
+    };
+
+    static std::atomic_bool s_active;
+
+    std::mutex mutex_;               // 保护formats_ rings_
+    std::vector<Format> formats_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    size_t formatsWritten_;          // 已写入当前文件的字典项数 (只在后台线程中访问)
+    size_t ringBytes_;
+
+    std::atomic<uint64_t> dropped_;
+    std::atomic_bool running_;
+    std::string filename_;
+    std::unique_ptr<Thread> thread_;
+};
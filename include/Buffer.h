@@ -4,6 +4,12 @@
 #include <string>
 #include <algorithm>
 #include <stddef.h> // 定义size_t类型
+#include <stdint.h>
+#include <string.h> // memcpy
+#include <endian.h> // htobe32 be32toh 等字节序转换
+#include <assert.h>
+
+#include "MemoryBudget.h"
 
 /* 网络库底层的缓冲区类型定义 */
 
@@ -19,8 +25,42 @@ public:
         : buffer_(kCheapPrepend + initialSize) // 分配缓冲区大小 = prepend预留 + initialSize
         , readerIndex_(kCheapPrepend) // 可读 可写指针初始设置在有效数据的起始
         , writerIndex_(kCheapPrepend) 
+        , charged_(0)
     {
         // 初始化时分配(kCheapPrepend + initalSize)的空间，读写位置都从kCheapPrepend开始
+        recharge();
+    }
+
+    // 拷贝/移动/析构都要同步占用的内存预算 (MemoryBudget)
+    Buffer(const Buffer& rhs)
+        : buffer_(rhs.buffer_)
+        , readerIndex_(rhs.readerIndex_)
+        , writerIndex_(rhs.writerIndex_)
+        , charged_(0)
+    {
+        recharge();
+    }
+
+    // 移动后rhs成为只有预留区的空缓冲区，仍然可以继续使用
+    Buffer(Buffer&& rhs)
+        : buffer_(kCheapPrepend)
+        , readerIndex_(kCheapPrepend)
+        , writerIndex_(kCheapPrepend)
+        , charged_(0)
+    {
+        recharge();
+        swap(rhs);
+    }
+
+    Buffer& operator=(Buffer rhs) // 拷贝/移动赋值  旧内容随rhs析构释放
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    ~Buffer()
+    {
+        MemoryBudget::charge(-static_cast<int64_t>(charged_));
     }
 
 
@@ -41,6 +81,8 @@ public:
 
     // 获取当前可读数据的起始地址
     const char* peek() const { return begin() + readerIndex_; }
+    // 原地修改可读数据 (如WebSocket解掩码)
+    char* mutablePeek() { return begin() + readerIndex_; }
 
 
     // 从缓冲区中读取len长度的数据（仅移动readerIndex_，不拷贝数据）
@@ -65,6 +107,57 @@ public:
         writerIndex_ = kCheapPrepend;
     }
 
+    // 整数读写  均为网络字节序 (大端)，用memcpy避免未对齐访问
+    // peekIntXX 只读不移动readerIndex_，readIntXX 读出并移动，要求可读字节足够
+    int64_t peekInt64() const
+    {
+        assert(readableBytes() >= sizeof(int64_t));
+        uint64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof be64);
+        return static_cast<int64_t>(be64toh(be64));
+    }
+    int32_t peekInt32() const
+    {
+        assert(readableBytes() >= sizeof(int32_t));
+        uint32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof be32);
+        return static_cast<int32_t>(be32toh(be32));
+    }
+    int16_t peekInt16() const
+    {
+        assert(readableBytes() >= sizeof(int16_t));
+        uint16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof be16);
+        return static_cast<int16_t>(be16toh(be16));
+    }
+    int8_t peekInt8() const
+    {
+        assert(readableBytes() >= sizeof(int8_t));
+        return static_cast<int8_t>(*peek());
+    }
+
+    int64_t readInt64() { int64_t x = peekInt64(); retrieve(sizeof x); return x; }
+    int32_t readInt32() { int32_t x = peekInt32(); retrieve(sizeof x); return x; }
+    int16_t readInt16() { int16_t x = peekInt16(); retrieve(sizeof x); return x; }
+    int8_t readInt8()   { int8_t x = peekInt8(); retrieve(sizeof x); return x; }
+
+    void appendInt64(int64_t x) { uint64_t be64 = htobe64(static_cast<uint64_t>(x)); append(reinterpret_cast<const char*>(&be64), sizeof be64); }
+    void appendInt32(int32_t x) { uint32_t be32 = htobe32(static_cast<uint32_t>(x)); append(reinterpret_cast<const char*>(&be32), sizeof be32); }
+    void appendInt16(int16_t x) { uint16_t be16 = htobe16(static_cast<uint16_t>(x)); append(reinterpret_cast<const char*>(&be16), sizeof be16); }
+    void appendInt8(int8_t x)   { append(reinterpret_cast<const char*>(&x), sizeof x); }
+
+    // 把数据放到可读数据之前 (使用prepend预留区，如消息组装完后再补长度头)  len不能超过prependableBytes()
+    void prepend(const void* data, size_t len)
+    {
+        assert(len <= prependableBytes());
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+    }
+    void prependInt64(int64_t x) { uint64_t be64 = htobe64(static_cast<uint64_t>(x)); prepend(&be64, sizeof be64); }
+    void prependInt32(int32_t x) { uint32_t be32 = htobe32(static_cast<uint32_t>(x)); prepend(&be32, sizeof be32); }
+    void prependInt16(int16_t x) { uint16_t be16 = htobe16(static_cast<uint16_t>(x)); prepend(&be16, sizeof be16); }
+    void prependInt8(int8_t x)   { prepend(&x, sizeof x); }
+
     // 以string形式返回指定长度的数据，并移动readerIndex_
     std::string retrieveAsString(size_t len)
     {
@@ -95,6 +188,9 @@ public:
     char* beginWrite() { return begin() + writerIndex_; }
     const char* beginWrite() const { return begin() + writerIndex_; }
 
+    // 直接写入beginWrite()之后 更新writerIndex_ (len不能超过writableBytes())
+    void hasWritten(size_t len) { writerIndex_ += len; }
+
 
     // 把外部内存[data, data+len]上的数据添加到writable缓冲区末尾（自动扩容）
     void append(const char* data, size_t len)
@@ -106,6 +202,28 @@ public:
     }
 
 
+    // 交换两个缓冲区的内容 (只交换内部指针，不拷贝数据)
+    void swap(Buffer& rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(charged_, rhs.charged_);
+    }
+
+
+    // 释放多余的容量 只保留可读数据 + reserve字节可写空间 (内存紧张时回收空闲连接的大缓冲区)
+    void shrink(size_t reserve)
+    {
+        Buffer other(readableBytes() + reserve);
+        other.append(peek(), readableBytes());
+        swap(other);
+    }
+
+    // 实际占用的内存
+    size_t internalCapacity() const { return buffer_.capacity(); }
+
+
     // fd上读数据到buffer  fd --> buffer
     ssize_t readFd(int fd, int* saveErrno);
     // buffer向fd写数据    buffer --> fd
@@ -131,6 +249,7 @@ private:
         if (writableBytes() + prependableBytes() < len + kCheapPrepend) // 即len > 已读 + writer的部分
         {
             buffer_.resize(writerIndex_ + len); // 扩大缓冲区容量
+            recharge();
         }
         else // len <= 已读 + writer  空间够 只需将已有未读数据前移到kCheapPrepend
         {
@@ -147,9 +266,21 @@ private:
         }
     }
 
+    // 把容量变化记到内存预算上
+    void recharge()
+    {
+        size_t capacity = buffer_.capacity();
+        if (capacity != charged_)
+        {
+            MemoryBudget::charge(static_cast<int64_t>(capacity) - static_cast<int64_t>(charged_));
+            charged_ = capacity;
+        }
+    }
+
     std::vector<char> buffer_; // 实际缓冲区
     size_t readerIndex_; // 可读的起始位置
     size_t writerIndex_; // 可写的起始位置
+    size_t charged_;     // 已记入内存预算的字节数
 
 
 };
\ No newline at end of file
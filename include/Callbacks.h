@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <functional>
+#include <string>
 
 class Buffer;
 class TcpConnection;
@@ -14,10 +15,17 @@ class Timestamp;
  // 管理连接对象的生命周期，保证Tcp连接在使用期间不被销毁
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>; 
 
+// 不可变的引用计数数据块，发送时可以只持有引用而不拷贝 (如零拷贝发送需要在内核确认前一直保活)
+using SharedPayload = std::shared_ptr<const std::string>;
+
 using ConnectionCallback    = std::function<void (const TcpConnectionPtr&)>; // 连接建立或断开时的回调类型
 using CloseCallback         = std::function<void (const TcpConnectionPtr&)>; // 连接关闭时的回调类型
 using WriteCompleteCallback = std::function<void (const TcpConnectionPtr&)>; // 数据写入完成时的回调类型
  
+using FileCompleteCallback  = std::function<void (const TcpConnectionPtr&, bool completed)>; // sendFile的文件段发完(completed=true)或被放弃(false)后的回调
+ 
 using HighWaterMarkCallback = std::function<void (const TcpConnectionPtr&, size_t)>; // 高水位标记回调类型（流量控制，当输出缓冲区数据量超过设定的阈值时触发）
 
-using MessageCallback       = std::function<void (const TcpConnectionPtr&, Buffer*, Timestamp)>; // 消息到达时的回调类型
\ No newline at end of file
+using MessageCallback       = std::function<void (const TcpConnectionPtr&, Buffer*, Timestamp)>; // 消息到达时的回调类型
+
+using TimerCallback         = std::function<void ()>; // 定时器到期时的回调类型
\ No newline at end of file
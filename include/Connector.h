@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+class Channel;
+class EventLoop;
+
+/**
+ * 主动发起连接  TcpClient的组成部分 (对应服务端的Acceptor)
+ *
+ * 非阻塞connect => 连接中的socket注册到Channel监听可写 => 可写时用SO_ERROR检查连接结果
+ * 成功后把sockfd交给newConnectionCallback (由TcpClient创建TcpConnection)，Connector不再管理该fd
+ * 失败(拒绝连接、超时、自连接等)后关闭socket，按指数退避重试：
+ * 间隔从initRetryDelay开始每次翻倍，最大maxRetryDelay，直到stop()或连接成功 (成功后间隔复位)
+ *
+ * start/stop 线程安全  restart只能在loop线程中调用
+ */
+
+class Connector : noncopyable,
+                  public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void (int sockfd)>;
+
+    static const int kInitRetryDelayMs = 500;       // 首次重试间隔
+    static const int kMaxRetryDelayMs = 30 * 1000;  // 最大重试间隔
+
+    Connector(EventLoop* loop, const InetAddress& serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback& cb) { newConnectionCallback_ = cb; }
+    // 设置重试间隔 需在start之前调用
+    void setRetryDelay(int initMs, int maxMs);
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+    void start();   // 开始连接 线程安全
+    void restart(); // 连接断开后重新连接 (重试间隔复位) 只能在loop线程中调用
+    void stop();    // 停止连接和重试 线程安全
+
+private:
+    enum States
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+    };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd); // connect进行中 等待可写
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);      // 关闭sockfd 定时重连
+    int removeAndResetChannel(); // 不再监听sockfd 返回sockfd
+    void resetChannel();
+
+    EventLoop* loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;       // 用户是否要求连接 (stop后为false)
+    States state_;
+    std::unique_ptr<Channel> channel_; // 连接中的socket对应的Channel 只在kConnecting状态存在
+    NewConnectionCallback newConnectionCallback_;
+    int initRetryDelayMs_;
+    int maxRetryDelayMs_;
+    int retryDelayMs_;               // 下一次重试的间隔
+    TimerId retryTimer_;             // 等待中的重试定时器
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * CRC32C (Castagnoli 多项式 0x1EDC6F41)  用于消息帧/日志记录的完整性校验
+ *
+ * x86-64上CPU支持SSE4.2时使用crc32指令 (每条指令处理8字节)，否则回退到查表 (slicing-by-8)
+ * 实现在首次使用前按CPU特性选定一次 (运行时分派)，同一二进制可以跑在不支持SSE4.2的机器上
+ */
+
+namespace Crc32c
+{
+    // 在已有的crc上继续计算data  extend(extend(0, a), b) == value(a + b)
+    uint32_t extend(uint32_t crc, const char* data, size_t n);
+
+    inline uint32_t value(const char* data, size_t n) { return extend(0, data, n); }
+
+    // 当前是否使用SSE4.2硬件指令
+    bool hardwareAccelerated();
+}
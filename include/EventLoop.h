@@ -9,9 +9,12 @@
 #include "noncopyable.h"
 #include "Timestamp.h"                                       
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 
 /**
@@ -36,6 +39,8 @@ public:
 
 
     // 返回上一次 poller_->poll()的返回时间
+    // 即本轮循环缓存的"当前时间"：epoll_wait返回后读一次时钟，本轮的事件回调都以它为接收时间
+    // loop线程中不要求精确到当前时刻的地方(如统计、超时判断)可以直接用它，不必再读时钟
     Timestamp pollReturnTime () const   { return pollReturnTime_; }
 
     // 在当前loop中执行回调
@@ -43,6 +48,16 @@ public:
     // 把上层注册的回调函数cb放入队列中，唤醒loop所在的线程执行cb
     void queueInLoop(Functor cb);
 
+    // 在本轮循环的末尾(处理完活跃Channel和pendingFunctors_之后、下一次poll之前)执行cb
+    // 用于把一轮循环里的多次操作合并成一次 (如TcpConnection的延迟flush)
+    void runAtIterationEnd(Functor cb);
+
+    // 定时器  回调在loop线程中执行  线程安全
+    TimerId runAt(Timestamp time, TimerCallback cb);        // 在time时刻执行cb
+    TimerId runAfter(double delay, TimerCallback cb);       // delay秒后执行cb
+    TimerId runEvery(double interval, TimerCallback cb);    // 每interval秒执行一次cb
+    void cancel(TimerId timerId);                           // 取消定时器 (已到期的一次性定时器取消无副作用)
+
     // 通过eventfd唤醒loop所在的线程
     void wakeup();
 
@@ -62,6 +77,8 @@ private:
 
     // 执行上层回调
     void doPendingFunctors();
+    // 执行本轮循环末尾的回调
+    void doIterationEndFunctors();
 
 
     using ChannelList = std::vector<Channel*>; // 当前活动的事件channel集合
@@ -73,6 +90,7 @@ private:
 
     Timestamp pollReturnTime_;       // Poller返回发生事件的Channels的时间点
     std::unique_ptr<Poller> poller_; // 使用 RAII 管理的 IO 多路复用器
+    std::unique_ptr<TimerQueue> timerQueue_; // 定时器队列 (timerfd)  声明在poller_之后，先于poller_析构(析构时要从poller_移除Channel)
  
     int wakeupFd_; // 当mainLoop获取一个新用户的Channel，需通过轮询算法选择一个subLoop，通过该成员唤醒subLoop处理Channel
     std::unique_ptr<Channel> wakeupChannel_; // 封装 wakeupFd_ 并监听其可读事件
@@ -84,4 +102,6 @@ private:
     
     std::mutex mutex_; // 互斥锁 用来保护上面vector容器的线程安全操作
 
+    std::vector<Functor> iterationEndFunctors_; // 本轮循环末尾执行的回调 只在loop线程访问，不需要加锁
+
 };
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <time.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+
+class EventLoop;
+
+/**
+ * 静态文件缓存  建立在 TcpConnection::send / sendFile 之上
+ *
+ * - LRU 缓存已打开的文件描述符和元数据(大小 mtime)，避免每个请求都 open/fstat/close
+ * - 小文件(<= smallFileLimit)第一次访问时读入内存并关闭fd，之后直接从内存发送
+ * - 大文件通过 sendfile 发送，打开时设置 POSIX_FADV_SEQUENTIAL，发送前 POSIX_FADV_WILLNEED 预读
+ * - 缓存项每隔 revalidateInterval 秒重新 stat 一次，文件被修改后自动重新打开
+ *
+ * one loop per thread：每个 EventLoop 一个 FileCache (如在 ThreadInitCallback 中创建)，只在该loop线程中使用，无需加锁
+ * 被淘汰的缓存项如果还有正在发送的文件段，fd 会在最后一个文件段发完后才关闭
+ */
+
+class FileCache : noncopyable
+{
+public:
+    static const size_t kWholeFile = static_cast<size_t>(-1);
+
+    FileCache(EventLoop* loop,
+              size_t maxEntries = 1024,           // 最多缓存的文件数 (即最多占用的fd数)
+              size_t smallFileLimit = 64 * 1024); // 不超过该大小的文件缓存在内存中
+    ~FileCache();
+
+    // 把文件 [offset, offset+count) 发送给conn  count为kWholeFile表示到文件末尾
+    // 返回false表示文件不存在或无法打开 (调用方负责返回404之类的响应)
+    bool send(const TcpConnectionPtr& conn, const std::string& path,
+              off_t offset = 0, size_t count = kWholeFile);
+
+    // 查询文件元数据 (命中缓存时不产生系统调用)  用于生成Content-Length/Last-Modified
+    bool stat(const std::string& path, size_t* size, time_t* mtime);
+
+    // 删除所有缓存项
+    void clear();
+
+    void setRevalidateInterval(int seconds) { revalidateInterval_ = seconds; }
+
+    // 统计
+    size_t hits() const        { return hits_; }
+    size_t misses() const      { return misses_; }
+    size_t evictions() const   { return evictions_; }
+    size_t bytesServed() const { return bytesServed_; }   // 通过该缓存发送的总字节数
+    size_t size() const        { return index_.size(); }  // 当前缓存项数
+    double hitRate() const
+    {
+        return (hits_ + misses_) == 0 ? 0.0 : static_cast<double>(hits_) / (hits_ + misses_);
+    }
+
+private:
+    // 缓存项 析构时关闭fd (内存中的小文件fd为-1)
+    struct Entry : noncopyable
+    {
+        Entry() : fd(-1), size(0), mtime(0), checkedAt(0) { }
+        ~Entry();
+
+        std::string path;
+        int fd;
+        size_t size;
+        time_t mtime;
+        time_t checkedAt;      // 上次stat的时间
+        SharedPayload content; // 小文件的内存副本
+    };
+    using EntryPtr = std::shared_ptr<Entry>;
+    using EntryList = std::list<EntryPtr>; // 表头最近使用
+
+    // 查找缓存项  未命中或已过期时打开文件
+    EntryPtr lookup(const std::string& path);
+    EntryPtr openEntry(const std::string& path);
+    void evict();
+
+    EventLoop* loop_;
+    const size_t maxEntries_;
+    const size_t smallFileLimit_;
+    int revalidateInterval_;
+
+    EntryList lru_;
+    std::unordered_map<std::string, EntryList::iterator> index_;
+
+    size_t hits_;
+    size_t misses_;
+    size_t evictions_;
+    size_t bytesServed_;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Timestamp.h"
+
+class Buffer;
+
+/**
+ * 每个HTTP连接的解析状态  增量解析，直接在输入Buffer上工作
+ *
+ * 解析过程中只记录相对 buf->peek() 的偏移，请求完整之前不取走任何数据：
+ * 等待body期间Buffer扩容/搬移不会让已解析的头部失效
+ * 请求完整后才把偏移换成StringPiece切片填进HttpRequest，处理完再finishRequest()取走
+ * chunked编码的body需要去掉分块头，解码到body_中 (容量复用)
+ */
+
+class HttpContext
+{
+public:
+    enum ParseResult
+    {
+        kNeedMore,   // 数据不完整 等待更多数据
+        kGotRequest, // request()可用  处理完后调用finishRequest
+        kError,      // 请求非法 errorCode()为应答状态码 连接应关闭
+    };
+
+    HttpContext(size_t maxHeaderBytes, size_t maxBodyBytes);
+
+    ParseResult parse(Buffer* buf, Timestamp receiveTime);
+    const HttpRequest& request() const { return request_; }
+    HttpResponse::StatusCode errorCode() const { return errorCode_; }
+
+    // 从输入缓冲区取走刚处理完的请求 (取走后切片指向的内存在下次写入缓冲区前仍然有效)
+    void finishRequest(Buffer* buf);
+
+    // 头部带 Expect: 100-continue 且body还没收到时返回true (每个请求只返回一次)
+    bool takeExpectContinue();
+
+    // 一批流水线请求的应答  复用对象避免重复分配
+    HttpResponse* nextResponse();
+    size_t responseCount() const { return responseCount_; }
+    HttpResponse* response(size_t i) { return &responses_[i]; }
+    void clearResponses() { responseCount_ = 0; }
+    std::vector<StringPiece>* pieces() { return &pieces_; }
+
+private:
+    enum State
+    {
+        kExpectHeaders,
+        kExpectBody,      // Content-Length
+        kExpectChunkSize,
+        kExpectChunkData,
+        kExpectTrailer,
+    };
+
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+    struct HeaderRange
+    {
+        Range name;
+        Range value;
+    };
+
+    ParseResult parseHeaders(const char* base, size_t headerBytes);
+    ParseResult parseChunks(const char* base, size_t readable);
+    ParseResult fail(HttpResponse::StatusCode code);
+    ParseResult complete(const char* base, size_t consumed);
+    static StringPiece slice(const char* base, Range r) { return StringPiece(base + r.offset, r.length); }
+
+    const size_t maxHeaderBytes_;
+    const size_t maxBodyBytes_;
+
+    State state_;
+    size_t scanned_;       // 查找头部结束标记时已扫描过的字节数
+    size_t headerBytes_;   // 请求行+头部 (含空行) 的长度
+    size_t contentLength_;
+    size_t chunkPos_;      // 下一个待解析的分块位置 (相对peek)
+    size_t chunkRemaining_;
+    size_t consumed_;      // 当前完整请求占用的字节数
+    bool expectContinue_;
+    HttpResponse::StatusCode errorCode_;
+
+    HttpRequest::Method method_;
+    HttpRequest::Version version_;
+    Range path_;
+    Range query_;
+    std::vector<HeaderRange> headerRanges_;
+    std::string chunkedBody_;
+
+    HttpRequest request_;
+
+    std::vector<HttpResponse> responses_;
+    size_t responseCount_;
+    std::vector<StringPiece> pieces_;
+};
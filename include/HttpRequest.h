@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <strings.h> // strncasecmp
+
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+/**
+ * HTTP请求  由HttpContext解析得到
+ *
+ * path/query/头部/body都是指向连接输入缓冲区的切片，不拷贝、不为每个头部分配内存
+ * 只在HttpServer的回调期间有效，需要保留时用as_string()拷贝
+ */
+
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid, kGet, kPost, kHead, kPut, kDelete, kOptions, kPatch
+    };
+    enum Version
+    {
+        kUnknown, kHttp10, kHttp11
+    };
+
+    // 一个头部  name保持原样大小写
+    struct Header
+    {
+        StringPiece name;
+        StringPiece value;
+    };
+
+    HttpRequest()
+        : method_(kInvalid)
+        , version_(kUnknown)
+        , chunked_(false)
+    {
+    }
+
+    Method method() const { return method_; }
+    const char* methodString() const
+    {
+        static const char* names[] = { "UNKNOWN", "GET", "POST", "HEAD", "PUT", "DELETE", "OPTIONS", "PATCH" };
+        return names[method_];
+    }
+    Version version() const { return version_; }
+
+    StringPiece path() const  { return path_; }
+    StringPiece query() const { return query_; } // 不含'?'
+
+    // 查找头部 (不区分大小写)  不存在时返回空切片
+    StringPiece getHeader(const StringPiece& field) const
+    {
+        for (const Header& h : headers_)
+        {
+            if (h.name.size() == field.size() && ::strncasecmp(h.name.data(), field.data(), field.size()) == 0)
+            {
+                return h.value;
+            }
+        }
+        return StringPiece();
+    }
+    const std::vector<Header>& headers() const { return headers_; }
+
+    StringPiece body() const { return body_; }
+    bool chunked() const { return chunked_; } // body是否以chunked编码传输 (body()已经解码)
+
+    // HTTP/1.1默认长连接，除非Connection: close；HTTP/1.0只有Connection: keep-alive时保持
+    bool keepAlive() const
+    {
+        StringPiece connection = getHeader("Connection");
+        if (version_ == kHttp11)
+        {
+            return !(connection.size() == 5 && ::strncasecmp(connection.data(), "close", 5) == 0);
+        }
+        return connection.size() == 10 && ::strncasecmp(connection.data(), "keep-alive", 10) == 0;
+    }
+
+    Timestamp receiveTime() const { return receiveTime_; }
+
+private:
+    friend class HttpContext;
+
+    Method method_;
+    Version version_;
+    StringPiece path_;
+    StringPiece query_;
+    std::vector<Header> headers_; // 复用容量 稳定后不再分配
+    StringPiece body_;
+    bool chunked_;
+    Timestamp receiveTime_;
+};
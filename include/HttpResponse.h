@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "StringPiece.h"
+
+/**
+ * HTTP响应  由HttpServer的回调填写
+ *
+ * 响应头拼接在head_中，body单独保存，发送时 head_ + body 作为两段交给sendv，不再拼接
+ * 对象在同一连接上复用，clear()只清空内容保留容量，稳定后不再分配
+ */
+
+class HttpResponse
+{
+public:
+    enum StatusCode
+    {
+        kUnknown,
+        k100Continue = 100,
+        k101SwitchingProtocols = 101,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k400BadRequest = 400,
+        k404NotFound = 404,
+        k413PayloadTooLarge = 413,
+        k426UpgradeRequired = 426,
+        k431HeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+    };
+
+    explicit HttpResponse(bool close = false)
+        : statusCode_(kUnknown)
+        , closeConnection_(close)
+        , headOnly_(false)
+    {
+    }
+
+    void setStatusCode(StatusCode code) { statusCode_ = code; }
+    void setStatusMessage(const std::string& message) { statusMessage_ = message; } // 为空时按状态码取默认短语
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const StringPiece& contentType) { addHeader("Content-Type", contentType); }
+    // 追加头部  Content-Length和Connection由HttpResponse自己生成
+    void addHeader(const StringPiece& key, const StringPiece& value);
+
+    // body拷贝/移动到响应中
+    void setBody(std::string body) { body_.swap(body); bodyPiece_.clear(); }
+    std::string* mutableBody() { bodyPiece_.clear(); return &body_; }
+    // body引用外部内存 (不拷贝)  内存需在连接存活期间一直有效，如静态页面
+    void setBodyPiece(const StringPiece& body) { bodyPiece_ = body; body_.clear(); }
+    StringPiece body() const { return bodyPiece_.empty() ? StringPiece(body_) : bodyPiece_; }
+
+    void setHeadOnly(bool on) { headOnly_ = on; } // HEAD请求  只发送头部 (Content-Length仍为body长度)
+    bool headOnly() const { return headOnly_; }
+
+    // 生成状态行+头部到head_  返回要发送的头部
+    StringPiece buildHead();
+
+    void clear();
+
+private:
+    StatusCode statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    bool headOnly_;
+    std::string headers_; // 用户追加的头部 "Key: Value\r\n"...
+    std::string head_;    // 完整的状态行+头部
+    std::string body_;
+    StringPiece bodyPiece_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "TcpServer.h"
+#include "noncopyable.h"
+
+class HttpRequest;
+class HttpResponse;
+
+/**
+ * HTTP/1.x 服务器  基于TcpServer
+ *
+ * - 增量解析 (HttpContext)：请求的URI/头部/body都是输入缓冲区上的切片，不为每个头部分配内存
+ * - 流水线：一次读到的多个完整请求依次回调，所有应答收集起来用一次sendv (writev) 发出
+ * - 支持chunked请求体、keep-alive (HTTP/1.1默认，HTTP/1.0需Connection: keep-alive)、Expect: 100-continue
+ * - 应答 = 头部 + body 两段直接分散/聚集写出，不拼接
+ *
+ * 回调在连接所属的IO线程中执行，request只在回调期间有效
+ */
+
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void (const HttpRequest&, HttpResponse*)>;
+
+    static const size_t kDefaultMaxHeaderBytes = 64 * 1024;
+    static const size_t kDefaultMaxBodyBytes = 8 * 1024 * 1024;
+
+    HttpServer(EventLoop* loop,
+               const InetAddress& listenAddr,
+               const std::string& name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    EventLoop* getLoop() const { return loop_; }
+
+    // 默认回调对所有请求应答404
+    void setHttpCallback(const HttpCallback& cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    void setTlsContext(const TlsContextPtr& ctx) { server_.setTlsContext(ctx); } // HTTPS
+    // 请求头/请求体的大小上限  超过时应答431/413并关闭连接  需在start之前设置
+    void setMaxHeaderBytes(size_t bytes) { maxHeaderBytes_ = bytes; }
+    void setMaxBodyBytes(size_t bytes) { maxBodyBytes_ = bytes; }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    EventLoop* loop_;
+    TcpServer server_;
+    HttpCallback httpCallback_;
+    size_t maxHeaderBytes_;
+    size_t maxBodyBytes_;
+};
@@ -2,14 +2,22 @@
 
 #include <arpa/inet.h>  // 提供inet_pton和inet_ntop等函数，用于ip地址在字符串和二进制之间转换
 #include <netinet/in.h> // 定义sockaddr_in结构体 是IPv4 地址在 socket 编程中的表示方式
+#include <sys/un.h>     // sockaddr_un  Unix域套接字地址
 #include <string>
 
 /**
- * 封装IPv4套接字地址sockaddr_in
+ * 封装套接字地址  IPv4(sockaddr_in) / IPv6(sockaddr_in6) / Unix域(sockaddr_un)
+ *
+ * 三种地址放在同一个union中，getSockAddr()/getSockLen()直接交给bind/connect，
+ * 上层(Acceptor/Connector/TcpConnection/Buffer)不需要关心地址族
+ *
+ *   InetAddress(8080)                         IPv4 127.0.0.1:8080
+ *   InetAddress(8080, "::1")                  ip中含':'时为IPv6
+ *   InetAddress::fromUnixPath("/tmp/s.sock")  Unix域套接字 '@'开头表示抽象命名空间(不在文件系统中创建文件)
  */
 
 
-// 封装socket地址类型  将底层的 sockaddr_in 封装成 C++ 类，隐藏底层细节，提供易用的API
+// 封装socket地址类型  将底层的 sockaddr_* 封装成 C++ 类，隐藏底层细节，提供易用的API
 class InetAddress
 {
 public:
@@ -19,30 +27,59 @@ public:
 
     // 重载构造
     // 允许直接使用一个已有的 sockaddr_in 对象来构造 InetAddress 类实例
-    explicit InetAddress(const sockaddr_in &addr) 
-        : addr_(addr)
+    explicit InetAddress(const sockaddr_in &addr)
+        : addrLen_(sizeof addr)
     {
+        addr_ = addr;
+    }
 
+    explicit InetAddress(const sockaddr_in6 &addr6)
+        : addrLen_(sizeof addr6)
+    {
+        addr6_ = addr6;
     }
 
-    // 返回端口号（主机字节序）
+    // 任意地址族  len为accept/getsockname等返回的地址长度
+    InetAddress(const sockaddr* addr, socklen_t len);
+
+    // Unix域套接字地址  path以'@'开头时使用抽象命名空间
+    static InetAddress fromUnixPath(const std::string& path);
+
+    // 获取sockfd绑定的本地地址 / 对端地址
+    static InetAddress getLocalAddr(int sockfd);
+    static InetAddress getPeerAddr(int sockfd);
+
+    // 地址族 AF_INET / AF_INET6 / AF_UNIX
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+
+    // 返回端口号（主机字节序）  Unix域地址返回0
     uint16_t toPort() const;
 
-    // 返回当前对象所表示的 IP 地址字符串 （如 "192.168.1.1"）
+    // 返回当前对象所表示的 IP 地址字符串 （如 "192.168.1.1"）  Unix域地址返回路径
     std::string toIp() const;
 
-    // 返回 IP 和端口的组合字符串 "IP:Port"（如 "192.168.1.1:8080"）
+    // 返回 IP 和端口的组合字符串 "IP:Port"（如 "192.168.1.1:8080"  "[::1]:8080"  "unix:/tmp/s.sock"）
     std::string toIpPort() const;
 
 
 
-    // 获取底层的sockaddr_in指针
-    const sockaddr_in * getSockAddr() const     { return &addr_; }
+    // 获取底层的地址指针和长度 (直接交给bind/connect/sendmsg)
+    const sockaddr* getSockAddr() const { return reinterpret_cast<const sockaddr*>(&addrUn_); }
+    socklen_t getSockLen() const        { return addrLen_; }
 
     // 设置底层地址结构
-    void setSockAddr(const sockaddr_in &addr)   { addr_ = addr; }
+    void setSockAddr(const sockaddr_in &addr)   { addr_ = addr; addrLen_ = sizeof addr; }
+    void setSockAddr(const sockaddr* addr, socklen_t len);
 
 
 private:
-    sockaddr_in addr_; // 封装的数据成员，存储底层的IPv4套接字地址
-};
\ No newline at end of file
+    // 封装的数据成员，存储底层的套接字地址  三种结构的第一个字段都是地址族
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_in6 addr6_;
+        sockaddr_un addrUn_;
+    };
+    socklen_t addrLen_; // 有效长度 Unix域地址的长度与路径有关
+};
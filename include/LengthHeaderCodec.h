@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+#include "Callbacks.h"
+#include "StringPiece.h"
+#include "Timestamp.h"
+#include "noncopyable.h"
+
+class Buffer;
+
+/**
+ * "4字节长度 + 数据" 的消息帧编解码
+ *
+ * 帧格式 (网络字节序):
+ *   | int32 length | uint32 crc32c (可选) | payload (length字节) |
+ * length只计payload；开启校验时crc32c是payload的CRC32C，两端需一致
+ *
+ * - 解码直接在连接的输入Buffer上进行，回调拿到的frame指向缓冲区 不拷贝，只在回调期间有效
+ *   收到帧头后为剩余部分预留空间，但最多kMaxReserveBytes (length不可信，不能凭4个字节就分配maxFrameBytes)
+ * - 编码可以 header + payload 两段sendv，或者在消息Buffer的prepend预留区补帧头后整体发送
+ * - length超过maxFrameBytes或校验失败视为协议错误：回调errorCallback (默认打日志)，丢弃输入并关闭连接
+ */
+
+class LengthHeaderCodec : noncopyable
+{
+public:
+    enum Error
+    {
+        kFrameTooLarge,
+        kChecksumMismatch,
+    };
+
+    using FrameCallback = std::function<void (const TcpConnectionPtr&, const StringPiece&, Timestamp)>;
+    using ErrorCallback = std::function<void (const TcpConnectionPtr&, Error)>;
+
+    static const size_t kLengthLen = sizeof(int32_t);
+    static const size_t kChecksumLen = sizeof(uint32_t);
+    static const size_t kDefaultMaxFrameBytes = 64 * 1024 * 1024;
+    static const size_t kMaxReserveBytes = 64 * 1024; // 收到帧头时最多预先扩容的字节数 更大的帧随数据到达增长
+    static const size_t kMaxPieces = 8;
+
+    explicit LengthHeaderCodec(const FrameCallback& cb,
+                               bool checksum = false,
+                               size_t maxFrameBytes = kDefaultMaxFrameBytes);
+
+    void setErrorCallback(const ErrorCallback& cb) { errorCallback_ = cb; }
+
+    // 作为TcpServer/TcpClient的消息回调
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    // 发送一帧  帧头和payload两段一次writev发出，不拷贝payload
+    void send(const TcpConnectionPtr& conn, const StringPiece& payload) const;
+    // 多段拼成一帧 (如协议头 + 数据)  count不超过kMaxPieces
+    void send(const TcpConnectionPtr& conn, const StringPiece* pieces, size_t count) const;
+    // message为组装好的payload  在其prepend预留区补上帧头后整体发送
+    void send(const TcpConnectionPtr& conn, Buffer* message) const;
+    // 只编码: 在message的可读数据前补上帧头 (需 prependableBytes() >= headerLen())
+    void encode(Buffer* message) const;
+
+    size_t headerLen() const { return checksum_ ? kLengthLen + kChecksumLen : kLengthLen; }
+    bool checksum() const { return checksum_; }
+
+private:
+    void fillHeader(char* header, const StringPiece* pieces, size_t count) const;
+
+    FrameCallback frameCallback_;
+    ErrorCallback errorCallback_;
+    const bool checksum_;
+    const size_t maxFrameBytes_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+
+/**
+ * 滚动日志文件
+ *
+ * 文件名: basename.YYYYmmdd-HHMMSS.hostname.pid.log
+ * - 写满rollSize字节，或跨过本地时间的零点时，关闭当前文件并新建一个
+ *   文件名精确到秒，同一秒内不会再次滚动，rollSize应明显大于一秒内的日志量
+ * - 带64KB用户态缓冲区的fwrite，每flushInterval秒fflush一次，每fsyncInterval秒fdatasync一次，不逐行刷盘
+ * - rollSize为0时不滚动，直接追加到名为basename的文件 (如 /dev/null)
+ *
+ * 一般作为AsyncLogging的后端，由它的后台线程写入(threadSafe=false)，fflush和fdatasync都在后台线程完成
+ * 也可以直接作为Logger的输出 (threadSafe=true，内部加锁)，此时刷盘发生在写日志的线程中
+ */
+
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string& basename,
+            off_t rollSize,
+            bool threadSafe = true,
+            int flushInterval = 3,    // fflush间隔(秒)
+            int fsyncInterval = 10);  // fdatasync间隔(秒)  <=0 不主动fdatasync
+    ~LogFile();
+
+    // 追加一段日志
+    void append(const char* logline, size_t len);
+    // fflush  距上次fdatasync超过fsyncInterval秒时顺便fdatasync
+    void flush();
+    // 关闭当前文件，新建一个  同一秒内不重复滚动(文件名相同)
+    bool rollFile();
+
+    off_t writtenBytes() const { return writtenBytes_; }
+    int rolledFiles() const { return rolledFiles_; }
+
+    // 根据当前时间生成日志文件名
+    static std::string getLogFileName(const std::string& basename, time_t* now);
+
+private:
+    void appendUnlocked(const char* logline, size_t len);
+    void flushUnlocked(time_t now);
+    void openFile(const std::string& filename);
+    void closeFile();
+    time_t periodOf(time_t t) const { return (t + utcOffset_) / kRollPerSeconds * kRollPerSeconds; }
+
+    static const int kCheckTimeRoll = 1024;       // 每写这么多次检查一次时间 避免每行都读时钟
+    static const int kRollPerSeconds = 60 * 60 * 24;
+    static const size_t kBufferSize = 64 * 1024;
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int fsyncInterval_;
+    long utcOffset_;    // 本地时区相对UTC的秒数 按本地日期滚动
+
+    std::unique_ptr<std::mutex> mutex_; // threadSafe时才有
+
+    int count_;             // 距上次检查时间以来的写入次数
+    time_t startOfPeriod_;  // 当前文件所属的那一天 (按本地日期)
+    time_t lastRoll_;
+    time_t lastFlush_;
+    time_t lastFsync_;
+    bool dirty_;            // 上次fdatasync之后有新的写入
+
+    FILE* fp_;
+    off_t writtenBytes_;    // 当前文件已写入的字节数
+    int rolledFiles_;       // 已创建的文件数
+    std::unique_ptr<char[]> buffer_; // fp_的缓冲区
+};
@@ -1,88 +1,123 @@
 #pragma once
 
 #include <string>
+#include <functional>
+#include <atomic>
+#include <stdio.h>  // snprintf
+#include <stdlib.h> // exit
 #include "noncopyable.h"
+#include "BinaryLogger.h"
 
 /**
  * 使用宏 提供日志打印
  * 简化日志记录，避免重复代码，不需要用户自己去手动格式化字符串、获取Logger实例、调用log方法
+ *
+ * 两级过滤：
+ * - 编译期：级别低于 MUDUO_MIN_LOG_LEVEL 的 LOG_* 宏展开为空语句，不产生任何代码
+ *           (0 DEBUG  1 INFO  2 ERROR  如 -DMUDUO_MIN_LOG_LEVEL=1 去掉所有LOG_DEBUG)
+ * - 运行期：Logger::setLogLevel() 设置的最低级别，宏在格式化之前先检查，被过滤的日志只有一次原子读的开销
+ * 级别作为参数传给 Logger::log，多个IO线程同时写日志不会互相改写级别
+ *
+ * BinaryLogger::instance().start() 之后进入二进制日志模式：不再格式化，只记录格式串id和原始参数 (见BinaryLogger.h)
  */
 
- // LOG_INFO("%s %d", arg1, arg2)
- // 定义宏LOG_INFO 用于记录 INFO 级别的日志
- #define LOG_INFO(logmsgFormat, ...)                                \
-    do                                                              \
-    {                                                               \
-        Logger& logger = Logger::instance();/*获取单例Logger实例*/   \
-        logger.setLogLevel(INFO); /*设置日志级别*/                \
-        char buf[1024] = {0}; /*存储格式化后的日志*/                  \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);/*将格式化的日志写入buf*/ \
-        logger.log(buf); /*写日志*/                                  \
-    }while(0)                                                       \
+// 编译期最低级别  默认全部编译进来，由运行期级别过滤
+#ifndef MUDUO_MIN_LOG_LEVEL
+    #define MUDUO_MIN_LOG_LEVEL 0
+#endif
+
+// 格式化并写一条日志  只有通过运行期级别检查才格式化
+#define LOG_IMPL(level, logmsgFormat, ...)                                  \
+    do                                                                      \
+    {                                                                       \
+        if (Logger::logLevel() <= level) /*先检查级别 被过滤时不做snprintf*/  \
+        {                                                                   \
+            if (BinaryLogger::active()) /*二进制模式 格式化推迟到离线解码*/     \
+            {                                                               \
+                static const uint32_t fmtId =  /*每个调用点只注册一次*/        \
+                    BinaryLogger::registerFormat(level, __FILE__, __LINE__, logmsgFormat); \
+                BinaryLogger::record(fmtId, ##__VA_ARGS__);                 \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                char buf[1024]; /*存储格式化后的日志*/                        \
+                snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);/*将格式化的日志写入buf*/ \
+                Logger::instance().log(level, buf); /*写日志*/               \
+            }                                                               \
+        }                                                                   \
+    } while(0)
     // do{}while(0) 是常见的宏封装技巧，保证宏代码块在调用时，不会因为分号或换行导致语法错误
 
 
-// LOG_ERROR()
-#define LOG_ERROR(logmsgFormat, ...)                        \
-    do                                                      \
-    {                                                       \
-        Logger &logger = Logger::instance();                \
-        logger.setLogLevel(ERROR);                          \
-        char buf[1024] = {0};                               \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);   \
-        logger.log(buf);                                    \
-    } while(0)
+// LOG_DEBUG
+// debug 信息比较多(如每轮poll、每个事件)，运行期默认过滤掉，需要时setLogLevel(DEBUG)或设置环境变量MUDUO_LOG_DEBUG
+#if MUDUO_MIN_LOG_LEVEL <= 0
+    #define LOG_DEBUG(logmsgFormat, ...) LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define LOG_DEBUG(logmsgFormat, ...) do { } while(0)
+#endif
 
+// LOG_INFO("%s %d", arg1, arg2)
+// 定义宏LOG_INFO 用于记录 INFO 级别的日志
+#if MUDUO_MIN_LOG_LEVEL <= 1
+    #define LOG_INFO(logmsgFormat, ...) LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define LOG_INFO(logmsgFormat, ...) do { } while(0)
+#endif
+
+// LOG_ERROR()
+#if MUDUO_MIN_LOG_LEVEL <= 2
+    #define LOG_ERROR(logmsgFormat, ...) LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define LOG_ERROR(logmsgFormat, ...) do { } while(0)
+#endif
 
-// LOG_FATAL() 致命错误 要终止程序
+// LOG_FATAL() 致命错误 要终止程序  不受任何级别过滤
 #define LOG_FATAL(logmsgFormat, ...)                        \
     do                                                      \
     {                                                       \
-        Logger &logger = Logger::instance();                \
-        logger.setLogLevel(FATAL);                          \
-        char buf[1024] = {0};                               \
+        char buf[1024];                                     \
         snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);   \
-        logger.log(buf);                                    \
+        Logger::instance().log(FATAL, buf);                 \
         exit(-1);       /*终止程序*/                         \
     } while(0)
 
 
-// LOG_DEBUG
-// debug 信息比较多，打印出来会影响查看，所以调试信息一般运行起来默认是关闭的
-#ifdef MUDEBUG // 如果定义了MUDEBUG，就正常输出debug信息 (就是在使用LOG_DEBUG之前，有#define MUDEBUG 这一句)
-    #define LOG_DEBUG(logmsgFormat, ...)                      \
-        do                                                    \
-        {                                                     \
-            Logger &logger = Logger::instance();              \
-            logger.setLogLevel(DEBUG);                        \
-            char buf[1024] = {0};                             \
-            snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-            logger.log(buf);                                  \
-        } while(0)
-#else // 如果没定义MUDEBUG，LOG_DEBUG是空的，不输出
-    #define LOG_DEBUG(logmsgFormat, ...)
-#endif
-
-
 
-// 定义日志级别 INFO ERROR FATAL DEBUG
+// 定义日志级别 DEBUG INFO ERROR FATAL  按严重程度递增，便于比较
 enum LogLevel
 {
+   DEBUG, // 调试信息
    INFO,  // 普通信息
    ERROR, // 错误信息
    FATAL, // 致命错误，需要终止程序的那种
-   DEBUG, // 调试信息
 };
 class Logger : noncopyable
 {
 public:
+    using OutputFunc = std::function<void (const char* msg, size_t len)>; // 输出一行格式化好的日志
+    using FlushFunc = std::function<void ()>;
+
     // 获取日志唯一的实例对象 单例
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
+
+    // 运行期最低日志级别  低于该级别的日志在格式化前被丢弃  线程安全
+    static int logLevel() { return s_logLevel.load(std::memory_order_relaxed); }
+    static void setLogLevel(int level) { s_logLevel.store(level, std::memory_order_relaxed); }
+
+    // 写日志  msg为格式化好的日志内容
+    void log(int level, const char* msg);
+
+    // 设置日志输出目的地 默认写stdout  (如AsyncLogging::append)
+    // 需在其他线程开始写日志之前设置
+    void setOutput(OutputFunc out) { output_ = std::move(out); }
+    void setFlush(FlushFunc flush) { flush_ = std::move(flush); }
 
 private:
-    int loglevel_;
-};
\ No newline at end of file
+    Logger();
+
+    static std::atomic_int s_logLevel; // 默认INFO，设置了环境变量MUDUO_LOG_DEBUG时为DEBUG
+
+    OutputFunc output_;
+    FlushFunc flush_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+/**
+ * 进程级的缓冲区内存预算 (所有subloop的所有Buffer共用)
+ *
+ * - Buffer在构造/扩容/收缩/析构时把容量变化记到本线程的计数上 (one loop per thread 即每个loop一个计数)，
+ *   不加锁不做原子操作；累计变化超过kReconcileBytes或者每轮EventLoop循环末尾才合并到全局用量
+ * - 全局用量达到高水位(limit的90%)进入"内存紧张"状态，降到低水位(limit的70%)以下解除:
+ *     Acceptor 暂停accept新连接
+ *     占用缓冲区超过heavyConnectionBytes的连接暂停读 (达到limit时所有连接都暂停读)
+ *     只暂停还有待发送数据的连接：它们的输出发完后会归还缓冲区，暂停没有输出的连接只会让服务停住
+ *   解除时通过runWhenRelieved登记的回调恢复；暂停的连接输出发完后也会自己恢复读
+ * - limit为0表示不限制 (默认)，此时只统计用量
+ *
+ * usage()是各线程已合并部分的总和，与实际值最多相差 线程数 * kReconcileBytes
+ */
+
+class MemoryBudget : noncopyable
+{
+public:
+    using Functor = std::function<void()>;
+
+    static const int64_t kReconcileBytes = 256 * 1024; // 本线程累计变化超过该值立即合并
+
+    // 获取唯一的实例对象 单例
+    static MemoryBudget& instance();
+
+    // 由Buffer调用  记录本线程的容量变化
+    static void charge(int64_t delta)
+    {
+        t_localDelta += delta;
+        if (t_localDelta >= kReconcileBytes || t_localDelta <= -kReconcileBytes)
+        {
+            instance().reconcile();
+        }
+    }
+
+    // 把本线程的计数合并到全局用量，并更新紧张状态  EventLoop每轮循环末尾调用
+    void reconcile();
+
+    // 设置预算 (字节) 0表示不限制
+    void setLimit(size_t limit);
+    // 内存紧张时，占用超过该值的连接暂停读  默认1MB
+    void setHeavyConnectionBytes(size_t bytes) { heavyConnectionBytes_ = bytes; }
+
+    size_t limit() const { return limit_; }
+    size_t usage() const // 当前用量 (字节)
+    {
+        int64_t usage = usage_.load(std::memory_order_relaxed);
+        return usage > 0 ? static_cast<size_t>(usage) : 0;
+    }
+    bool underPressure() const { return pressure_.load(std::memory_order_relaxed); }
+
+    // 占用connectionBytes字节缓冲区的连接此时是否应该暂停读  outputPending: 连接是否还有待发送数据
+    bool shouldPauseRead(size_t connectionBytes, bool outputPending) const;
+
+    // 内存紧张解除时执行一次cb (在执行reconcile的线程中调用，cb里应该只做runInLoop/queueInLoop之类的投递)
+    // 当前不紧张则立即执行
+    void runWhenRelieved(Functor cb);
+
+private:
+    MemoryBudget();
+
+    static __thread int64_t t_localDelta; // 本线程还没合并的容量变化
+
+    std::atomic<int64_t> usage_;
+    std::atomic_bool pressure_;
+    size_t limit_;
+    size_t highMark_;
+    size_t lowMark_;
+    size_t heavyConnectionBytes_;
+
+    std::mutex mutex_;
+    std::vector<Functor> relievedCallbacks_; // 等待紧张解除的回调
+};
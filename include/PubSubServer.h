@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TcpServer.h"
+#include "StringPiece.h"
+#include "noncopyable.h"
+
+/**
+ * 主题发布/订阅服务  基于TcpServer，文本行协议:
+ *   sub <topic>\r\n                 订阅
+ *   unsub <topic>\r\n               取消订阅
+ *   pub <topic>\r\n<content>\r\n    发布 (content为一行)
+ * 订阅者收到的消息和pub命令格式相同
+ *
+ * - 每条消息只编码一次，成为不可变的引用计数payload (SharedPayload)
+ * - 扇出按IO线程进行：每个有订阅者的IO线程只投递一次，由该线程遍历本线程上的订阅者
+ *   同一个payload按引用排进各订阅者的输出队列，不拷贝
+ *   一次读到的多条pub合并成一批，每个IO线程每批只投递(唤醒)一次
+ * - 订阅连接开启延迟flush，一轮循环收到的多条消息合并成一次writev
+ * - 每个订阅者的积压(输出队列字节数)超过上限时直接断开，慢订阅者不会拖住发布者和内存
+ */
+
+class PubSubServer : noncopyable
+{
+public:
+    PubSubServer(EventLoop* loop,
+                 const InetAddress& listenAddr,
+                 const std::string& name,
+                 TcpServer::Option option = TcpServer::kNoReusePort);
+    ~PubSubServer();
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // 每个订阅者允许积压的字节数 超过时断开该订阅者  默认4MB  需在start之前设置
+    void setMaxLagBytes(size_t bytes) { maxLagBytes_ = bytes; }
+
+    void start();
+
+    // 发布消息  线程安全 (服务端自身也可以作为发布者)
+    void publish(const std::string& topic, const StringPiece& content);
+
+    int64_t publishedMessages() const { return published_.load(std::memory_order_relaxed); }
+    int64_t deliveredMessages() const;   // 已交给订阅连接的消息数 (每个订阅者算一次)
+    int64_t droppedSubscribers() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Message // 一次编码，所有IO线程共享
+    {
+        std::string topic;
+        std::string wire; // 发给订阅者的完整字节
+    };
+    using MessagePtr = std::shared_ptr<const Message>;
+    using MessageBatch = std::vector<MessagePtr>;
+    using MessageBatchPtr = std::shared_ptr<const MessageBatch>;
+
+    struct Shard // 每个IO线程一个  topics只在该线程中访问
+    {
+        explicit Shard(EventLoop* l) : loop(l), subscriptions(0), delivered(0) {}
+
+        EventLoop* loop;
+        std::unordered_map<std::string, std::vector<TcpConnectionPtr>> topics;
+        std::atomic<size_t> subscriptions; // 本线程上的订阅数 发布时跳过没有订阅者的线程
+        std::atomic<int64_t> delivered;
+    };
+
+    struct Session // 连接上下文
+    {
+        Shard* shard;
+        std::vector<std::string> topics; // 该连接订阅的主题
+    };
+
+    static const size_t kMaxLineBytes = 64 * 1024;
+
+    void onThreadInit(EventLoop* loop);
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    void subscribe(const TcpConnectionPtr& conn, Session* session, const std::string& topic);
+    void unsubscribe(const TcpConnectionPtr& conn, Session* session, const std::string& topic);
+    void publishBatch(const MessageBatchPtr& batch);
+    void distribute(Shard* shard, const MessageBatchPtr& batch); // 在shard的loop线程中执行
+
+    size_t maxLagBytes_;
+
+    std::mutex mutex_;                           // 只在初始化分片时使用
+    std::vector<std::unique_ptr<Shard>> shards_; // start之后只读
+
+    std::atomic<int64_t> published_;
+    std::atomic<int64_t> dropped_;
+
+    TcpServer server_; // 最先析构：关闭连接时的回调还要访问上面的订阅表
+};
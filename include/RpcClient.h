@@ -0,0 +1,77 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#include "TcpClient.h"
+#include "LengthHeaderCodec.h"
+#include "RpcMessage.h"
+#include "TimerId.h"
+#include "noncopyable.h"
+
+/**
+ * RPC客户端  一个连接上可以同时有任意多个在途调用 (请求流水线)，应答按id匹配，可以乱序
+ *
+ * - call() 异步，完成/失败/超时都通过回调通知，回调在loop线程中执行，response只在回调期间有效
+ * - 超时由loop的定时器执行：在途调用的截止时间放在一个最小堆里，只挂一个定时器对准最早的截止时间，
+ *   到期时回调kRpcDeadlineExceeded，之后到达的应答丢弃 (不为每个调用单独创建/取消定时器)
+ *   超时时间也随请求发给服务端
+ * - 同一轮循环发出的请求合并成一次写 (延迟flush)
+ * - 连接断开时所有在途调用回调kRpcConnectionClosed；未连接时发起的调用立即失败
+ */
+
+class RpcClient : noncopyable
+{
+public:
+    using RpcCallback = std::function<void (RpcStatus status, const StringPiece& response)>;
+    using ConnectionCallback = std::function<void (bool connected)>;
+
+    RpcClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name, bool checksum = false);
+    ~RpcClient();
+
+    void connect() { client_.connect(); }
+    void disconnect() { client_.disconnect(); }
+    bool connected() const { return connection_ && connection_->connected(); } // 只在loop线程中调用
+
+    // 连接建立/断开通知  需在connect之前设置
+    void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
+
+    // 发起调用  timeout秒，<=0不限时  其他线程调用时会拷贝参数转到loop线程
+    void call(const StringPiece& method, const StringPiece& request, const RpcCallback& done, double timeout = 0);
+
+    size_t pendingCalls() const { return pending_.size(); }
+    EventLoop* getLoop() const { return loop_; }
+
+private:
+    struct Call
+    {
+        RpcCallback done;
+        Timestamp deadline; // 无效表示不限时
+    };
+    using Deadline = std::pair<Timestamp, int64_t>; // (截止时间, 调用id)
+
+    void callInLoop(const std::string& method, const std::string& request, const RpcCallback& done, double timeout);
+    void onConnection(const TcpConnectionPtr& conn);
+    void onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp receiveTime);
+    void addDeadline(Timestamp deadline, int64_t id);
+    void armTimer(Timestamp when);
+    void onTimer();
+    void failAll(RpcStatus status);
+
+    EventLoop* loop_;
+    TcpClient client_;
+    LengthHeaderCodec codec_;
+    TcpConnectionPtr connection_;
+    ConnectionCallback connectionCallback_;
+
+    int64_t nextId_;
+    std::unordered_map<int64_t, Call> pending_; // 在途调用
+
+    // 截止时间最小堆  已完成调用的条目不立即删除，出堆时发现id不在pending_中即跳过
+    std::vector<Deadline> deadlines_;
+    TimerId timer_;   // 对准堆顶的定时器
+    Timestamp timerAt_;
+};
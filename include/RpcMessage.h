@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+#include "StringPiece.h"
+
+/**
+ * RPC消息格式  每条消息是LengthHeaderCodec的一帧 (帧内全部为网络字节序)
+ *
+ * 请求: | int8 kRpcRequest | int64 id | int32 timeoutMs | int16 methodLen | method | payload |
+ * 应答: | int8 kRpcResponse | int64 id | int8 status | payload |
+ *
+ * id由客户端分配，同一连接上可以有任意多个在途请求，应答可以乱序返回，按id匹配
+ * timeoutMs为0表示不限时；服务端收到时已超时或排队超时的请求不再执行，直接应答kRpcDeadlineExceeded
+ * status非kRpcOk时payload为错误描述
+ */
+
+enum RpcStatus
+{
+    kRpcOk = 0,
+    kRpcNoSuchMethod,
+    kRpcDeadlineExceeded,
+    kRpcApplicationError,   // 处理函数返回的错误
+    kRpcBadMessage,
+    kRpcConnectionClosed,   // 客户端: 连接断开 在途请求全部失败
+};
+
+inline const char* rpcStatusString(RpcStatus status)
+{
+    switch (status)
+    {
+    case kRpcOk:               return "ok";
+    case kRpcNoSuchMethod:     return "no such method";
+    case kRpcDeadlineExceeded: return "deadline exceeded";
+    case kRpcApplicationError: return "application error";
+    case kRpcBadMessage:       return "bad message";
+    case kRpcConnectionClosed: return "connection closed";
+    }
+    return "unknown";
+}
+
+namespace RpcMessage
+{
+    const int8_t kRequest = 1;
+    const int8_t kResponse = 2;
+
+    const size_t kRequestHeaderLen = 1 + 8 + 4 + 2; // 不含method
+    const size_t kResponseHeaderLen = 1 + 8 + 1;
+
+    const size_t kMaxMessageBytes = 4 * 1024 * 1024; // 单条消息(帧)的上限  超过视为协议错误，关闭连接
+
+    struct Request
+    {
+        int64_t id;
+        int32_t timeoutMs;
+        StringPiece method;
+        StringPiece payload;
+    };
+
+    struct Response
+    {
+        int64_t id;
+        RpcStatus status;
+        StringPiece payload;
+    };
+
+    // 编码消息头到header (调用方提供至少k*HeaderLen字节)  payload作为独立的一段发送
+    inline void encodeRequestHeader(char* header, int64_t id, int32_t timeoutMs, size_t methodLen)
+    {
+        uint64_t be64 = htobe64(static_cast<uint64_t>(id));
+        uint32_t be32 = htobe32(static_cast<uint32_t>(timeoutMs));
+        uint16_t be16 = htobe16(static_cast<uint16_t>(methodLen));
+        header[0] = kRequest;
+        ::memcpy(header + 1, &be64, 8);
+        ::memcpy(header + 9, &be32, 4);
+        ::memcpy(header + 13, &be16, 2);
+    }
+
+    inline void encodeResponseHeader(char* header, int64_t id, RpcStatus status)
+    {
+        uint64_t be64 = htobe64(static_cast<uint64_t>(id));
+        header[0] = kResponse;
+        ::memcpy(header + 1, &be64, 8);
+        header[9] = static_cast<char>(status);
+    }
+
+    // 解析 (切片指向frame 不拷贝)  格式不对返回false
+    inline bool parseRequest(const StringPiece& frame, Request* request)
+    {
+        if (frame.size() < kRequestHeaderLen || frame[0] != kRequest)
+        {
+            return false;
+        }
+        uint64_t be64;
+        uint32_t be32;
+        uint16_t be16;
+        ::memcpy(&be64, frame.data() + 1, 8);
+        ::memcpy(&be32, frame.data() + 9, 4);
+        ::memcpy(&be16, frame.data() + 13, 2);
+        size_t methodLen = be16toh(be16);
+        if (frame.size() < kRequestHeaderLen + methodLen)
+        {
+            return false;
+        }
+        request->id = static_cast<int64_t>(be64toh(be64));
+        request->timeoutMs = static_cast<int32_t>(be32toh(be32));
+        request->method = StringPiece(frame.data() + kRequestHeaderLen, methodLen);
+        request->payload = StringPiece(frame.data() + kRequestHeaderLen + methodLen,
+                                       frame.size() - kRequestHeaderLen - methodLen);
+        return true;
+    }
+
+    inline bool parseResponse(const StringPiece& frame, Response* response)
+    {
+        if (frame.size() < kResponseHeaderLen || frame[0] != kResponse)
+        {
+            return false;
+        }
+        uint64_t be64;
+        ::memcpy(&be64, frame.data() + 1, 8);
+        response->id = static_cast<int64_t>(be64toh(be64));
+        response->status = static_cast<RpcStatus>(frame[9]);
+        response->payload = StringPiece(frame.data() + kResponseHeaderLen, frame.size() - kResponseHeaderLen);
+        return true;
+    }
+}
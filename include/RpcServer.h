@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TcpServer.h"
+#include "LengthHeaderCodec.h"
+#include "RpcMessage.h"
+#include "noncopyable.h"
+
+/**
+ * 多路复用的二进制RPC服务端  基于TcpServer + LengthHeaderCodec (消息格式见RpcMessage.h)
+ *
+ * - 同一连接上的请求互不等待，应答带请求id，可以乱序返回
+ * - 处理函数在注册时选择执行位置:
+ *     kInLoop  直接在连接的IO线程执行 (短小、不阻塞的处理)，请求数据不拷贝
+ *     kInPool  投递到计算线程池 (setComputeThreadNum)，请求数据拷贝一份，结果转回IO线程发送
+ * - 连接开启延迟flush：一轮事件循环中产生的所有应答合并成一次写
+ * - 请求带超时时间，排队到期的请求不再执行，直接应答kRpcDeadlineExceeded
+ */
+
+class RpcServer : noncopyable
+{
+public:
+    enum Dispatch
+    {
+        kInLoop,
+        kInPool,
+    };
+
+    // 处理函数  把应答写到response，返回kRpcOk或kRpcApplicationError (此时response为错误描述)
+    using RpcHandler = std::function<RpcStatus (const StringPiece& request, std::string* response)>;
+
+    RpcServer(EventLoop* loop,
+              const InetAddress& listenAddr,
+              const std::string& name,
+              bool checksum = false,
+              TcpServer::Option option = TcpServer::kNoReusePort);
+    ~RpcServer();
+
+    // 注册方法  需在start之前调用
+    void registerMethod(const std::string& method, const RpcHandler& handler, Dispatch dispatch = kInLoop);
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }  // IO线程数
+    void setComputeThreadNum(int numThreads) { computeThreads_ = numThreads; } // kInPool方法的执行线程数 默认1
+
+    void start();
+
+private:
+    struct Method
+    {
+        RpcHandler handler;
+        Dispatch dispatch;
+    };
+
+    void onConnection(const TcpConnectionPtr& conn);
+    void onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp receiveTime);
+    void runInPool(const TcpConnectionPtr& conn, const Method* method, int64_t id,
+                   const std::string& request, Timestamp deadline);
+    void sendResponse(const TcpConnectionPtr& conn, int64_t id, RpcStatus status, const StringPiece& payload);
+
+    EventLoop* loop_;
+    TcpServer server_;
+    LengthHeaderCodec codec_;
+    std::unordered_map<std::string, Method> methods_; // start后只读 各IO线程并发查找
+
+    int computeThreads_;
+    std::unique_ptr<EventLoopThreadPool> computePool_;
+    std::vector<EventLoop*> computeLoops_;
+    std::atomic<unsigned> nextCompute_; // 各IO线程轮询选择计算线程
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Callbacks.h"
+#include "StringPiece.h"
+#include "TimerId.h"
+#include "noncopyable.h"
+
+class EventLoop;
+
+/**
+ * 只追加的分段日志  用于消息的持久化和重放
+ *
+ * 磁盘格式: 目录下若干固定大小的段文件 <第一条记录的序号 20位>.seg，创建时ftruncate到segmentBytes并mmap
+ *   每条记录就是LengthHeaderCodec开启校验时的帧: | int32 length | uint32 crc32c | payload |
+ *   段内未写的部分为0 (length为0即数据结尾，所以记录不能为空)
+ *
+ * - 追加: 在loop线程中直接写入mmap，返回记录的序号 (从0开始连续递增)
+ * - 组提交: 追加只标记脏区间，每轮循环末尾(或每隔syncInterval)对本轮写过的页msync一次，
+ *   之后回调SyncCallback通知哪些记录已经落盘
+ * - 稀疏索引: 每个段在内存中每隔indexInterval字节记一个(序号, 文件偏移)，定位时从最近的索引点
+ *   沿着帧头在mmap中向后跳；打开已有目录时扫描各段重建索引，校验失败的尾部记录被截断
+ * - 重放: 把[fromSeq, nextSeq())对应的文件区间用TcpConnection::sendFile直接发给消费者，
+ *   数据不经过用户态缓冲区；消费者用 LengthHeaderCodec(cb, true) 解码
+ *   在重放之后send的数据排在文件段后面，所以"先重放再实时推送"不会乱序也不会漏
+ * - 超过maxSegments时删除最老的段 (正在重放的段由sendFile的回调持有，发完或放弃后才关闭)
+ *
+ * 除replay中的sendFile外所有接口只在loop线程中调用
+ */
+
+class SegmentLog : noncopyable
+{
+public:
+    using SyncCallback = std::function<void (int64_t syncedSeq)>; // 序号小于syncedSeq的记录已经落盘
+
+    static const size_t kHeaderLen = 8; // length + crc32c
+    static const size_t kDefaultSegmentBytes = 64 * 1024 * 1024;
+    static const size_t kDefaultIndexInterval = 4096;
+
+    SegmentLog(EventLoop* loop,
+               const std::string& dir,
+               size_t segmentBytes = kDefaultSegmentBytes,
+               size_t indexIntervalBytes = kDefaultIndexInterval);
+    ~SegmentLog(); // 同步所有未落盘的数据
+
+    // 创建目录或恢复已有的段  失败返回false (errno见日志)
+    bool open();
+
+    // 组提交间隔(秒)  0表示每轮循环末尾提交一次 (默认)
+    void setSyncInterval(double seconds) { syncInterval_ = seconds; }
+    void setSyncCallback(const SyncCallback& cb) { syncCallback_ = cb; }
+    // 最多保留的段数  0表示不删除 (默认)
+    void setMaxSegments(size_t n) { maxSegments_ = n; }
+
+    // 追加一条记录  返回序号；记录为空、超过段大小或者新建段失败返回-1
+    int64_t append(const StringPiece& record) { return append(&record, 1); }
+    int64_t append(const StringPiece* pieces, size_t count); // 多段拼成一条记录
+    // 立即提交
+    void sync();
+
+    // 把[fromSeq, nextSeq())的记录帧用sendfile发给conn (conn可以属于其他loop)
+    // fromSeq早于保留范围时从firstSeq开始  返回实际的起始序号；没有可发的记录时不调用done
+    // done在最后一段发完后以completed=true调用；出错或连接关闭放弃重放时completed为false
+    int64_t replay(const TcpConnectionPtr& conn, int64_t fromSeq,
+                   const FileCompleteCallback& done = FileCompleteCallback());
+
+    int64_t firstSeq() const { return segments_.empty() ? nextSeq_ : segments_.front()->baseSeq; }
+    int64_t nextSeq() const { return nextSeq_; }
+    int64_t syncedSeq() const { return syncedSeq_; }
+    size_t segmentCount() const { return segments_.size(); }
+
+private:
+    struct IndexEntry
+    {
+        int64_t seq;
+        size_t pos;
+    };
+
+    struct Segment : noncopyable // 重放时由sendFile的回调共同持有
+    {
+        Segment() : baseSeq(0), fd(-1), data(nullptr), capacity(0), size(0), count(0) {}
+        ~Segment();
+
+        int64_t baseSeq;
+        std::string path;
+        int fd;
+        char* data;      // mmap的整个文件
+        size_t capacity; // 文件大小
+        size_t size;     // 已写入的字节数
+        int64_t count;   // 记录数
+        std::vector<IndexEntry> index; // 稀疏索引 按seq递增
+    };
+    using SegmentPtr = std::shared_ptr<Segment>;
+
+    SegmentPtr openSegment(const std::string& path, int64_t baseSeq, bool create);
+    bool recover(Segment* seg); // 扫描已有段 重建索引
+    bool roll();                // 封存当前段 新建下一个
+    void addIndex(Segment* seg, int64_t seq, size_t pos);
+    size_t locate(const Segment* seg, int64_t seq) const; // seq在段内的文件偏移
+    void scheduleSync();
+    void syncSegment(Segment* seg, size_t begin, size_t end);
+    void retire();              // 删除超过maxSegments的老段
+
+    EventLoop* loop_;
+    const std::string dir_;
+    const size_t segmentBytes_;
+    const size_t indexInterval_;
+    double syncInterval_;
+    size_t maxSegments_;
+    SyncCallback syncCallback_;
+
+    std::deque<SegmentPtr> segments_; // 按baseSeq递增 最后一个是正在写的段
+    int64_t nextSeq_;
+    int64_t syncedSeq_;
+    size_t dirtyBegin_;  // 当前段中还没msync的起点
+    bool syncPending_;
+    TimerId syncTimer_;
+    std::shared_ptr<bool> alive_; // 析构后还没执行的提交任务不再访问this
+};
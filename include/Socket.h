@@ -37,6 +37,8 @@ public:
     void setReuseAddr (bool on); // 设置地址重用，允许快速重启服务绑定相同端口
     void setReusePort (bool on); // 设置端口复用，允许多个 socket 实例监听同一端口，支持多线程
     void setKeepAlive (bool on); // 启用 TCP keepalive 检测对端连接状态
+    void setTcpCork   (bool on); // TCP_CORK 暂存不满一个MSS的数据，取消时一次性发出
+    bool setZeroCopy  (bool on); // 启用 SO_ZEROCOPY，之后才能使用 MSG_ZEROCOPY 发送 (内核不支持时返回false)
 
 private:
     const int sockfd_; // socket 文件描述符（只读）
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string.h> // strlen memcmp
+#include <stddef.h> // size_t
+
+/**
+ * 只读的字符串切片 (指针 + 长度)，不拥有内存，不做拷贝
+ * 用于 sendv 等接口描述“一段已存在的内存”，调用期间需保证底层内存有效
+ */
+
+class StringPiece
+{
+public:
+    // 构造
+    StringPiece() : ptr_(nullptr), length_(0) { }
+    StringPiece(const char* str) : ptr_(str), length_(str ? ::strlen(str) : 0) { } // C字符串
+    StringPiece(const std::string& str) : ptr_(str.data()), length_(str.size()) { } // std::string
+    StringPiece(const char* offset, size_t len) : ptr_(offset), length_(len) { }     // 指针 + 长度
+
+    // 获取信息
+    const char* data() const { return ptr_; }    // 起始地址
+    size_t size() const      { return length_; } // 字节数
+    bool empty() const       { return length_ == 0; }
+
+    const char* begin() const { return ptr_; }
+    const char* end() const   { return ptr_ + length_; }
+
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    // 调整切片范围 (只移动指针，不拷贝)
+    void clear() { ptr_ = nullptr; length_ = 0; }
+    void set(const char* buffer, size_t len) { ptr_ = buffer; length_ = len; }
+    void remove_prefix(size_t n) { ptr_ += n; length_ -= n; }
+    void remove_suffix(size_t n) { length_ -= n; }
+
+    // 比较
+    bool operator==(const StringPiece& x) const
+    {
+        return length_ == x.length_ && (length_ == 0 || ::memcmp(ptr_, x.ptr_, length_) == 0);
+    }
+    bool operator!=(const StringPiece& x) const { return !(*this == x); }
+
+    // 拷贝为std::string
+    std::string as_string() const { return std::string(ptr_, length_); }
+
+private:
+    const char* ptr_; // 指向外部内存
+    size_t length_;   // 切片长度
+};
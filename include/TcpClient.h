@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+
+class EventLoop;
+class Connector;
+using ConnectorPtr = std::shared_ptr<Connector>;
+
+/**
+ * TCP客户端  主动连接一个服务端，得到和TcpServer一样的TcpConnection
+ *
+ * 连接在构造时指定的loop中建立和处理，可以是TcpServer线程池中的某个subloop，
+ * 这样对上游服务的调用和服务端连接共用同一组IO线程、Buffer和内存预算，不需要阻塞socket和额外的工作线程
+ * (如在ThreadInitCallback中为每个subloop创建自己的TcpClient)
+ *
+ * - 连接失败由Connector按指数退避自动重试
+ * - enableRetry()后连接断开也会自动重连
+ * - connect/disconnect/stop 线程安全  TcpClient必须在loop线程中析构 或在loop结束之后析构
+ */
+
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& nameArg);
+    ~TcpClient();
+
+    void connect();    // 开始连接
+    void disconnect(); // 关闭已建立的连接 (半关闭)
+    void stop();       // 停止正在进行的连接和重试
+
+    // 当前连接 可能为空
+    TcpConnectionPtr connection() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+
+    // 连接断开后自动重连
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+    // 连接失败时的重试间隔 需在connect之前调用
+    void setRetryDelay(int initMs, int maxMs);
+
+    // 用户回调 连接建立后设置到TcpConnection上  需在connect之前设置
+    void setConnectionCallback(const ConnectionCallback& cb)       { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback& cb)             { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
+
+    // 开启TLS  hostname用于SNI和证书校验  需在connect之前设置
+    void setTlsContext(const TlsContextPtr& ctx, const std::string& hostname = std::string())
+    {
+        tlsContext_ = ctx;
+        tlsHostname_ = hostname;
+    }
+
+private:
+    // Connector连接成功的回调  在loop线程中创建TcpConnection
+    void newConnection(int sockfd);
+    // 连接关闭的回调
+    void removeConnection(const TcpConnectionPtr& conn);
+
+    EventLoop* loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+
+    TlsContextPtr tlsContext_;
+    std::string tlsHostname_;
+
+    std::atomic_bool retry_;   // 断开后是否重连
+    std::atomic_bool connect_; // 用户是否要求连接
+    int nextConnId_;           // 只在loop线程中访问
+
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // 保护于mutex_
+};
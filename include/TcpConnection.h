@@ -3,16 +3,24 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <vector>
+#include <deque>
+#include <stdint.h>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "Timestamp.h"
+#include "StringPiece.h"
+#include "TlsContext.h"
 
 class Channel;
 class EventLoop;
 class Socket;
+class TcpRelay;
+class TlsSession;
+struct iovec;
 
 /**
  * TcpServer => Acceptor => 有一个新用户连接，通过accept函数拿到connfd
@@ -45,10 +53,63 @@ public:
 
     // 发送数据
     void send(const std::string& buf); // 向对端发送字符串数据
-    void sendFile(int fileDescriptor, off_t offset, size_t count); // 向对端发送文件中的部分数据
+    void sendv(const StringPiece* pieces, size_t count);     // 分散/聚集发送：多段数据（如header+body）一次writev发出，无需先拼接
+    void sendv(const std::vector<StringPiece>& pieces) { sendv(pieces.data(), pieces.size()); }
+    // 向对端发送文件中的部分数据  文件段与send的数据按调用顺序排队，由EPOLLOUT驱动sendfile发出
+    // fd由调用方管理，在cb被调用前不能关闭  cb一定会被调用一次 (loop线程中):
+    // 发完时completed为true；sendfile出错(连接随之关闭)、连接关闭或者未连接时放弃该段，completed为false
+    void sendFile(int fileDescriptor, off_t offset, size_t count, 
+                  const FileCompleteCallback& cb = FileCompleteCallback());
+    // 发送引用计数的数据块 开启零拷贝且超过阈值时走MSG_ZEROCOPY
+    // 没能立即写出的部分按引用排进输出队列 (持有payload，不拷贝)，同一payload可以同时排在多个连接中
+    void send(const SharedPayload& payload);
+
+    // 零拷贝发送 (SO_ZEROCOPY / MSG_ZEROCOPY)
+    // threshold > 0 时开启，大于等于threshold字节的SharedPayload走零拷贝；传0关闭
+    void setZeroCopyThreshold(size_t threshold);
+    size_t zeroCopyBytes() const       { return zeroCopyBytes_; }       // 内核确认零拷贝发出的字节数
+    size_t zeroCopyCopiedBytes() const { return zeroCopyCopiedBytes_; } // 以MSG_ZEROCOPY提交但内核回退为拷贝的字节数 (如loopback)
+
+    // 延迟flush (写合并)：开启后send/sendv/sendFile只追加到输出队列，
+    // 在本轮EventLoop循环末尾(doPendingFunctors之后)每个连接统一flush一次
+    // cork为true时flush前后开启/取消TCP_CORK，把数据和文件段合并成尽量满的TCP段
+    // 需在连接所属的loop线程中设置 (如连接回调中)
+    void setDeferredFlush(bool on, bool cork = false) { deferredFlush_ = on; corkOnFlush_ = cork; }
+
+    // 禁用/启用Nagle算法  自己做写合并(如延迟flush)的连接应当禁用，避免小块数据等待对端ACK
+    void setTcpNoDelay(bool on);
+
+    // TLS  在connectEstablished之前调用 (TcpServer/TcpClient设置了TlsContext时自动调用)
+    // 握手完成后才回调连接建立，之后send/sendv/sendFile照常使用，收到的是解密后的数据
+    // hostname (客户端) 用于SNI和证书校验
+    void startTls(const TlsContextPtr& ctx, const std::string& hostname = std::string());
+    bool tlsEnabled() const { return tls_ != nullptr; }
+    bool ktlsSend() const; // 发送方向由内核加密 (write/writev/sendfile直接使用)
+    bool ktlsRecv() const; // 接收方向由内核解密
+
+    // 输出队列中待发送的内存数据字节数 (含按引用排队的payload，不含文件段)  只在loop线程中调用
+    size_t bufferedOutputBytes() const;
+
+    // 用户上下文 (如协议解析状态)  只在连接所属的loop线程中访问
+    void setContext(const std::shared_ptr<void>& context) { context_ = context; }
+    const std::shared_ptr<void>& getContext() const { return context_; }
 
     // 主动关闭连接（半关闭连接）
     void shutdown();
+    // 立即关闭连接 丢弃输出队列中没发出的数据 (如跟不上的慢连接)  线程安全
+    void forceClose();
+
+    // 暂停/恢复读取该连接的数据 (不再监听EPOLLIN，对端数据留在内核接收缓冲区，由TCP窗口向对端施加背压)
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; } // 用户是否要求读 (不含流控造成的暂停)
+
+    // 自动流控：输出队列中缓存的数据(不含文件段)达到highMark时暂停读"生产者"连接，降到lowMark以下再恢复
+    // 生产者默认是连接自身 (echo之类 读得越多写得越多)；代理场景用setFlowControlSource指定上游连接
+    // highMark为0表示关闭 (默认)  需在连接所属的loop线程中设置 (如连接回调中)
+    void setFlowControl(size_t highMark, size_t lowMark);
+    // 指定向本连接写数据的上游连接 可以属于其他loop  只持有weak_ptr
+    void setFlowControlSource(const TcpConnectionPtr& source);
 
     // 用户设置回调 TcpServer中设置
     void setConnectionCallback(const ConnectionCallback& cb)        // 新连接建立时的回调      
@@ -73,6 +134,8 @@ public:
 
 
 private:
+    friend class TcpRelay; // 内核态转发需要直接操作channel_和缓冲区
+
     // 连接状态枚举
     enum StateE
     {
@@ -93,10 +156,51 @@ private:
 
     // 实际执行数据发送逻辑  在 loop_ 所在线程中调用
     void sendInLoop(const void* date, size_t len);
-    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count);
+    void sendvInLoop(const StringPiece* pieces, size_t count, const SharedPayload* owner = nullptr); // owner非空时唯一的切片位于owner中
+    void sendStringInLoop(const std::string& data); // 跨线程发送时，持有数据拷贝的版本
+    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count, const FileCompleteCallback& cb);
+    void sendPayloadInLoop(const SharedPayload& payload);
+    void setZeroCopyThresholdInLoop(size_t threshold);
+    void forceCloseInLoop();
+
+    // TLS握手  在可读/可写事件中推进，完成后回调连接建立
+    void handshakeInLoop();
+
+    // socket读写  没有TLS或已卸载到内核(kTLS)时直接系统调用，否则经过OpenSSL在用户态加解密
+    bool userTlsSend() const;
+    ssize_t readSocket(Buffer* buf, int* savedErrno);
+    ssize_t writeSocket(const void* data, size_t len, int* savedErrno);
+    ssize_t writevSocket(const struct iovec* vec, int iovcnt, int* savedErrno);
+    ssize_t sendFileTls(int fd, off_t* offset, size_t count); // 用户态TLS时代替sendfile 返回值和errno同sendfile
+
+    // 从错误队列读取零拷贝完成通知，释放对应的payload  返回处理的通知数
+    int handleZeroCopyCompletions();
+
+    // 输出队列 outputBuffer_ -> pendingFiles_[0] -> pendingFiles_[0].trailer -> pendingFiles_[1] -> ...
+    bool outputIdle() const { return outputBuffer_.readableBytes() == 0 && pendingFiles_.empty(); } // 没有任何待发送数据
+    void appendToOutput(const char* data, size_t len); // 追加到队尾 (有排队的文件时追加到最后一个文件之后)
+    void appendPayloadToOutput(const SharedPayload& payload, size_t offset); // 从offset开始按引用排到队尾
+    bool drainOutput();                            // 尽量发送队列中的数据 返回true表示已全部发完
+    void scheduleFlush();                          // 延迟flush模式 在本轮循环末尾flush一次
+    void flushOutput();
 
     // 真正执行关闭写端操作  在 loop_ 所在线程中调用
     void shutdownInLoop();
+
+    // 读控制  channel只有在用户要求读(reading_)且没有被任何下游流控暂停时才监听EPOLLIN
+    void startReadInLoop();
+    void stopReadInLoop();
+    void throttleReadInLoop(bool on); // 被下游连接暂停(on=true)/恢复读  按次数计数，可被多个下游同时暂停
+    void updateReading();
+    // 根据输出队列大小暂停/恢复生产者连接
+    void checkFlowControl();
+    void throttleSource(bool on);
+    void releaseFlowControl(); // 连接关闭时撤销本连接施加的暂停
+    void abandonPendingFiles(); // 连接关闭时丢弃输出队列中的段 通知还没发完的文件段
+    // 内存预算紧张时回收空闲缓冲区，占用大且有待发送数据的连接暂停读
+    // 紧张解除或者输出发完后由resumeFromBudget恢复
+    void checkMemoryBudget();
+    void resumeFromBudget();
     
      
     EventLoop *loop_;           // 所属EventLoop  若为多Reactor 该loop_指向subloop 若为单Reactor 该loop_指向baseloop
@@ -125,4 +229,53 @@ private:
     Buffer inputBuffer_;  // 接受数据的缓冲区
     Buffer outputBuffer_; // 发送数据的缓冲区 用户send向outputBuffer_发
 
+    // 排在outputBuffer_之后的文件段/payload段 每段后面追加的数据先放在它的trailer里，保证发送顺序
+    struct PendingFile
+    {
+        PendingFile() : fd(-1), offset(0), remaining(0), trailer(0) {}
+
+        int fd;                  // 文件描述符 (不拥有)  payload段为-1
+        off_t offset;            // 下一次sendfile的起始偏移 (payload段为payload内的偏移)
+        size_t remaining;        // 还没发出的字节数
+        FileCompleteCallback cb; // 文件段发完后的回调
+        SharedPayload payload;   // 非空表示按引用排队的payload段
+        Buffer trailer;          // 在该段之后send的数据 (按需扩容)
+    };
+    std::deque<PendingFile> pendingFiles_;
+    size_t pendingBytes_; // pendingFiles_中payload段和trailer的字节数之和
+
+    // 零拷贝发送
+    struct ZeroCopyPending
+    {
+        uint32_t id;           // 内核为每次MSG_ZEROCOPY调用分配的递增序号
+        size_t bytes;          // 这次调用实际提交的字节数
+        SharedPayload payload; // 在收到完成通知前持有，保证用户内存不被释放
+    };
+    size_t zeroCopyThreshold_;                 // 零拷贝阈值 0表示未开启
+    uint32_t zeroCopyNextId_;                  // 下一次MSG_ZEROCOPY调用的序号
+    std::deque<ZeroCopyPending> zeroCopyPending_; // 等待完成通知的发送
+    size_t zeroCopyBytes_;
+    size_t zeroCopyCopiedBytes_;
+
+    // 流控
+    size_t flowHighMark_;                      // 0表示关闭
+    size_t flowLowMark_;
+    bool flowPaused_;                          // 本连接是否已暂停了生产者
+    bool hasFlowSource_;                       // false表示生产者是自身
+    std::weak_ptr<TcpConnection> flowSource_;
+    int readThrottled_;                        // 当前暂停本连接读的下游数 (含内存预算造成的暂停)
+    bool budgetPaused_;                        // 是否因内存预算紧张暂停了读
+    bool budgetWatching_;                      // 已在MemoryBudget登记了解除回调 (避免反复暂停时重复登记)
+
+    // 延迟flush
+    bool deferredFlush_;
+    bool corkOnFlush_;
+    bool flushScheduled_; // 本轮循环已经安排了flush
+
+    std::shared_ptr<TcpRelay> relay_; // 非空时该连接处于splice转发模式 (TcpRelay::start设置)
+
+    std::unique_ptr<TlsSession> tls_; // 非空时该连接使用TLS
+
+    std::shared_ptr<void> context_; // 用户上下文
+
 };
\ No newline at end of file
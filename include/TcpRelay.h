@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+
+class TcpConnection;
+
+/**
+ * 两条TcpConnection之间的内核态数据转发 (TCP代理/隧道)
+ *
+ * 普通转发: 内核 -> inputBuffer_ -> send -> outputBuffer_ -> 内核，每个字节拷贝两次
+ * splice转发: 内核 -> pipe -> 内核，数据不进入用户态
+ *
+ *   first  --splice--> pipe[0] --splice--> second
+ *   second --splice--> pipe[1] --splice--> first
+ *
+ * - 两条连接必须属于同一个EventLoop，所有操作在该loop线程中执行
+ * - 背压：目标连接不可写(pipe中还有数据)时停止读源连接，目标可写后再恢复
+ * - 内核不支持splice(或pipe创建失败)时退回到经过Buffer的普通转发
+ * - 半关闭：一端读到EOF后停止读它，pipe中的数据发完后半关闭另一端，反方向继续转发
+ *   两个方向都传递了EOF后关闭两条连接；任一方向出错时两条连接都立即关闭
+ */
+
+class TcpRelay : noncopyable,
+                 public std::enable_shared_from_this<TcpRelay>
+{
+public:
+    TcpRelay(const TcpConnectionPtr& first, const TcpConnectionPtr& second);
+    ~TcpRelay();
+
+    // 开始转发  必须在连接所属的loop线程中调用，两条连接都已建立
+    // 连接持有TcpRelay的shared_ptr，调用方不需要再保存
+    void start();
+
+    // 是否在使用splice (false表示至少有一个方向已退回普通转发)
+    bool spliceEnabled() const { return dirs_[0].splice && dirs_[1].splice; }
+
+    // 已转发的总字节数 (两个方向之和)
+    size_t bytesRelayed() const { return bytesRelayed_; }
+
+private:
+    friend class TcpConnection;
+
+    // 一个方向的转发状态 src -> pipe -> dst
+    struct Direction
+    {
+        std::weak_ptr<TcpConnection> src;
+        std::weak_ptr<TcpConnection> dst;
+        int pipeFds[2];   // pipeFds[0]读端 pipeFds[1]写端
+        size_t pipeBytes; // 当前滞留在pipe中的字节数
+        bool splice;      // 该方向是否使用splice
+        bool eof;         // src已读到EOF (之后不再读src)
+        bool done;        // EOF已经传递给dst (dst已半关闭)
+        bool srcPaused;   // 是否因背压暂停了读src (与TcpConnection的流控共用暂停计数)
+    };
+
+    // 由TcpConnection::handleRead调用  返回false表示该连接不再参与转发，走普通读流程
+    bool handleReadable(const TcpConnectionPtr& conn);
+    // 由TcpConnection::handleWrite在输出队列发完后调用
+    void handleWritable(const TcpConnectionPtr& conn);
+
+    void spliceRead(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst);
+    void bufferedRead(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst);
+    // 把pipe中的数据搬到dst 并根据结果调整背压
+    void flush(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst);
+    // src已EOF且数据全部转出 => 半关闭dst
+    void finish(Direction& dir, const TcpConnectionPtr& dst);
+    // 两个方向都已结束 => 关闭输出已经发完的连接
+    void closeIfDone();
+    // 读src出错 => 两条连接都关闭
+    void abort(const TcpConnectionPtr& src, const TcpConnectionPtr& dst);
+
+    // 背压：暂停/恢复读src  每个方向最多施加一次暂停
+    static void pauseSource(Direction& dir, const TcpConnectionPtr& src, bool on);
+
+    // 该方向放弃splice，关闭pipe
+    static void disableSplice(Direction& dir);
+
+    Direction dirs_[2];    // dirs_[0]: first->second  dirs_[1]: second->first
+    size_t bytesRelayed_;
+};
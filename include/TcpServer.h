@@ -49,6 +49,9 @@ public:
     void setMessageCallback   (const MessageCallback& cb)    { messageCallback_ = cb; }    // 消息处理回调
     void setWriteCommpleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; } // 写完成回调
 
+    // 开启TLS  新连接先完成握手再回调连接建立 (见TlsContext)  需在start之前设置
+    void setTlsContext(const TlsContextPtr& ctx) { tlsContext_ = ctx; }
+
     // 设置线程池中线程数量(底层subloop个数)   
     void setThreadNum (int numThreads); // 默认为0 即所有事件都在主线程处理
     /**
@@ -85,6 +88,8 @@ private:
 
     ThreadInitCallback threadInitCallback_; // 用户传入的subloop线程初始化时的回调
 
+    TlsContextPtr tlsContext_; // 非空时所有连接使用TLS
+
     int numThreads_;          // 线程池中线程的数量
     std::atomic_int started_; // 服务器是否已启动
     int nextConnId_;          // 为每个连接生成唯一表示（拼接成连接名）
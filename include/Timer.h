@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+/**
+ * 定时器  到期时间 + 回调 + 重复间隔
+ * 由TimerQueue创建和管理，用户通过TimerId取消
+ */
+
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(s_numCreated_.fetch_add(1) + 1)
+    {
+    }
+
+    // 执行定时器回调
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器：从now起再过interval秒到期
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return s_numCreated_.load(); }
+
+private:
+    const TimerCallback callback_; // 定时器回调
+    Timestamp expiration_;         // 下一次到期时间
+    const double interval_;        // 重复间隔(秒) 一次性定时器为0
+    const bool repeat_;            // 是否重复
+    const int64_t sequence_;       // 全局唯一序号 区分地址相同的新旧定时器
+
+    static std::atomic<int64_t> s_numCreated_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * 定时器的标识  EventLoop::runAt/runAfter/runEvery返回，用于EventLoop::cancel
+ * 可拷贝 不拥有Timer  定时器到期(或被取消)后再cancel没有副作用
+ */
+
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {
+    }
+
+    TimerId(Timer* timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {
+    }
+
+    bool valid() const { return timer_ != nullptr; }
+
+    friend class TimerQueue;
+
+private:
+    Timer* timer_;
+    int64_t sequence_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <set>
+#include <vector>
+#include <utility>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * 定时器队列  每个EventLoop一个
+ *
+ * 所有定时器按到期时间排序，只用一个timerfd：设置为最早到期的时间，
+ * timerfd可读时由loop线程取出所有到期的定时器执行回调，定时器回调和IO事件在同一个线程中串行执行
+ *
+ * addTimer/cancel 线程安全 (转到loop线程执行)
+ */
+
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop* loop);
+    ~TimerQueue();
+
+    // 添加定时器 在when时刻执行cb  interval>0时之后每interval秒执行一次
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    // 取消定时器
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;      // 按到期时间排序 时间相同再按地址
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;  // 按地址+序号查找 用于取消
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd可读时的回调
+    void handleRead();
+
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复定时器重新加入队列 其余的释放  然后按最早到期时间重设timerfd
+    void reset(const std::vector<Entry>& expired, Timestamp now);
+
+    // 插入定时器 返回最早到期时间是否改变
+    bool insert(Timer* timer);
+
+    EventLoop* loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList timers_;             // 按到期时间排序的定时器
+    ActiveTimerSet activeTimers_;  // 与timers_内容相同 按Timer*排序
+
+    bool callingExpiredTimers_;      // 是否正在执行到期的定时器回调
+    ActiveTimerSet cancelingTimers_; // 在回调中被取消的定时器 (重复定时器不再重新加入)
+};
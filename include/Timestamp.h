@@ -2,23 +2,70 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
+#include <time.h>
 
-// 事件戳类，表示微秒级的时间点
+// 事件戳类，表示微秒级的时间点 (自1970-01-01 00:00:00 UTC起的微秒数)
 class Timestamp
 {
 public:
-    // 默认构造
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
+    // 默认构造 无效时间点
     Timestamp();
 
     // 带参数的显示构造
     explicit Timestamp(int64_t microSecondSinceEpoch); // explicit禁止隐式转换
 
-    // 获取当前时间点的时间戳，返回一个Timestamp实例
+    // 获取当前时间点的时间戳，返回一个Timestamp实例  clock_gettime(CLOCK_REALTIME) 精确到微秒
     static Timestamp now();
+    // 粗粒度的当前时间 CLOCK_REALTIME_COARSE 精度为一个时钟节拍(通常1~4ms)，读取开销更小
+    // 适合统计、超时判断等不需要精确时间的地方
+    static Timestamp nowCoarse();
+
+    static Timestamp invalid() { return Timestamp(); }
+    static Timestamp fromUnixTime(time_t t, int microseconds = 0)
+    {
+        return Timestamp(static_cast<int64_t>(t) * kMicroSecondsPerSecond + microseconds);
+    }
+
+    bool valid() const { return microSecondSinceEpoch_ > 0; }
 
-    // 时间戳转换为字符串格式
+    int64_t microSecondsSinceEpoch() const { return microSecondSinceEpoch_; }
+    time_t secondsSinceEpoch() const { return static_cast<time_t>(microSecondSinceEpoch_ / kMicroSecondsPerSecond); }
+
+    // 时间戳转换为字符串格式 "YYYYMMDD HH:MM:SS"
     std::string toString() const; // const表示不会修改成员变量，保证toString仅用于读取数据
+    // "YYYYMMDD HH:MM:SS.uuuuuu"
+    std::string toFormattedString(bool showMicroseconds = true) const;
+    // 格式化到调用方的缓冲区 不分配内存 返回写入的长度 (日志热路径使用)
+    // 同一线程同一秒内的多次格式化复用缓存的日期和时分秒，不再调用localtime_r
+    size_t format(char* buf, size_t size, bool showMicroseconds = true) const;
 
 private:
     int64_t microSecondSinceEpoch_; // 以微秒为单位的时间戳值
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间点相差的秒数 high - low
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// timestamp 加上 seconds 秒
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "noncopyable.h"
+
+struct ssl_ctx_st; // OpenSSL的SSL_CTX  头文件中不引入OpenSSL
+
+class TlsContext;
+using TlsContextPtr = std::shared_ptr<TlsContext>;
+
+/**
+ * TLS配置 (封装OpenSSL的SSL_CTX)  一个TlsContext可以被所有连接、所有IO线程共享
+ *
+ * 握手在用户态由OpenSSL完成，之后记录层的加解密交给内核 (kTLS, setsockopt TCP_ULP "tls")：
+ * 连接照常用write/writev/sendfile发送明文，由内核加密，sendfile仍然不经过用户态
+ * 内核或密码套件不支持kTLS时自动退回OpenSSL用户态加解密 (SSL_read/SSL_write)，对用户透明
+ *
+ *   auto ctx = TlsContext::newServerContext("cert.pem", "key.pem");
+ *   server.setTlsContext(ctx);
+ *
+ *   auto cctx = TlsContext::newClientContext("ca.pem");
+ *   client.setTlsContext(cctx, "localhost");
+ *
+ * - 编译时没有找到OpenSSL则工厂函数返回nullptr
+ * - OpenSSL 3.0只支持TLS1.2接收方向的kTLS (TLS1.3只卸载发送)，需要收发都卸载时 setMaxTls12(true)
+ */
+
+class TlsContext : noncopyable
+{
+public:
+    // 服务端  证书链和私钥为PEM文件  失败返回nullptr
+    static TlsContextPtr newServerContext(const std::string& certFile, const std::string& keyFile);
+    // 客户端  caFile为空时不校验服务端证书
+    static TlsContextPtr newClientContext(const std::string& caFile = std::string());
+
+    ~TlsContext();
+
+    bool isServer() const { return server_; }
+    bool verifyPeer() const { return verify_; }
+
+    // 是否尝试kTLS (默认开启)  需在建立连接之前设置
+    void setKtls(bool on);
+    // 最高只协商TLS1.2
+    void setMaxTls12(bool on);
+
+    // 底层SSL_CTX
+    ssl_ctx_st* native() const { return ctx_; }
+
+private:
+    TlsContext(ssl_ctx_st* ctx, bool server, bool verify);
+
+    ssl_ctx_st* ctx_;
+    const bool server_;
+    const bool verify_;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "TlsContext.h"
+
+struct ssl_st; // OpenSSL的SSL
+
+class Buffer;
+
+/**
+ * 一条连接上的TLS会话 (封装SSL)  由TcpConnection持有，只在连接所属的loop线程中使用
+ *
+ * 非阻塞socket上的握手由TcpConnection在可读/可写事件中反复调用handshake()推进
+ * 握手完成后:
+ *   ktlsSend()  为true时发送方向已交给内核，连接直接write/writev/sendfile
+ *   ktlsRecv()  为true时接收方向已交给内核，连接直接readv  (非应用数据记录仍由read()处理)
+ * 否则该方向通过read()/write()在用户态加解密
+ */
+
+class TlsSession : noncopyable
+{
+public:
+    enum Result
+    {
+        kDone,      // 握手完成
+        kWantRead,  // 等待socket可读
+        kWantWrite, // 等待socket可写
+        kError,     // 握手失败
+    };
+
+    // hostname非空时 (客户端) 用于SNI和证书主机名校验
+    TlsSession(const TlsContextPtr& ctx, int sockfd, const std::string& hostname = std::string());
+    ~TlsSession();
+
+    Result handshake();
+
+    bool ktlsSend() const { return ktlsSend_; }
+    bool ktlsRecv() const { return ktlsRecv_; }
+
+    // 用户态解密读到buf  读到不能再读为止
+    // 返回读到的字节数；0表示对端关闭 (close_notify或EOF)；-1表示暂时没有完整记录(EAGAIN)或出错，错误码在savedErrno
+    ssize_t read(Buffer* buf, int* savedErrno);
+    // 用户态加密发送  返回写出的明文字节数，-1表示需要等待可写(EWOULDBLOCK)或出错
+    // 返回EWOULDBLOCK时OpenSSL可能已经缓存了一部分密文，下次必须从同样的数据开始重试
+    ssize_t write(const void* data, size_t len, int* savedErrno);
+
+    // OpenSSL中还有已解密、未读出的数据 (epoll不会再通知)
+    bool hasPending() const;
+    // 对端已发来close_notify
+    bool peerClosed() const { return peerClosed_; }
+
+    // 发送close_notify (不等待对端回复)
+    void shutdown();
+
+    // 协商结果 如 "TLSv1.3 TLS_AES_256_GCM_SHA384"
+    std::string description() const;
+
+private:
+    TlsContextPtr context_; // 保证SSL_CTX比SSL活得长
+    ssl_st* ssl_;
+    bool ktlsSend_;
+    bool ktlsRecv_;
+    bool peerClosed_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "UdpSocket.h"
+
+class EventLoop;
+class EventLoopThreadPool;
+
+/**
+ * UDP服务器
+ *
+ * 每个IO线程(没有设置线程数时就是baseLoop)各自创建一个绑定同一地址的UdpSocket (SO_REUSEPORT)，
+ * 内核按四元组哈希把数据报分给各个socket，接收在多个核上并行，socket之间没有共享状态
+ * 回调在收到数据报的那个loop线程中执行，回复用回调参数中的UdpSocket::send (同一loop，无锁)
+ *
+ * 用法:
+ *   UdpServer server(&loop, InetAddress(9999, "0.0.0.0"), "ingest");
+ *   server.setThreadNum(4);
+ *   server.setMessageCallback([](UdpSocket* sock, const char* data, size_t len, const InetAddress& peer, Timestamp) {
+ *       sock->send(data, len, peer); // echo
+ *   });
+ *   server.start();
+ */
+
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void (EventLoop*)>;
+
+    UdpServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& nameArg);
+    ~UdpServer();
+
+    void setThreadNum(int numThreads);
+    void setThreadInitCallback(const ThreadInitCallback& cb) { threadInitCallback_ = cb; }
+    void setMessageCallback(const UdpMessageCallback& cb)    { messageCallback_ = cb; }
+
+    // 接收选项 需在start之前设置
+    void setMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+    void enableGro(bool on) { gro_ = on; }
+    void enableGso(bool on) { gso_ = on; }
+
+    // 启动线程池 每个loop创建一个UdpSocket  只能调用一次
+    void start();
+
+    const std::string& name() const { return name_; }
+
+    // 所有socket的统计之和 (各loop线程中的原子计数，任意线程读取，只用于观察)
+    uint64_t receivedDatagrams() const;
+    uint64_t receiveCalls() const;
+    std::vector<UdpSocket*> sockets() const;
+
+private:
+    // 在每个loop线程中创建该loop的socket
+    void threadInit(EventLoop* loop);
+
+    EventLoop* loop_;
+    const InetAddress listenAddr_;
+    const std::string name_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+
+    UdpMessageCallback messageCallback_;
+    ThreadInitCallback threadInitCallback_;
+    size_t maxDatagramSize_;
+    bool gro_;
+    bool gso_;
+    std::atomic_int started_;
+
+    mutable std::mutex mutex_;  // 保护sockets_ (由各loop线程创建)
+    std::vector<std::unique_ptr<UdpSocket>> sockets_;
+};
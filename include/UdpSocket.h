@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include "Socket.h"
+#include "Channel.h"
+
+class EventLoop;
+class UdpSocket;
+
+// 收到一个数据报的回调  data指向本loop的接收slab，只在回调期间有效
+using UdpMessageCallback = std::function<void (UdpSocket* socket, const char* data, size_t len,
+                                               const InetAddress& peer, Timestamp receiveTime)>;
+
+/**
+ * 一个loop上的UDP socket (非阻塞，Channel + EventLoop)
+ *
+ * 接收：可读时用recvmmsg一次收一批(kBatch个)数据报到本socket独占的slab中，逐个交给回调
+ *       开启UDP_GRO(内核支持时)后，内核把同一流的多个数据报合并成一个大包交上来，按gso_size切分后再逐个回调
+ * 发送：send()只把数据报追加到发送队列，在本轮EventLoop循环末尾用sendmmsg一次发出
+ *       开启UDP_SEGMENT(GSO)时，发给同一对端、长度相同的连续数据报合并成一个大包，由内核(或网卡)切分
+ * 内核发送缓冲区满(EAGAIN)时丢弃剩余的数据报并计数 (UDP本身不保证送达)
+ *
+ * 只能在所属loop线程中使用和析构 (统计计数可以在任意线程读取)
+ */
+
+class UdpSocket : noncopyable
+{
+public:
+    static const int kBatch = 32;                  // 每次recvmmsg/sendmmsg最多的数据报数
+    static const size_t kMaxDatagram = 65536;      // GRO合并后的包最大64KB
+    static const size_t kMaxGsoSegments = 64;      // 一次GSO发送最多的段数 (内核UDP_MAX_SEGMENTS)
+
+    // maxDatagramSize: 不开启GRO时每个接收槽的大小，更长的数据报被截断(计入truncated)
+    UdpSocket(EventLoop* loop, const InetAddress& bindAddr, bool reusePort = true,
+              size_t maxDatagramSize = 2048, bool enableGro = true, bool enableGso = true);
+    ~UdpSocket();
+
+    void setMessageCallback(const UdpMessageCallback& cb) { messageCallback_ = cb; }
+
+    // 开始接收
+    void start();
+
+    // 发送一个数据报  在本轮循环末尾批量发出  其他线程调用时拷贝数据转到loop线程
+    void send(const void* data, size_t len, const InetAddress& peer);
+    // 立即发出已排队的数据报
+    void flush();
+
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return socket_.fd(); }
+    bool groEnabled() const { return gro_; }
+    bool gsoEnabled() const { return gso_; }
+
+    // 统计
+    uint64_t receivedDatagrams() const { return receivedDatagrams_.load(std::memory_order_relaxed); }
+    uint64_t receiveCalls() const      { return receiveCalls_.load(std::memory_order_relaxed); }      // recvmmsg调用次数
+    uint64_t groPackets() const        { return groPackets_.load(std::memory_order_relaxed); }        // 内核合并过的包数
+    uint64_t truncated() const         { return truncated_.load(std::memory_order_relaxed); }
+    uint64_t sentDatagrams() const     { return sentDatagrams_.load(std::memory_order_relaxed); }
+    uint64_t sendCalls() const         { return sendCalls_.load(std::memory_order_relaxed); }         // sendmmsg调用次数
+    uint64_t droppedDatagrams() const  { return droppedDatagrams_.load(std::memory_order_relaxed); }
+
+private:
+    // 待发送的数据报  数据在sendBuffer_中的位置
+    struct PendingSend
+    {
+        size_t offset;
+        size_t len;
+        sockaddr_in6 peer;   // 足以容纳IPv4/IPv6地址
+        socklen_t peerLen;
+    };
+
+    void handleRead(Timestamp receiveTime);
+    void dispatch(int index, Timestamp receiveTime);      // 回调第index个接收槽中的数据报
+    void sendInLoop(const std::string& data, const InetAddress& peer);
+    void queueSend(const void* data, size_t len, const InetAddress& peer);
+    size_t buildSendBatch(size_t first, bool useGso, size_t* consumed); // 组装一批mmsghdr 返回条数
+    void resetReceiveHeaders();
+
+    EventLoop* loop_;
+    Socket socket_;
+    Channel channel_;
+    UdpMessageCallback messageCallback_;
+
+    bool gro_;
+    bool gso_;
+    size_t slotSize_;
+
+    // 接收slab 每个槽一个数据报(或GRO合并后的包)
+    std::unique_ptr<char[]> slab_;
+    std::vector<struct mmsghdr> recvHeaders_;
+    std::vector<struct iovec> recvIovecs_;
+    std::vector<sockaddr_in6> recvAddrs_; // IPv4/IPv6对端地址
+    std::vector<char> recvControl_;
+
+    // 发送队列
+    std::string sendBuffer_;
+    std::vector<PendingSend> pending_;
+    bool flushScheduled_;
+    std::shared_ptr<bool> alive_; // 本轮末尾的flush通过weak_ptr判断socket是否已析构
+    std::vector<struct mmsghdr> sendHeaders_;
+    std::vector<struct iovec> sendIovecs_;
+    std::vector<char> sendControl_;
+    std::vector<size_t> sendCounts_; // 每个mmsghdr包含的数据报数
+
+    // 统计  只由loop线程写，其他线程(如UdpServer汇总时)可以读
+    std::atomic<uint64_t> receivedDatagrams_;
+    std::atomic<uint64_t> receiveCalls_;
+    std::atomic<uint64_t> groPackets_;
+    std::atomic<uint64_t> truncated_;
+    std::atomic<uint64_t> sentDatagrams_;
+    std::atomic<uint64_t> sendCalls_;
+    std::atomic<uint64_t> droppedDatagrams_;
+};
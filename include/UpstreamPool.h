@@ -0,0 +1,160 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "Timestamp.h"
+
+class EventLoop;
+class Connector;
+
+/**
+ * 上游连接池  复用到同一上游服务的长连接，代理热路径上不再有TCP握手和临时端口的消耗
+ *
+ * one loop per thread：每个EventLoop一个连接池 (如在TcpServer的ThreadInitCallback中创建)，
+ * 池中的连接都属于该loop，checkout/checkin只在loop线程中执行，不需要加锁
+ * (在其他线程调用时转到loop线程执行)
+ *
+ * - 空闲连接按后进先出取用 (最近用过的连接最"热")，最久未用的先被淘汰
+ * - 池中连接数(空闲+借出+正在连接)不超过maxSize；借不到连接的请求排队等待，
+ *   有连接归还或新连接建立时按先后顺序交给等待者，等待超过checkoutTimeout秒、排队已满或连接池已析构则以空指针回调
+ * - 健康检查：空闲连接被对端关闭立即移出池；空闲时收到数据(上游协议出错)则关闭；借出时再检查一次connected()
+ * - 维护定时器每秒运行一次：关闭空闲超过idleTimeout秒的连接(保留minSize个)，连接数不足minSize时补足
+ *
+ * 连接池需在loop线程中析构 (或loop结束之后)，借出中的连接在使用者归还前不会被关闭
+ * 析构后借出的连接不能再checkin，由使用者自己shutdown/forceClose (响应仍交给设置的消息回调)
+ *
+ * 统计：借出次数、命中(直接拿到空闲连接)、等待、超时、拒绝、新建/淘汰的连接数，以及等待时间的分布
+ */
+
+class UpstreamPool : noncopyable
+{
+public:
+    // 借到的连接  失败(超时/排队已满/连接池已关闭)时为空指针
+    using CheckoutCallback = std::function<void (const TcpConnectionPtr&)>;
+
+    // 等待时间分布的桶上限(微秒)  最后一个桶为 >= 1s
+    static const int kWaitBuckets = 6;
+    static const int64_t kWaitBucketLimits[kWaitBuckets - 1];
+
+    UpstreamPool(EventLoop* loop, const InetAddress& upstream, const std::string& name);
+    ~UpstreamPool();
+
+    // 配置 需在start之前设置
+    void setMinSize(size_t n)              { minSize_ = n; }
+    void setMaxSize(size_t n)              { maxSize_ = n > 0 ? n : 1; }
+    void setMaxWaiters(size_t n)           { maxWaiters_ = n; }
+    void setIdleTimeout(double seconds)    { idleTimeout_ = seconds; }
+    void setCheckoutTimeout(double seconds){ checkoutTimeout_ = seconds; }
+    void setRetryDelay(int initMs, int maxMs) { retryInitMs_ = initMs; retryMaxMs_ = maxMs; }
+
+    // 上游连接的回调  借出期间上游的响应通过messageCallback交给用户
+    void setMessageCallback(const MessageCallback& cb)       { messageCallback_ = cb; }
+    void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
+
+    // 建立minSize个连接 启动维护定时器
+    void start();
+
+    // 借一个连接  cb在loop线程中被调用 (可能在checkout内直接调用)
+    void checkout(CheckoutCallback cb);
+    // 归还连接  reusable为false(如请求处理到一半出错)时强制关闭该连接而不放回池中
+    // 不能在连接池析构后调用 (其他线程中调用后、执行前析构则直接关闭该连接)
+    void checkin(const TcpConnectionPtr& conn, bool reusable = true);
+
+    // 统计
+    size_t idleCount() const     { return idle_.size(); }
+    size_t busyCount() const     { return busy_.size(); }
+    size_t waitingCount() const  { return waiters_.size(); }
+    size_t connectingCount() const { return connectors_.size(); }
+    uint64_t checkouts() const   { return checkouts_; }
+    uint64_t hits() const        { return hits_; }
+    uint64_t waits() const       { return waits_; }
+    uint64_t timeouts() const    { return timeouts_; }
+    uint64_t rejected() const    { return rejected_; }
+    uint64_t connects() const    { return connects_; }
+    uint64_t evictions() const   { return evictions_; }
+    double hitRate() const
+    {
+        return checkouts_ == 0 ? 0.0 : static_cast<double>(hits_) / checkouts_;
+    }
+    // 第i个桶中的等待次数 (只统计排队后拿到连接的请求)
+    uint64_t waitHistogram(int i) const { return waitHistogram_[i]; }
+    // 可读的统计信息 (含等待时间分布)
+    std::string statsString() const;
+
+private:
+    // 排队等待连接的请求
+    struct Waiter
+    {
+        uint64_t id;
+        Timestamp enqueued;
+        CheckoutCallback callback;
+        TimerId timer; // 超时定时器
+    };
+
+    // 空闲连接
+    struct IdleConn
+    {
+        TcpConnectionPtr conn;
+        Timestamp since; // 开始空闲的时间
+    };
+
+    void startInLoop();
+    void checkoutInLoop(const CheckoutCallback& cb);
+    void checkinInLoop(const TcpConnectionPtr& conn, bool reusable);
+
+    size_t totalCount() const { return idle_.size() + busy_.size() + connectors_.size(); }
+    void connectOne();                                      // 新建一个到上游的连接
+    void newConnection(const std::shared_ptr<Connector>& connector, int sockfd);
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    void removeConnection(const TcpConnectionPtr& conn);    // 连接关闭
+    bool removeIdle(const TcpConnection* conn);             // 从空闲列表移除 返回是否在列表中
+    void handOut(const TcpConnectionPtr& conn);             // 连接可用：交给等待者或放回空闲列表
+    void onWaiterTimeout(uint64_t id);
+    void maintain();                                        // 维护定时器
+    void recordWait(Timestamp enqueued);
+
+    EventLoop* loop_;
+    const InetAddress upstream_;
+    const std::string name_;
+
+    size_t minSize_;
+    size_t maxSize_;
+    size_t maxWaiters_;
+    double idleTimeout_;
+    double checkoutTimeout_;
+    int retryInitMs_;
+    int retryMaxMs_;
+
+    MessageCallback messageCallback_;
+    ConnectionCallback connectionCallback_;
+
+    bool started_;
+    int nextConnId_;
+    uint64_t nextWaiterId_;
+    TimerId maintainTimer_;
+
+    std::deque<IdleConn> idle_;                                       // 空闲连接 队尾最近归还
+    std::unordered_map<TcpConnection*, TcpConnectionPtr> busy_;       // 已借出的连接
+    std::unordered_set<std::shared_ptr<Connector>> connectors_;       // 正在建立的连接
+    std::deque<Waiter> waiters_;                                      // 排队等待的请求
+    std::shared_ptr<bool> alive_;  // 定时器回调通过weak_ptr判断连接池是否已析构
+
+    uint64_t checkouts_;
+    uint64_t hits_;
+    uint64_t waits_;
+    uint64_t timeouts_;
+    uint64_t rejected_;
+    uint64_t connects_;
+    uint64_t evictions_;
+    uint64_t waitHistogram_[kWaitBuckets];
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * WebSocket帧 (RFC 6455) 的编码和解掩码
+ *
+ *   | FIN RSV(3) opcode(4) | MASK len(7) | [len 16/64位] | [mask key 4字节] | payload |
+ *
+ * 客户端发来的帧都带掩码，payload每个字节要与 key[i % 4] 异或
+ * 解掩码在x86-64上用SSE2 (基线指令集，每次16字节) 或AVX2 (CPU支持时，每次32字节) 原地异或，
+ * 其他平台回退到按8字节处理的标量实现；实现在首次使用前按CPU特性选定一次 (运行时分派)
+ */
+
+namespace WebSocketFrame
+{
+    enum Opcode
+    {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA,
+    };
+
+    static const size_t kMaxHeaderLen = 14;      // 2 + 8字节长度 + 4字节mask key
+    static const size_t kMaxServerHeaderLen = 10; // 服务端发出的帧不带掩码
+    static const size_t kMaxControlPayload = 125;
+
+    inline bool isControl(int opcode) { return (opcode & 0x8) != 0; }
+
+    // 写服务端帧头 (FIN置位、不带掩码) 到out (至少kMaxServerHeaderLen字节)  返回帧头长度
+    size_t encodeHeader(char* out, Opcode opcode, size_t payloadLen);
+
+    // 用4字节key原地解掩码 data[0, n)，data从payload的第一个字节开始
+    void unmask(char* data, size_t n, const char key[4]);
+    // 标量实现  用于对照和测试
+    void unmaskPortable(char* data, size_t n, const char key[4]);
+    // 当前使用的实现 "avx2"/"sse2"/"scalar"
+    const char* unmaskImplementation();
+}
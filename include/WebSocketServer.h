@@ -0,0 +1,112 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+#include "TcpServer.h"
+#include "TimerId.h"
+#include "StringPiece.h"
+#include "noncopyable.h"
+
+class HttpContext;
+class HttpRequest;
+
+/**
+ * WebSocket服务器 (RFC 6455)  基于TcpServer
+ *
+ * - 握手：升级请求用HttpContext解析，应答101 + Sec-WebSocket-Accept (内置SHA1/base64，不依赖OpenSSL)
+ *   不是WebSocket升级的请求应答426并关闭  普通HTTP请求应当由HttpServer在其他端口处理
+ * - 收帧：直接在连接的输入Buffer上解析，帧完整后原地解掩码 (SSE2/AVX2，见WebSocketFrame)
+ *   不分片的消息回调拿到的就是输入缓冲区上的切片，不拷贝；分片消息拼接到连接的缓冲中 (容量复用)
+ * - 控制帧：ping自动回pong；收到close回送close后半关闭；协议错误时发送对应状态码的close并关闭
+ * - 发帧：帧头和payload两段sendv，不拼接；同一条消息发给多个连接时用makeFrame编码一次，
+ *   conn->send(frame) 按引用排进各连接的输出队列，超过零拷贝阈值时走MSG_ZEROCOPY
+ * - 心跳：可选每隔pingInterval发ping，一个间隔内没有收到任何数据的连接被断开
+ *
+ * 回调在连接所属的IO线程中执行  不校验文本消息的UTF-8
+ */
+
+class WebSocketServer : noncopyable
+{
+public:
+    enum CloseCode
+    {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kMessageTooBig = 1009,
+    };
+
+    // 握手完成  request只在回调期间有效 (可以按path等决定是否close)
+    using OpenCallback = std::function<void (const TcpConnectionPtr&, const HttpRequest&)>;
+    // 一条完整的消息 (分片已拼好)  message只在回调期间有效
+    using DataCallback = std::function<void (const TcpConnectionPtr&, const StringPiece& message, bool binary, Timestamp)>;
+
+    static const size_t kMaxHandshakeBytes = 8 * 1024;
+    static const size_t kDefaultMaxMessageBytes = 16 * 1024 * 1024;
+
+    WebSocketServer(EventLoop* loop,
+                    const InetAddress& listenAddr,
+                    const std::string& name,
+                    TcpServer::Option option = TcpServer::kNoReusePort);
+
+    void setOpenCallback(const OpenCallback& cb) { openCallback_ = cb; }
+    void setMessageCallback(const DataCallback& cb) { messageCallback_ = cb; }
+    void setCloseCallback(const ConnectionCallback& cb) { closeCallback_ = cb; } // 握手完成过的连接断开
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    void setTlsContext(const TlsContextPtr& ctx) { server_.setTlsContext(ctx); } // wss
+    // 以下需在start之前设置
+    // 单条消息(含分片拼接后)的上限  超过时以1009关闭连接
+    void setMaxMessageBytes(size_t bytes) { maxMessageBytes_ = bytes; }
+    // 心跳间隔(秒)  0表示不发ping (默认)
+    void setPingInterval(double seconds) { pingInterval_ = seconds; }
+    // 握手完成的连接开启零拷贝发送 (见TcpConnection::setZeroCopyThreshold)  0表示不开启 (默认)
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+
+    void start() { server_.start(); }
+
+    // 发送一条消息  线程安全
+    static void send(const TcpConnectionPtr& conn, const StringPiece& message, bool binary = false);
+    // 编码成完整的帧  用conn->send(frame)发给任意多个连接
+    static SharedPayload makeFrame(const StringPiece& message, bool binary = false);
+    // 发起关闭握手：发出close帧后半关闭连接  线程安全
+    static void close(const TcpConnectionPtr& conn, uint16_t code = kNormalClosure,
+                      const StringPiece& reason = StringPiece());
+
+private:
+    struct Session // 连接上下文
+    {
+        Session();
+        ~Session();
+
+        std::unique_ptr<HttpContext> handshake; // 握手完成前非空
+        int opcode;            // 正在拼接的分片消息的类型  0表示没有
+        std::string fragments; // 分片消息已收到的部分
+        bool closing;          // 已经发出close帧 之后收到的数据丢弃
+        bool active;           // 上次ping之后收到过数据
+        TimerId pingTimer;
+    };
+
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    bool handshake(const TcpConnectionPtr& conn, Session* session, Buffer* buf, Timestamp receiveTime);
+    void open(const TcpConnectionPtr& conn, Session* session);
+    void handleFrame(const TcpConnectionPtr& conn, Session* session, int opcode, bool fin,
+                     const StringPiece& payload, Timestamp receiveTime);
+
+    static void sendFrame(const TcpConnectionPtr& conn, int opcode, const StringPiece& payload);
+    static void closeInLoop(const TcpConnectionPtr& conn, Session* session, uint16_t code, const StringPiece& reason);
+    static void onPingTimer(const std::weak_ptr<TcpConnection>& weakConn);
+
+    OpenCallback openCallback_;
+    DataCallback messageCallback_;
+    ConnectionCallback closeCallback_;
+    size_t maxMessageBytes_;
+    double pingInterval_;
+    size_t zeroCopyThreshold_;
+
+    TcpServer server_; // 最先析构
+};
@@ -6,14 +6,16 @@
 #include "Acceptor.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "EventLoop.h"
+#include "MemoryBudget.h"
 
 // 创建非阻塞监听 socket 的辅助函数
-static int createNonblocking()
+static int createNonblocking(sa_family_t family)
 {
-    // 创建一个非阻塞、自动关闭的 TCP socket
-    int sockfd = ::socket(AF_INET,      // IPv4地址族
-                          SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, // 面向连接TCP | 非阻塞 | exec()系列系统调用时自动关闭fd
-                          IPPROTO_TCP); // 明确指定TCP协议
+    // 创建一个非阻塞、自动关闭的流式 socket
+    int sockfd = ::socket(family,       // 与监听地址一致 IPv4/IPv6/Unix域
+                          SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, // 面向连接 | 非阻塞 | exec()系列系统调用时自动关闭fd
+                          0);           // 由地址族决定协议 (AF_INET/AF_INET6即TCP)
     
     // 创建失败，记录致命错误并中止程序运行
     if (sockfd < 0)
@@ -28,13 +30,29 @@ static int createNonblocking()
 // 构造  传入 mainLoop指针loop  指定监听地址listenAddr  是否设置SO_REUSEPORT标志reuseport
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport)
     : loop_(loop)                               // 保存传入的mainLoop指针
-    , acceptSocket_(createNonblocking())        // 创建非阻塞 TCP socket (listenfd)
+    , acceptSocket_(createNonblocking(listenAddr.family())) // 创建非阻塞 socket (listenfd)
     , acceptChannel_(loop, acceptSocket_.fd())  // 将该 acceptSocket_ 封装成 Channel
     , listenning_(false)                        // 初始为 false，尚未监听
+    , paused_(false)
+    , alive_(std::make_shared<bool>(true))
 {
-    // 设置socket选项
-    acceptSocket_.setReuseAddr(true); // 允许地址重复使用
-    acceptSocket_.setReusePort(true); // 允许多个socket监听同一端口 IP:Port
+    if (listenAddr.isUnix())
+    {
+        // Unix域套接字绑定的是文件路径  上次进程退出留下的socket文件会导致bind失败(EADDRINUSE)，先删除
+        // 抽象命名空间('@'开头)没有文件
+        std::string path = listenAddr.toIp();
+        if (!path.empty() && path[0] != '@')
+        {
+            unixPath_ = path;
+            ::unlink(unixPath_.c_str());
+        }
+    }
+    else
+    {
+        // 设置socket选项
+        acceptSocket_.setReuseAddr(true); // 允许地址重复使用
+        acceptSocket_.setReusePort(true); // 允许多个socket监听同一端口 IP:Port
+    }
 
     // 绑定socket到指定的地址(IP+Port)
     acceptSocket_.bindAddress(listenAddr);
@@ -49,6 +67,10 @@ Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll(); // 把Poller中感兴趣的事件都取消监听
     acceptChannel_.remove();     // 删除Channel
+    if (!unixPath_.empty())
+    {
+        ::unlink(unixPath_.c_str()); // 删除bind时创建的socket文件
+    }
 }
 
 
@@ -65,6 +87,13 @@ void Acceptor::listen()
 // 处理新用户连接事件的回调 (acceptChannel_ 注册的“读事件回调函数”)
 void Acceptor::handleRead() // 当 listenfd 可读（有新连接到达）时，EventLoop 会回调本函数
 {
+    // 内存预算紧张 不再接收新连接
+    if (MemoryBudget::instance().underPressure())
+    {
+        pauseAccepting();
+        return;
+    }
+
     InetAddress peerAddr; // 保存客户端的地址信息 IP+端口
 
     // 调用 accept() 获取新连接
@@ -90,4 +119,41 @@ void Acceptor::handleRead() // 当 listenfd 可读（有新连接到达）时，
             LOG_ERROR("%s:%s:%d sockfd reached limit\n", __FILE__, __FUNCTION__, __LINE__);
         }
     }
+}
+
+
+// 暂停accept
+void Acceptor::pauseAccepting()
+{
+    if (paused_)
+    {
+        return;
+    }
+    paused_ = true;
+    acceptChannel_.disableReading(); // 不再监听listenfd 避免LT模式下反复触发
+    LOG_INFO("Acceptor pause accepting, memory usage:%lu\n", MemoryBudget::instance().usage());
+
+    // 紧张解除时回到mainLoop恢复 (在解除回调执行前Acceptor可能已经析构)
+    std::weak_ptr<bool> alive(alive_);
+    EventLoop* loop = loop_;
+    MemoryBudget::instance().runWhenRelieved([alive, loop, this]() {
+        loop->queueInLoop([alive, this]() {
+            if (alive.lock())
+            {
+                resumeAccepting();
+            }
+        });
+    });
+}
+
+
+// 恢复accept
+void Acceptor::resumeAccepting()
+{
+    if (paused_ && listenning_)
+    {
+        paused_ = false;
+        acceptChannel_.enableReading();
+        LOG_INFO("Acceptor resume accepting\n");
+    }
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+
+AsyncLogging::AsyncLogging(const std::string& basename, int flushInterval, off_t rollSize, int fsyncInterval)
+    : flushInterval_(flushInterval > 0 ? flushInterval : 1)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , fsyncInterval_(fsyncInterval)
+    , running_(false)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging")
+    , currentBuffer_(new LogBuffer)
+    , nextBuffer_(new LogBuffer)
+    , flushRequested_(0)
+    , flushCompleted_(0)
+{
+    buffers_.reserve(16);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    flushCond_.notify_all();
+    thread_.join();
+}
+
+
+// 前端写日志  只拷贝到内存
+void AsyncLogging::append(const char* logline, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+    }
+    else
+    {
+        // 当前缓冲区写满 => 交给后端，换上预备缓冲区
+        buffers_.push_back(std::move(currentBuffer_));
+        if (nextBuffer_)
+        {
+            currentBuffer_ = std::move(nextBuffer_);
+        }
+        else
+        {
+            currentBuffer_.reset(new LogBuffer); // 前端写得太快，预备缓冲区也用完了 (很少发生)
+        }
+        currentBuffer_->append(logline, len);
+        cond_.notify_one();
+    }
+}
+
+
+// 等待此前的日志写入文件
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    int64_t target = ++flushRequested_;
+    cond_.notify_one();
+    flushCond_.wait(lock, [this, target]() { return flushCompleted_ >= target || !running_; });
+}
+
+
+// 后端线程  成批把缓冲区写入文件
+void AsyncLogging::threadFunc()
+{
+    // 只有后端线程写文件 不需要加锁  打开失败时LogFile改写stderr
+    LogFile output(basename_, rollSize_, false, flushInterval_, fsyncInterval_);
+
+    // 后端自己准备两块缓冲区 与前端交换，避免前端分配内存
+    BufferPtr newBuffer1(new LogBuffer);
+    BufferPtr newBuffer2(new LogBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+
+    bool running = true;
+    while (running)
+    {
+        int64_t flushTarget = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // 没有写满的缓冲区也没有flush请求 => 最多等flushInterval_秒
+            if (buffers_.empty() && flushRequested_ == flushCompleted_ && running_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            running = running_;
+
+            // 当前缓冲区(即使没写满)也一并写出
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+            flushTarget = flushRequested_;
+        }
+
+        // 积压过多 只保留前两块，丢弃其余日志
+        if (buffersToWrite.size() > kMaxPendingBuffers)
+        {
+            char buf[256];
+            int n = snprintf(buf, sizeof buf, "Dropped log messages, %lu larger buffers\n",
+                             static_cast<unsigned long>(buffersToWrite.size() - 2));
+            fputs(buf, stderr);
+            output.append(buf, n);
+            buffersToWrite.resize(2);
+        }
+
+        for (const BufferPtr& buffer : buffersToWrite)
+        {
+            if (buffer->length() > 0)
+            {
+                output.append(buffer->data(), buffer->length());
+            }
+        }
+
+        // 回收两块缓冲区给下一轮使用
+        if (buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+        if (!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2)
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        buffersToWrite.clear();
+        output.flush(); // fflush 到期时fdatasync
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushCompleted_ = flushTarget;
+        }
+        flushCond_.notify_all();
+    }
+}
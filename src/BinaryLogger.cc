@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <unistd.h>  // usleep
+
+#include "BinaryLogger.h"
+#include "Thread.h"
+
+std::atomic_bool BinaryLogger::s_active(false);
+
+namespace
+{
+__thread void* t_ring = nullptr;   // 本线程的BinaryLogger::Ring
+__thread bool t_ringRetired = false; // 本线程的ring已交给后台线程释放 (线程退出阶段)
+
+// 线程退出时把它的环形缓冲区标记为retired，由后台线程读空后释放
+// 之后本线程(其他thread_local对象析构时)的日志直接丢弃，不能再碰已交出的ring
+struct RingHolder
+{
+    RingHolder() : ring(nullptr) { }
+    ~RingHolder()
+    {
+        if (ring)
+        {
+            ring->store(true);
+            ring = nullptr;
+            t_ring = nullptr;
+            t_ringRetired = true;
+        }
+    }
+    std::atomic_bool* ring;
+};
+
+thread_local RingHolder t_ringHolder;
+
+const char kFileMagic[] = "MUBLOG01";
+const int kFlushInterval = 1; // 至少每秒fflush一次
+}
+
+
+BinaryLogger& BinaryLogger::instance()
+{
+    static BinaryLogger logger;
+    return logger;
+}
+
+BinaryLogger::BinaryLogger()
+    : formatsWritten_(0)
+    , ringBytes_(1024 * 1024)
+    , dropped_(0)
+    , running_(false)
+{
+}
+
+BinaryLogger::~BinaryLogger()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+
+// 开始写二进制日志
+void BinaryLogger::start(const std::string& filename, size_t ringBytes)
+{
+    if (running_)
+    {
+        return;
+    }
+    filename_ = filename;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ringBytes_ = ringBytes < 4096 ? 4096 : ringBytes;
+    }
+    formatsWritten_ = 0; // 新文件重新写一遍字典
+    running_ = true;
+    s_active = true; // 打开文件失败时由后台线程关闭
+    thread_.reset(new Thread(std::bind(&BinaryLogger::threadFunc, this), "BinaryLogger"));
+    thread_->start();
+}
+
+
+void BinaryLogger::stop()
+{
+    if (!running_)
+    {
+        return;
+    }
+    s_active = false;
+    running_ = false;
+    thread_->join(); // 后台线程退出前把已提交的记录全部写出
+    thread_.reset();
+}
+
+
+// 注册格式串
+uint32_t BinaryLogger::registerFormat(int level, const char* file, int line, const char* fmt)
+{
+    BinaryLogger& logger = instance();
+    std::unique_lock<std::mutex> lock(logger.mutex_);
+    Format format;
+    format.level = level;
+    format.line = line;
+    format.file = file;
+    format.fmt = fmt;
+    logger.formats_.push_back(std::move(format));
+    return static_cast<uint32_t>(logger.formats_.size() - 1);
+}
+
+
+// 本线程的环形缓冲区 第一次使用时创建
+BinaryLogger::Ring* BinaryLogger::threadRing()
+{
+    if (__builtin_expect(t_ring == nullptr, 0))
+    {
+        if (t_ringRetired)
+        {
+            return nullptr;
+        }
+        BinaryLogger& logger = instance();
+        std::unique_lock<std::mutex> lock(logger.mutex_);
+        Ring* ring = new Ring(logger.ringBytes_);
+        logger.rings_.emplace_back(ring);
+        t_ring = ring;
+        t_ringHolder.ring = &ring->retired;
+    }
+    return static_cast<Ring*>(t_ring);
+}
+
+
+// 预留连续的size字节  放不下尾部时写一个回绕标记(len=0)从头开始
+char* BinaryLogger::reserve(size_t size)
+{
+    Ring* ring = threadRing();
+    if (ring == nullptr) // 线程正在退出
+    {
+        instance().dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    size_t pos = static_cast<size_t>(head % ring->capacity);
+    size_t toEnd = ring->capacity - pos;
+
+    size_t need = size;
+    if (toEnd < size)
+    {
+        need += toEnd; // 尾部空间浪费掉
+    }
+    if (ring->capacity - static_cast<size_t>(head - tail) < need)
+    {
+        instance().dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (toEnd < size)
+    {
+        if (toEnd >= sizeof(uint32_t))
+        {
+            uint32_t wrap = 0;
+            ::memcpy(ring->data.get() + pos, &wrap, sizeof wrap);
+        }
+        // 跳过尾部 回绕标记先于新的head对后台线程可见
+        ring->head.store(head + toEnd, std::memory_order_release);
+        pos = 0;
+    }
+    return ring->data.get() + pos;
+}
+
+
+void BinaryLogger::commit(size_t size)
+{
+    Ring* ring = static_cast<Ring*>(t_ring);
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->head.store(head + size, std::memory_order_release); // 记录内容对后台线程可见
+}
+
+
+// 收集所有线程的记录 追加到out
+bool BinaryLogger::drainRings(std::string* out)
+{
+    std::vector<Ring*> rings;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        rings.reserve(rings_.size());
+        for (const std::unique_ptr<Ring>& ring : rings_)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    bool any = false;
+    for (Ring* ring : rings)
+    {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        while (tail < head)
+        {
+            size_t pos = static_cast<size_t>(tail % ring->capacity);
+            size_t toEnd = ring->capacity - pos;
+            uint32_t len = 0;
+            if (toEnd >= sizeof len)
+            {
+                ::memcpy(&len, ring->data.get() + pos, sizeof len);
+            }
+            if (len == 0) // 回绕标记(或放不下标记的尾部)
+            {
+                tail += toEnd;
+                continue;
+            }
+            out->push_back('R');
+            out->append(ring->data.get() + pos, len);
+            tail += len;
+            any = true;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    // 释放已退出线程的空缓冲区
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < rings_.size(); )
+        {
+            Ring* ring = rings_[i].get();
+            if (ring->retired.load() && ring->tail.load() == ring->head.load())
+            {
+                rings_[i].swap(rings_.back());
+                rings_.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+    return any;
+}
+
+
+// 写出新注册的格式串  必须在收集记录之后调用：记录可见时它的格式串一定已经注册
+void BinaryLogger::writeFormats(std::string* out)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (; formatsWritten_ < formats_.size(); ++formatsWritten_)
+    {
+        const Format& format = formats_[formatsWritten_];
+        uint32_t id = static_cast<uint32_t>(formatsWritten_);
+        uint32_t fileLen = static_cast<uint32_t>(format.file.size());
+        uint32_t fmtLen = static_cast<uint32_t>(format.fmt.size());
+        int32_t level = format.level;
+        int32_t line = format.line;
+
+        out->push_back('F');
+        out->append(reinterpret_cast<const char*>(&id), sizeof id);
+        out->append(reinterpret_cast<const char*>(&level), sizeof level);
+        out->append(reinterpret_cast<const char*>(&line), sizeof line);
+        out->append(reinterpret_cast<const char*>(&fileLen), sizeof fileLen);
+        out->append(format.file);
+        out->append(reinterpret_cast<const char*>(&fmtLen), sizeof fmtLen);
+        out->append(format.fmt);
+    }
+}
+
+
+// 后台线程
+void BinaryLogger::threadFunc()
+{
+    FILE* fp = ::fopen(filename_.c_str(), "we");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "BinaryLogger: open %s failed\n", filename_.c_str());
+        s_active = false;
+        return;
+    }
+    ::fwrite(kFileMagic, 1, sizeof kFileMagic - 1, fp);
+
+    std::string records;
+    std::string formats;
+    time_t lastFlush = ::time(nullptr);
+    bool running = true;
+    while (running)
+    {
+        running = running_; // 停止后再收集最后一轮
+
+        records.clear();
+        formats.clear();
+        bool any = drainRings(&records);
+        writeFormats(&formats);
+
+        if (!formats.empty())
+        {
+            ::fwrite(formats.data(), 1, formats.size(), fp);
+        }
+        if (any)
+        {
+            ::fwrite(records.data(), 1, records.size(), fp);
+        }
+
+        time_t now = ::time(nullptr);
+        if (now - lastFlush >= kFlushInterval || !running) // 定期fflush 限制崩溃时丢失的日志
+        {
+            ::fflush(fp);
+            lastFlush = now;
+        }
+        if (!any)
+        {
+            ::usleep(1000); // 空闲时每毫秒检查一次
+        }
+    }
+
+    uint64_t dropped = dropped_.load();
+    if (dropped > 0)
+    {
+        fprintf(stderr, "BinaryLogger: dropped %lu records\n", static_cast<unsigned long>(dropped));
+    }
+    ::fclose(fp);
+}
@@ -89,7 +89,7 @@ void Channel::update()
  void Channel::handleEventWithGuard(Timestamp receiveTime)
  {
     // 日志记录revents_
-    LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LOG_DEBUG("channel handleEvent revents:%d\n", revents_); // 每个事件都会执行 只在调试级别输出
 
     // 关闭or挂起事件 EPOLLHUB
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) 
@@ -0,0 +1,269 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+namespace
+{
+// 创建非阻塞的流式socket  地址族与服务端地址一致 (IPv4/IPv6为TCP，或Unix域)
+int createNonblocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d connect socket create err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+// 读取并清除socket上的待处理错误
+int getSocketError(int sockfd)
+{
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+// 自连接：连接本机未被监听的端口时，内核可能把本地临时端口分配成目标端口，connect连上了自己
+// Unix域套接字没有临时端口 不会自连接
+bool isSelfConnect(int sockfd)
+{
+    InetAddress local(InetAddress::getLocalAddr(sockfd));
+    if (local.isUnix())
+    {
+        return false;
+    }
+    InetAddress peer(InetAddress::getPeerAddr(sockfd));
+    return local.toPort() == peer.toPort() && local.toIp() == peer.toIp();
+}
+}
+
+
+Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , initRetryDelayMs_(kInitRetryDelayMs)
+    , maxRetryDelayMs_(kMaxRetryDelayMs)
+    , retryDelayMs_(kInitRetryDelayMs)
+{
+    LOG_DEBUG("Connector ctor[%p]\n", this);
+}
+
+Connector::~Connector()
+{
+    LOG_DEBUG("Connector dtor[%p]\n", this);
+}
+
+
+void Connector::setRetryDelay(int initMs, int maxMs)
+{
+    initRetryDelayMs_ = initMs > 0 ? initMs : 1;
+    maxRetryDelayMs_ = maxMs > initRetryDelayMs_ ? maxMs : initRetryDelayMs_;
+    retryDelayMs_ = initRetryDelayMs_;
+}
+
+
+// 开始连接  可以在任意线程调用
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (connect_ && state_ == kDisconnected)
+    {
+        connect();
+    }
+    else if (!connect_)
+    {
+        LOG_DEBUG("Connector::startInLoop do not connect\n");
+    }
+}
+
+
+// 停止连接  取消等待中的重试
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    loop_->cancel(retryTimer_);
+    if (state_ == kConnecting)
+    {
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+
+// 重新连接  在loop线程中调用(如连接断开的回调中)
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelayMs_ = initRetryDelayMs_;
+    connect_ = true;
+    startInLoop();
+}
+
+
+// 发起非阻塞connect 按errno分类处理
+void Connector::connect()
+{
+    int sockfd = createNonblocking(serverAddr_.family());
+    int ret = ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS: // 非阻塞connect正在进行
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    // 暂时性错误 稍后重试
+    case EAGAIN:        // 本地临时端口用完 / Unix域: 服务端backlog已满 (非阻塞connect不会返回EINPROGRESS)
+    case ENOENT:        // Unix域: 服务端尚未创建socket文件
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+    case ETIMEDOUT:
+        retry(sockfd);
+        break;
+
+    // 地址或socket本身有问题 重试也不会成功
+    case EACCES:
+    case EPERM:
+    case EAFNOSUPPORT:
+    case EALREADY:
+    case EBADF:
+    case EFAULT:
+    case ENOTSOCK:
+        LOG_ERROR("Connector::connect to %s error:%d\n", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        break;
+
+    default:
+        LOG_ERROR("Connector::connect to %s unexpected error:%d\n", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        break;
+    }
+}
+
+
+// 连接进行中  等待socket可写
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+}
+
+
+// 不再监听连接中的socket  返回sockfd
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 当前可能正处在Channel::handleEvent中，不能马上释放channel_，延后到本轮的pendingFunctors
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+
+// socket可写：连接完成或失败
+void Connector::handleWrite()
+{
+    if (state_ != kConnecting) // 同一轮中handleError已经处理过
+    {
+        return;
+    }
+
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err)
+    {
+        LOG_ERROR("Connector::handleWrite connect to %s error:%d %s\n",
+                  serverAddr_.toIpPort().c_str(), err, strerror(err));
+        retry(sockfd);
+    }
+    else if (isSelfConnect(sockfd))
+    {
+        LOG_ERROR("Connector::handleWrite self connect to %s\n", serverAddr_.toIpPort().c_str());
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        if (connect_)
+        {
+            retryDelayMs_ = initRetryDelayMs_;
+            newConnectionCallback_(sockfd); // sockfd交给TcpConnection管理
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+
+void Connector::handleError()
+{
+    if (state_ == kConnecting)
+    {
+        int sockfd = removeAndResetChannel();
+        int err = getSocketError(sockfd);
+        LOG_ERROR("Connector::handleError connect to %s error:%d %s\n",
+                  serverAddr_.toIpPort().c_str(), err, strerror(err));
+        retry(sockfd);
+    }
+}
+
+
+// 关闭失败的socket  retryDelayMs_后重新连接，间隔翻倍
+void Connector::retry(int sockfd)
+{
+    ::close(sockfd);
+    setState(kDisconnected);
+    if (connect_)
+    {
+        LOG_INFO("Connector::retry connecting to %s in %d milliseconds\n",
+                 serverAddr_.toIpPort().c_str(), retryDelayMs_);
+        retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0,
+                                      std::bind(&Connector::startInLoop, shared_from_this()));
+        retryDelayMs_ = retryDelayMs_ * 2 < maxRetryDelayMs_ ? retryDelayMs_ * 2 : maxRetryDelayMs_;
+    }
+    else
+    {
+        LOG_DEBUG("Connector::retry do not connect\n");
+    }
+}
@@ -0,0 +1,131 @@
+#include "Crc32c.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h> // SSE4.2 _mm_crc32_*
+#endif
+
+namespace
+{
+const uint32_t kPolyReflected = 0x82F63B78; // 0x1EDC6F41 按位反转
+
+// slicing-by-8 查表  tables[k][i] 为字节i后面再跟k个0字节的crc
+struct Tables
+{
+    uint32_t t[8][256];
+
+    Tables()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; ++j)
+            {
+                crc = (crc >> 1) ^ ((crc & 1) ? kPolyReflected : 0);
+            }
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            for (int k = 1; k < 8; ++k)
+            {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+const Tables& tables()
+{
+    static const Tables s_tables; // C++11保证局部静态变量初始化线程安全
+    return s_tables;
+}
+
+uint32_t extendPortable(uint32_t crc, const char* data, size_t n)
+{
+    const Tables& tab = tables();
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    uint32_t l = crc ^ 0xffffffffu;
+    while (n >= 8)
+    {
+        uint32_t lo = 0;
+        uint32_t hi = 0;
+        ::memcpy(&lo, p, 4);
+        ::memcpy(&hi, p + 4, 4);
+        lo ^= l; // 小端机器 crc按字节逆序与数据异或
+        l = tab.t[7][lo & 0xff] ^ tab.t[6][(lo >> 8) & 0xff] ^ tab.t[5][(lo >> 16) & 0xff] ^ tab.t[4][lo >> 24]
+          ^ tab.t[3][hi & 0xff] ^ tab.t[2][(hi >> 8) & 0xff] ^ tab.t[1][(hi >> 16) & 0xff] ^ tab.t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0)
+    {
+        l = tab.t[0][(l ^ *p++) & 0xff] ^ (l >> 8);
+    }
+    return l ^ 0xffffffffu;
+}
+
+#if defined(__x86_64__)
+// 只有这个函数用SSE4.2编译 其余代码仍按基线指令集编译
+__attribute__((target("sse4.2")))
+uint32_t extendSse42(uint32_t crc, const char* data, size_t n)
+{
+    const char* p = data;
+    uint64_t l = crc ^ 0xffffffffu;
+    // 先按字节处理到8字节对齐
+    while (n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0)
+    {
+        l = _mm_crc32_u8(static_cast<uint32_t>(l), static_cast<uint8_t>(*p++));
+        --n;
+    }
+    while (n >= 8)
+    {
+        uint64_t word;
+        ::memcpy(&word, p, sizeof word);
+        l = _mm_crc32_u64(l, word);
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0)
+    {
+        l = _mm_crc32_u8(static_cast<uint32_t>(l), static_cast<uint8_t>(*p++));
+    }
+    return static_cast<uint32_t>(l) ^ 0xffffffffu;
+}
+#endif
+
+using ExtendFunc = uint32_t (*)(uint32_t, const char*, size_t);
+
+ExtendFunc chooseExtend()
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return extendSse42;
+    }
+#endif
+    return extendPortable;
+}
+
+// 运行时分派  首次调用时选定一次 (局部静态变量 不受全局对象初始化顺序影响)
+ExtendFunc extendFunc()
+{
+    static const ExtendFunc s_extend = chooseExtend();
+    return s_extend;
+}
+}
+
+
+namespace Crc32c
+{
+    uint32_t extend(uint32_t crc, const char* data, size_t n)
+    {
+        return extendFunc()(crc, data, n);
+    }
+
+    bool hardwareAccelerated()
+    {
+        return extendFunc() != extendPortable;
+    }
+}
@@ -46,8 +46,8 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
      * activeChannels：用于输出发生事件的 Channel 指针列表（fiiActiveChannels填充）
      */
 
-    // 打印日志：当前注册在epoll中的channel总数量 （实际部署建议使用 LOG_DEBUG 或关闭）
-    LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    // 打印日志：当前注册在epoll中的channel总数量 (每轮循环都会执行 只在调试级别输出)
+    LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
     
 
     // 调用 epoll_wait 
@@ -61,14 +61,14 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
     // 保存errno，防止被后续函数覆盖
     int saveErrno = errno; 
     
-    // 获取当前时间戳 标记本次 poll 的返回时间
+    // 获取当前时间戳 标记本次 poll 的返回时间 (微秒精度，EventLoop缓存为本轮的当前时间)
     Timestamp now(Timestamp::now()); 
 
     
     // 处理事件
     if (numEvents > 0) // 有事件发生
     {
-        LOG_INFO("%d events happend\n", numEvents);     // 打印日志
+        LOG_DEBUG("%d events happend\n", numEvents);     // 打印日志
         fillActiveChannels(numEvents, activeChannels);  // 填充活跃的channel到EventLoop
         if (numEvents == events_.size()) // 若事件数组已满，扩容到2倍
         {
@@ -104,7 +104,7 @@ void EPollPoller::updateChannel(Channel* channel)
     const int index = channel->index(); // 获取当前channel的状态 kNew(-1) kAdded(1) kDeleted(2)
 
     // 打印日志 “所属函数名  fd  监听的事件类型  当前index状态”
-    LOG_INFO("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_DEBUG("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
 
     // kNew未添加，kDeleted已删除状态  (新添加的Channel，或者是曾经被删除的Channel，需要重新ADD到epoll中)
     if (index == kNew || index == kDeleted) 
@@ -149,7 +149,7 @@ void EPollPoller::removeChannel(Channel* channel)
     int fd = channel->fd(); // 获取channel对应的fd
     channels_.erase(fd);    // 从 fd->Channel 映射表 <fd, Channel*> 中删除
 
-    LOG_INFO("func=%s => fd=%d\n", __FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd=%d\n", __FUNCTION__, fd);
 
     int index = channel->index(); // 获取当前 channel 的状态
     if (index == kAdded) // 若在 epoll 中注册过
@@ -8,6 +8,8 @@
 #include "Logger.h"
 #include "Channel.h"
 #include "Poller.h"
+#include "MemoryBudget.h"
+#include "TimerQueue.h"
 
 // 每个线程都有独立的 t_loopInThisThread 指针  保证每个线程只拥有一个 EventLoop
 __thread EventLoop* t_loopInThisThread = nullptr; 
@@ -35,6 +37,7 @@ EventLoop::EventLoop()
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())           // 记录当前线程ID（仅允许本线程使用）
     , poller_(Poller::newDefaultPoller(this))   // 创建poller对象
+    , timerQueue_(new TimerQueue(this))         // 创建定时器队列 timerfd注册到poller_
     , wakeupFd_(createEventfd())                // 创建eventfd，用于跨线程唤醒当前EventLoop
     , wakeupChannel_(new Channel(this, wakeupFd_)) // 创建Channel，监听wakeFd_的读事件
 {
@@ -91,6 +94,15 @@ void EventLoop::loop()
 
         // 执行延迟提交的任务回调（queueInLoop()添加到 EventLoop 的回调函数）
         doPendingFunctors(); 
+
+        // 执行本轮循环末尾的回调（如合并后的延迟flush）
+        doIterationEndFunctors();
+
+        // 本轮Buffer的容量变化合并到全局内存预算
+        // 紧张解除的回调会queueInLoop恢复本loop的连接/Acceptor，和回调中一样需要唤醒poll
+        callingPendingFunctors_ = true;
+        MemoryBudget::instance().reconcile();
+        callingPendingFunctors_ = false;
     }
  
     LOG_INFO("EventLoop %p stop looping.\n", this); // quit_ = true 循环结束，打印结束日志
@@ -147,6 +159,44 @@ void EventLoop::queueInLoop(Functor cb)
 }
 
 
+// 在本轮循环末尾执行cb
+void EventLoop::runAtIterationEnd(Functor cb)
+{
+    if (isInLoopThread())
+    {
+        iterationEndFunctors_.emplace_back(std::move(cb));
+    }
+    else // 其他线程调用：先投递到loop线程，再加入本轮末尾的回调
+    {
+        queueInLoop(std::bind(&EventLoop::runAtIterationEnd, this, std::move(cb)));
+    }
+}
+
+
+// 定时器
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+
 // 通过eventfd唤醒loop所在的线程  向wakeupFd_写一个数据 wakeupChannel就发生读事件 当前loop线程就会被唤醒
 void EventLoop::wakeup()
 {
@@ -210,4 +260,23 @@ void EventLoop::doPendingFunctors()
     }
 
     callingPendingFunctors_ = false; // 状态重置
-}
\ No newline at end of file
+}
+
+
+// 执行本轮循环末尾的回调
+void EventLoop::doIterationEndFunctors()
+{
+    // 这些回调中queueInLoop的任务(如writeComplete)只能在下一轮执行，和doPendingFunctors中一样需要唤醒poll
+    callingPendingFunctors_ = true;
+    // 回调中可能再次调用runAtIterationEnd，循环直到队列清空
+    while (!iterationEndFunctors_.empty())
+    {
+        std::vector<Functor> functors;
+        functors.swap(iterationEndFunctors_);
+        for (const Functor &functor : functors)
+        {
+            functor();
+        }
+    }
+    callingPendingFunctors_ = false;
+}
@@ -0,0 +1,222 @@
+#include <fcntl.h>      // open posix_fadvise
+#include <unistd.h>     // close pread
+#include <sys/stat.h>   // fstat stat
+#include <errno.h>
+
+#include "FileCache.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "StringPiece.h"
+
+
+FileCache::Entry::~Entry()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+
+FileCache::FileCache(EventLoop* loop, size_t maxEntries, size_t smallFileLimit)
+    : loop_(loop)
+    , maxEntries_(maxEntries > 0 ? maxEntries : 1)
+    , smallFileLimit_(smallFileLimit)
+    , revalidateInterval_(2) // 默认2秒重新stat一次
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+    , bytesServed_(0)
+{
+}
+
+FileCache::~FileCache()
+{
+    // 缓存项由shared_ptr管理 正在发送中的文件段仍持有引用，发完后才关闭fd
+}
+
+
+// 发送文件的[offset, offset+count)部分
+bool FileCache::send(const TcpConnectionPtr& conn, const std::string& path, off_t offset, size_t count)
+{
+    if (!loop_->isInLoopThread())
+    {
+        LOG_ERROR("FileCache::send must be called in its loop thread\n");
+        return false;
+    }
+
+    EntryPtr entry = lookup(path);
+    if (!entry)
+    {
+        return false;
+    }
+
+    // 修正发送范围
+    if (offset < 0 || static_cast<size_t>(offset) > entry->size)
+    {
+        offset = static_cast<off_t>(entry->size);
+    }
+    size_t available = entry->size - static_cast<size_t>(offset);
+    if (count > available)
+    {
+        count = available;
+    }
+    if (count == 0)
+    {
+        return true;
+    }
+    bytesServed_ += count;
+
+    if (entry->content) // 小文件：直接从内存发送
+    {
+        if (offset == 0 && count == entry->size)
+        {
+            conn->send(entry->content);
+        }
+        else
+        {
+            StringPiece piece(entry->content->data() + offset, count);
+            conn->sendv(&piece, 1);
+        }
+    }
+    else // 大文件：sendfile  先提示内核预读要发送的范围
+    {
+        ::posix_fadvise(entry->fd, offset, count, POSIX_FADV_WILLNEED);
+        // 回调持有entry 保证被淘汰后fd在发送完成(或放弃)前不会关闭
+        conn->sendFile(entry->fd, offset, count, [entry](const TcpConnectionPtr&, bool) { });
+    }
+    return true;
+}
+
+
+// 查询文件元数据
+bool FileCache::stat(const std::string& path, size_t* size, time_t* mtime)
+{
+    if (!loop_->isInLoopThread())
+    {
+        LOG_ERROR("FileCache::stat must be called in its loop thread\n");
+        return false;
+    }
+
+    EntryPtr entry = lookup(path);
+    if (!entry)
+    {
+        return false;
+    }
+    if (size) *size = entry->size;
+    if (mtime) *mtime = entry->mtime;
+    return true;
+}
+
+
+void FileCache::clear()
+{
+    lru_.clear();
+    index_.clear();
+}
+
+
+// 查找缓存项
+FileCache::EntryPtr FileCache::lookup(const std::string& path)
+{
+    auto it = index_.find(path);
+    if (it != index_.end())
+    {
+        EntryPtr entry = *it->second;
+        time_t now = ::time(nullptr);
+
+        // 超过重新验证间隔 => stat一次，检查文件是否被修改或删除
+        if (now - entry->checkedAt >= revalidateInterval_)
+        {
+            struct stat st;
+            if (::stat(path.c_str(), &st) < 0
+                || st.st_mtime != entry->mtime
+                || static_cast<size_t>(st.st_size) != entry->size)
+            {
+                lru_.erase(it->second);
+                index_.erase(it);
+                ++misses_;
+                return openEntry(path);
+            }
+            entry->checkedAt = now;
+        }
+
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second); // 移到表头
+        return entry;
+    }
+
+    ++misses_;
+    return openEntry(path);
+}
+
+
+// 打开文件并加入缓存
+FileCache::EntryPtr FileCache::openEntry(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return EntryPtr();
+    }
+
+    EntryPtr entry(new Entry);
+    entry->fd = fd; // 之后由Entry析构关闭 (小文件读入内存后立即关闭)
+    entry->path = path;
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) // 只缓存普通文件
+    {
+        return EntryPtr();
+    }
+    entry->size = static_cast<size_t>(st.st_size);
+    entry->mtime = st.st_mtime;
+    entry->checkedAt = ::time(nullptr);
+
+    if (entry->size <= smallFileLimit_)
+    {
+        // 小文件读进内存 之后的请求不再访问文件
+        std::string* content = new std::string(entry->size, '\0');
+        SharedPayload payload(content);
+        size_t nread = 0;
+        while (nread < entry->size)
+        {
+            ssize_t n = ::pread(fd, &(*content)[nread], entry->size - nread, nread);
+            if (n <= 0)
+            {
+                break;
+            }
+            nread += n;
+        }
+        if (nread == entry->size)
+        {
+            entry->content = payload;
+            ::close(fd); // 已经在内存中 不再占用fd (没读全时保留fd 走sendfile)
+            entry->fd = -1;
+        }
+    }
+    else
+    {
+        // 大文件顺序读 让内核加大预读窗口
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    lru_.push_front(entry);
+    index_[path] = lru_.begin();
+    if (index_.size() > maxEntries_)
+    {
+        evict();
+    }
+    return entry;
+}
+
+
+// 淘汰最久未使用的缓存项
+void FileCache::evict()
+{
+    const EntryPtr& victim = lru_.back();
+    index_.erase(victim->path);
+    lru_.pop_back();
+    ++evictions_;
+}
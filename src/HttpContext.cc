@@ -0,0 +1,384 @@
+#include <string.h>
+#include <strings.h>
+
+#include "HttpContext.h"
+#include "Buffer.h"
+
+namespace
+{
+const size_t kMaxChunkLine = 1024; // 分块长度行/trailer行的最大长度
+
+const char* findCRLF(const char* begin, size_t len)
+{
+    return static_cast<const char*>(::memmem(begin, len, "\r\n", 2));
+}
+
+bool equalsIgnoreCase(const char* data, size_t len, const char* literal)
+{
+    size_t n = ::strlen(literal);
+    return len == n && ::strncasecmp(data, literal, n) == 0;
+}
+
+HttpRequest::Method parseMethod(const char* begin, size_t len)
+{
+    switch (len)
+    {
+    case 3:
+        if (::memcmp(begin, "GET", 3) == 0) return HttpRequest::kGet;
+        if (::memcmp(begin, "PUT", 3) == 0) return HttpRequest::kPut;
+        break;
+    case 4:
+        if (::memcmp(begin, "POST", 4) == 0) return HttpRequest::kPost;
+        if (::memcmp(begin, "HEAD", 4) == 0) return HttpRequest::kHead;
+        break;
+    case 5:
+        if (::memcmp(begin, "PATCH", 5) == 0) return HttpRequest::kPatch;
+        break;
+    case 6:
+        if (::memcmp(begin, "DELETE", 6) == 0) return HttpRequest::kDelete;
+        break;
+    case 7:
+        if (::memcmp(begin, "OPTIONS", 7) == 0) return HttpRequest::kOptions;
+        break;
+    default:
+        break;
+    }
+    return HttpRequest::kInvalid;
+}
+
+bool isSpace(char c) { return c == ' ' || c == '\t'; }
+}
+
+
+HttpContext::HttpContext(size_t maxHeaderBytes, size_t maxBodyBytes)
+    : maxHeaderBytes_(maxHeaderBytes)
+    , maxBodyBytes_(maxBodyBytes)
+    , state_(kExpectHeaders)
+    , scanned_(0)
+    , headerBytes_(0)
+    , contentLength_(0)
+    , chunkPos_(0)
+    , chunkRemaining_(0)
+    , consumed_(0)
+    , expectContinue_(false)
+    , errorCode_(HttpResponse::kUnknown)
+    , method_(HttpRequest::kInvalid)
+    , version_(HttpRequest::kUnknown)
+    , path_{0, 0}
+    , query_{0, 0}
+    , responseCount_(0)
+{
+}
+
+
+HttpContext::ParseResult HttpContext::parse(Buffer* buf, Timestamp receiveTime)
+{
+    if (state_ == kExpectHeaders)
+    {
+        // 请求之间多余的空行直接丢弃 (有的客户端在POST body后多发一个CRLF)
+        while (scanned_ == 0 && buf->readableBytes() >= 2 && buf->peek()[0] == '\r' && buf->peek()[1] == '\n')
+        {
+            buf->retrieve(2);
+        }
+
+        const char* base = buf->peek();
+        size_t readable = buf->readableBytes();
+        size_t from = scanned_ > 3 ? scanned_ - 3 : 0; // 结束标记可能跨两次到达的数据
+        const char* end = static_cast<const char*>(::memmem(base + from, readable - from, "\r\n\r\n", 4));
+        if (end == nullptr)
+        {
+            scanned_ = readable;
+            return readable > maxHeaderBytes_ ? fail(HttpResponse::k431HeaderFieldsTooLarge) : kNeedMore;
+        }
+        headerBytes_ = end - base + 4;
+        if (headerBytes_ > maxHeaderBytes_)
+        {
+            return fail(HttpResponse::k431HeaderFieldsTooLarge);
+        }
+        request_.receiveTime_ = receiveTime;
+        if (parseHeaders(base, headerBytes_) == kError)
+        {
+            return kError;
+        }
+    }
+
+    const char* base = buf->peek();
+    size_t readable = buf->readableBytes();
+    if (state_ == kExpectBody)
+    {
+        if (readable < headerBytes_ + contentLength_)
+        {
+            return kNeedMore;
+        }
+        return complete(base, headerBytes_ + contentLength_);
+    }
+    return parseChunks(base, readable);
+}
+
+
+// 解析请求行和头部  成功时设置state_为等待body/分块，返回kNeedMore
+HttpContext::ParseResult HttpContext::parseHeaders(const char* base, size_t headerBytes)
+{
+    const char* end = base + headerBytes - 2; // 最后的空行
+
+    // 请求行: METHOD SP URI SP HTTP/1.x
+    const char* lineEnd = findCRLF(base, headerBytes);
+    const char* space = static_cast<const char*>(::memchr(base, ' ', lineEnd - base));
+    if (space == nullptr)
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    method_ = parseMethod(base, space - base);
+    if (method_ == HttpRequest::kInvalid)
+    {
+        return fail(HttpResponse::k501NotImplemented);
+    }
+    const char* uri = space + 1;
+    space = static_cast<const char*>(::memchr(uri, ' ', lineEnd - uri));
+    if (space == nullptr || space == uri)
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    const char* question = static_cast<const char*>(::memchr(uri, '?', space - uri));
+    const char* pathEnd = question ? question : space;
+    path_ = Range{ static_cast<uint32_t>(uri - base), static_cast<uint32_t>(pathEnd - uri) };
+    query_ = question ? Range{ static_cast<uint32_t>(question + 1 - base), static_cast<uint32_t>(space - question - 1) }
+                      : Range{ 0, 0 };
+    const char* version = space + 1;
+    if (lineEnd - version != 8 || ::memcmp(version, "HTTP/1.", 7) != 0 || (version[7] != '0' && version[7] != '1'))
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    version_ = version[7] == '1' ? HttpRequest::kHttp11 : HttpRequest::kHttp10;
+
+    // 头部: name ":" OWS value OWS  只记录偏移
+    headerRanges_.clear();
+    bool chunked = false;
+    bool hasLength = false;
+    size_t length = 0;
+    expectContinue_ = false;
+    for (const char* line = lineEnd + 2; line < end; line = lineEnd + 2)
+    {
+        lineEnd = findCRLF(line, end + 2 - line);
+        const char* colon = static_cast<const char*>(::memchr(line, ':', lineEnd - line));
+        // 不接受折行 (obs-fold) 和名字后的空白
+        if (colon == nullptr || colon == line || isSpace(line[0]) || isSpace(colon[-1]))
+        {
+            return fail(HttpResponse::k400BadRequest);
+        }
+        const char* value = colon + 1;
+        const char* valueEnd = lineEnd;
+        while (value < valueEnd && isSpace(*value)) ++value;
+        while (valueEnd > value && isSpace(valueEnd[-1])) --valueEnd;
+
+        HeaderRange h;
+        h.name = Range{ static_cast<uint32_t>(line - base), static_cast<uint32_t>(colon - line) };
+        h.value = Range{ static_cast<uint32_t>(value - base), static_cast<uint32_t>(valueEnd - value) };
+        headerRanges_.push_back(h);
+
+        size_t nameLen = colon - line;
+        size_t valueLen = valueEnd - value;
+        if (equalsIgnoreCase(line, nameLen, "Content-Length"))
+        {
+            if (hasLength || valueLen == 0 || valueLen > 18)
+            {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            length = 0;
+            for (const char* p = value; p < valueEnd; ++p)
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    return fail(HttpResponse::k400BadRequest);
+                }
+                length = length * 10 + (*p - '0');
+            }
+            hasLength = true;
+        }
+        else if (equalsIgnoreCase(line, nameLen, "Transfer-Encoding"))
+        {
+            if (!equalsIgnoreCase(value, valueLen, "chunked"))
+            {
+                return fail(HttpResponse::k501NotImplemented);
+            }
+            chunked = true;
+        }
+        else if (equalsIgnoreCase(line, nameLen, "Expect"))
+        {
+            expectContinue_ = equalsIgnoreCase(value, valueLen, "100-continue");
+        }
+    }
+
+    // 同时带Content-Length和chunked的请求可能被用来做请求走私 直接拒绝
+    if (chunked && (hasLength || version_ != HttpRequest::kHttp11))
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    if (length > maxBodyBytes_)
+    {
+        return fail(HttpResponse::k413PayloadTooLarge);
+    }
+
+    if (chunked)
+    {
+        state_ = kExpectChunkSize;
+        chunkPos_ = headerBytes;
+        chunkedBody_.clear();
+    }
+    else
+    {
+        state_ = kExpectBody;
+        contentLength_ = length;
+        expectContinue_ = expectContinue_ && length > 0;
+    }
+    expectContinue_ = expectContinue_ && version_ == HttpRequest::kHttp11;
+    return kNeedMore;
+}
+
+
+// 解码chunked body  从上次停下的位置继续，分块数据追加到chunkedBody_
+HttpContext::ParseResult HttpContext::parseChunks(const char* base, size_t readable)
+{
+    for (;;)
+    {
+        // 分块头/trailer本身也占缓冲区，限制原始数据总量 (防止大量极小分块)
+        if (chunkPos_ - headerBytes_ > 4 * maxBodyBytes_ + maxHeaderBytes_)
+        {
+            return fail(HttpResponse::k413PayloadTooLarge);
+        }
+        const char* p = base + chunkPos_;
+        size_t avail = readable - chunkPos_;
+        switch (state_)
+        {
+        case kExpectChunkSize:
+        {
+            const char* lineEnd = findCRLF(p, avail);
+            if (lineEnd == nullptr)
+            {
+                return avail > kMaxChunkLine ? fail(HttpResponse::k400BadRequest) : kNeedMore;
+            }
+            size_t size = 0;
+            const char* q = p;
+            for (; q < lineEnd; ++q)
+            {
+                int digit;
+                if (*q >= '0' && *q <= '9') digit = *q - '0';
+                else if (*q >= 'a' && *q <= 'f') digit = *q - 'a' + 10;
+                else if (*q >= 'A' && *q <= 'F') digit = *q - 'A' + 10;
+                else break;
+                size = size * 16 + digit;
+                if (size > maxBodyBytes_)
+                {
+                    return fail(HttpResponse::k413PayloadTooLarge);
+                }
+            }
+            // 至少一位十六进制数，后面只能是扩展 (";name=value") 或空白
+            if (q == p || (q < lineEnd && *q != ';' && !isSpace(*q)))
+            {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            if (chunkedBody_.size() + size > maxBodyBytes_)
+            {
+                return fail(HttpResponse::k413PayloadTooLarge);
+            }
+            chunkPos_ = lineEnd + 2 - base;
+            chunkRemaining_ = size;
+            state_ = size == 0 ? kExpectTrailer : kExpectChunkData;
+            break;
+        }
+        case kExpectChunkData:
+        {
+            size_t n = avail < chunkRemaining_ ? avail : chunkRemaining_;
+            chunkedBody_.append(p, n);
+            chunkPos_ += n;
+            chunkRemaining_ -= n;
+            if (chunkRemaining_ > 0 || avail - n < 2)
+            {
+                return kNeedMore;
+            }
+            if (p[n] != '\r' || p[n + 1] != '\n')
+            {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            chunkPos_ += 2;
+            state_ = kExpectChunkSize;
+            break;
+        }
+        case kExpectTrailer:
+        {
+            // trailer头部忽略 直到空行
+            const char* lineEnd = findCRLF(p, avail);
+            if (lineEnd == nullptr)
+            {
+                return avail > kMaxChunkLine ? fail(HttpResponse::k431HeaderFieldsTooLarge) : kNeedMore;
+            }
+            chunkPos_ = lineEnd + 2 - base;
+            if (lineEnd == p)
+            {
+                return complete(base, chunkPos_);
+            }
+            break;
+        }
+        default:
+            return fail(HttpResponse::k500InternalServerError);
+        }
+    }
+}
+
+
+HttpContext::ParseResult HttpContext::fail(HttpResponse::StatusCode code)
+{
+    errorCode_ = code;
+    return kError;
+}
+
+
+// 请求完整  把偏移换成指向当前缓冲区的切片
+HttpContext::ParseResult HttpContext::complete(const char* base, size_t consumed)
+{
+    request_.method_ = method_;
+    request_.version_ = version_;
+    request_.path_ = slice(base, path_);
+    request_.query_ = slice(base, query_);
+    request_.headers_.clear();
+    for (const HeaderRange& h : headerRanges_)
+    {
+        request_.headers_.push_back(HttpRequest::Header{ slice(base, h.name), slice(base, h.value) });
+    }
+    request_.chunked_ = state_ != kExpectBody;
+    request_.body_ = request_.chunked_ ? StringPiece(chunkedBody_) : StringPiece(base + headerBytes_, contentLength_);
+    consumed_ = consumed;
+    expectContinue_ = false;
+    return kGotRequest;
+}
+
+
+void HttpContext::finishRequest(Buffer* buf)
+{
+    buf->retrieve(consumed_);
+    consumed_ = 0;
+    state_ = kExpectHeaders;
+    scanned_ = 0;
+    headerBytes_ = 0;
+    contentLength_ = 0;
+}
+
+
+bool HttpContext::takeExpectContinue()
+{
+    bool expect = expectContinue_;
+    expectContinue_ = false;
+    return expect;
+}
+
+
+HttpResponse* HttpContext::nextResponse()
+{
+    if (responseCount_ == responses_.size())
+    {
+        responses_.emplace_back();
+    }
+    HttpResponse* response = &responses_[responseCount_++];
+    response->clear();
+    return response;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+
+#include "HttpResponse.h"
+
+namespace
+{
+const char* defaultMessage(int code)
+{
+    switch (code)
+    {
+    case 100: return "Continue";
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 426: return "Upgrade Required";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    default:  return "Unknown";
+    }
+}
+}
+
+
+void HttpResponse::addHeader(const StringPiece& key, const StringPiece& value)
+{
+    headers_.append(key.data(), key.size());
+    headers_.append(": ", 2);
+    headers_.append(value.data(), value.size());
+    headers_.append("\r\n", 2);
+}
+
+
+StringPiece HttpResponse::buildHead()
+{
+    int code = statusCode_ == kUnknown ? k500InternalServerError : statusCode_;
+    char line[64];
+    int n = snprintf(line, sizeof line, "HTTP/1.1 %d ", code);
+    head_.assign(line, n);
+    if (statusMessage_.empty())
+    {
+        head_.append(defaultMessage(code));
+    }
+    else
+    {
+        head_.append(statusMessage_);
+    }
+    head_.append("\r\n", 2);
+
+    if (code == k101SwitchingProtocols)
+    {
+        head_.append("Connection: Upgrade\r\n"); // 协议升级应答没有body  Upgrade头由调用方添加
+    }
+    else
+    {
+        // 总是带Content-Length 客户端据此划分流水线中的响应
+        n = snprintf(line, sizeof line, "Content-Length: %zu\r\n", body().size());
+        head_.append(line, n);
+        if (closeConnection_)
+        {
+            head_.append("Connection: close\r\n");
+        }
+        else
+        {
+            head_.append("Connection: keep-alive\r\n");
+        }
+    }
+    head_.append(headers_);
+    head_.append("\r\n", 2);
+    return StringPiece(head_);
+}
+
+
+void HttpResponse::clear()
+{
+    statusCode_ = kUnknown;
+    statusMessage_.clear();
+    closeConnection_ = false;
+    headOnly_ = false;
+    headers_.clear();
+    head_.clear();
+    body_.clear();
+    bodyPiece_.clear();
+}
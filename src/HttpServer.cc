@@ -0,0 +1,110 @@
+#include "HttpServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Logger.h"
+
+namespace
+{
+void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
+{
+    resp->setStatusCode(HttpResponse::k404NotFound);
+}
+
+const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+}
+
+
+HttpServer::HttpServer(EventLoop* loop,
+                       const InetAddress& listenAddr,
+                       const std::string& name,
+                       TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+    , maxHeaderBytes_(kDefaultMaxHeaderBytes)
+    , maxBodyBytes_(kDefaultMaxBodyBytes)
+{
+    server_.setConnectionCallback(std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&HttpServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+
+void HttpServer::onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(std::make_shared<HttpContext>(maxHeaderBytes_, maxBodyBytes_));
+    }
+}
+
+
+// 处理本次读到的所有完整请求 (流水线)，应答按顺序收集后一次sendv发出
+void HttpServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+    HttpContext* context = static_cast<HttpContext*>(conn->getContext().get());
+    if (context == nullptr)
+    {
+        buf->retrieveAll(); // 已经决定关闭的连接 忽略后续数据
+        return;
+    }
+
+    bool close = false;
+    bool sendContinue = false;
+    while (!close)
+    {
+        HttpContext::ParseResult result = context->parse(buf, receiveTime);
+        if (result == HttpContext::kNeedMore)
+        {
+            sendContinue = context->takeExpectContinue();
+            break;
+        }
+
+        HttpResponse* response = context->nextResponse();
+        if (result == HttpContext::kError)
+        {
+            LOG_INFO("HttpServer [%s] bad request, status %d\n", conn->name().c_str(), context->errorCode());
+            response->setStatusCode(context->errorCode());
+            response->setCloseConnection(true);
+            close = true;
+            break;
+        }
+
+        const HttpRequest& request = context->request();
+        response->setCloseConnection(!request.keepAlive());
+        response->setHeadOnly(request.method() == HttpRequest::kHead);
+        httpCallback_(request, response);
+        close = response->closeConnection();
+        context->finishRequest(buf); // 只移动读指针 本批请求的切片在返回前仍然有效
+    }
+
+    // 头部 + body 作为独立的切片 一次writev发出整批应答
+    std::vector<StringPiece>* pieces = context->pieces();
+    pieces->clear();
+    for (size_t i = 0; i < context->responseCount(); ++i)
+    {
+        HttpResponse* response = context->response(i);
+        pieces->push_back(response->buildHead());
+        if (!response->headOnly() && !response->body().empty())
+        {
+            pieces->push_back(response->body());
+        }
+    }
+    if (sendContinue)
+    {
+        pieces->push_back(StringPiece(kContinue, sizeof kContinue - 1));
+    }
+    if (!pieces->empty())
+    {
+        conn->sendv(*pieces);
+    }
+    context->clearResponses();
+
+    if (close)
+    {
+        buf->retrieveAll();
+        conn->setContext(nullptr); // 之后收到的数据直接丢弃
+        conn->shutdown();
+    }
+}
@@ -1,33 +1,149 @@
 #include <string.h>  // 包含 memset()、strlen()、strcpy() 等 C 风格字符串处理函数
+#include <stdio.h>
+#include <stddef.h>  // offsetof
+#include <sys/socket.h>
 
 #include "InetAddress.h"
+#include "Logger.h"
 
 
-// 构造  初始化 IPv4 地址对象
+// 构造  ip中含':'时为IPv6地址，否则为IPv4地址
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
-    ::memset(&addr_, 0, sizeof(addr_));     // 清零结构体addr_ , 所有字段都设为0
-    
+    ::memset(&addrUn_, 0, sizeof(addrUn_));     // 清零整个union , 所有字段都设为0
+
+    if (ip.find(':') != std::string::npos)
+    {
+        addr6_.sin6_family = AF_INET6;
+        addr6_.sin6_port = ::htons(port);
+        if (::inet_pton(AF_INET6, ip.c_str(), &addr6_.sin6_addr) <= 0)
+        {
+            LOG_ERROR("InetAddress invalid IPv6 address %s\n", ip.c_str());
+        }
+        addrLen_ = sizeof addr6_;
+        return;
+    }
+
     // 设置 sockaddr_in 结构体
     addr_.sin_family = AF_INET;                      // 设置地址族为 IPv4
     addr_.sin_port = ::htons(port);                  // port : 本地主机字节序（小端） -> 网络字节序（大端）
     addr_.sin_addr.s_addr = ::inet_addr(ip.c_str()); // ip   : 点分十进制字符串 -> 网络二进制格式
+    addrLen_ = sizeof addr_;
+}
+
+
+InetAddress::InetAddress(const sockaddr* addr, socklen_t len)
+{
+    setSockAddr(addr, len);
+}
+
+
+// 任意地址族  超出union的部分截断
+void InetAddress::setSockAddr(const sockaddr* addr, socklen_t len)
+{
+    ::memset(&addrUn_, 0, sizeof(addrUn_));
+    if (len > sizeof(addrUn_))
+    {
+        len = sizeof(addrUn_);
+    }
+    ::memcpy(&addrUn_, addr, len);
+    addrLen_ = len;
+}
+
+
+// Unix域套接字地址
+InetAddress InetAddress::fromUnixPath(const std::string& path)
+{
+    sockaddr_un addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+
+    size_t len = path.size() < sizeof(addr.sun_path) - 1 ? path.size() : sizeof(addr.sun_path) - 1;
+    if (len < path.size())
+    {
+        LOG_ERROR("InetAddress unix path too long: %s\n", path.c_str());
+    }
+    ::memcpy(addr.sun_path, path.data(), len);
+
+    // 抽象命名空间: sun_path[0]为'\0'，名字不以'\0'结尾，长度必须精确
+    socklen_t addrlen;
+    if (len > 0 && path[0] == '@')
+    {
+        addr.sun_path[0] = '\0';
+        addrlen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    }
+    else
+    {
+        addrlen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len + 1);
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), addrlen);
+}
+
+
+// 获取sockfd绑定的本地地址
+InetAddress InetAddress::getLocalAddr(int sockfd)
+{
+    sockaddr_un addr; // 三种地址中最大的
+    ::memset(&addr, 0, sizeof addr);
+    socklen_t addrlen = sizeof addr;
+    if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&addr), &addrlen) < 0)
+    {
+        LOG_ERROR("sockets::getLocalAddr");
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), addrlen);
+}
+
+
+// 获取sockfd连接的对端地址
+InetAddress InetAddress::getPeerAddr(int sockfd)
+{
+    sockaddr_un addr;
+    ::memset(&addr, 0, sizeof addr);
+    socklen_t addrlen = sizeof addr;
+    if (::getpeername(sockfd, reinterpret_cast<sockaddr*>(&addr), &addrlen) < 0)
+    {
+        LOG_ERROR("sockets::getPeerAddr");
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), addrlen);
 }
 
 
 // 获取端口号port（主机字节序）
 uint16_t InetAddress::toPort() const
 {
-    return ::ntohs(addr_.sin_port); // port : 网络序 -> 主机序
+    // sin_port 和 sin6_port 位置相同
+    return family() == AF_UNIX ? 0 : ::ntohs(addr_.sin_port); // port : 网络序 -> 主机序
 }
 
 
 // 转换为 IP 地址字符串 （如 "192.168.1.1"）
 std::string InetAddress::toIp() const
 {
+    if (family() == AF_UNIX)
+    {
+        // 未绑定的客户端地址只有sun_family
+        size_t offset = offsetof(sockaddr_un, sun_path);
+        if (addrLen_ <= offset)
+        {
+            return std::string();
+        }
+        if (addrUn_.sun_path[0] == '\0') // 抽象命名空间
+        {
+            return "@" + std::string(addrUn_.sun_path + 1, addrLen_ - offset - 1);
+        }
+        return std::string(addrUn_.sun_path, ::strnlen(addrUn_.sun_path, addrLen_ - offset));
+    }
+
     // addr
     char buf[64] = {0}; // 缓冲区，用于存放IP字符串
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf); // ip : 网络二进制 -> 点分十进制字符串
+    if (family() == AF_INET6)
+    {
+        ::inet_ntop(AF_INET6, &addr6_.sin6_addr, buf, sizeof buf);
+    }
+    else
+    {
+        ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf); // ip : 网络二进制 -> 点分十进制字符串
+    }
     return buf; // 转换为std::string 返回
 }
 
@@ -35,14 +151,28 @@ std::string InetAddress::toIp() const
 // 转换为 "IP:Port" 组合字符串（如 "192.168.1.1:8080"）
 std::string InetAddress::toIpPort() const
 {
-    // ip:port
-    char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf); // ip : 网络二进制 -> 点分十进制字符串 
+    if (family() == AF_UNIX)
+    {
+        return "unix:" + toIp();
+    }
+
+    // ip:port   IPv6地址加方括号 [::1]:8080
+    char buf[80] = {0};
+    if (family() == AF_INET6)
+    {
+        buf[0] = '[';
+        ::inet_ntop(AF_INET6, &addr6_.sin6_addr, buf + 1, sizeof buf - 1);
+        ::strcat(buf, "]");
+    }
+    else
+    {
+        ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf); // ip : 网络二进制 -> 点分十进制字符串
+    }
     size_t end = ::strlen(buf); // 找到当前字符串结尾的位置
 
     uint16_t port = ::ntohs(addr_.sin_port);                // port : 网络序 -> 主机序
 
-    sprintf(buf+end, ":%u", port); // buf末尾拼接 ":端口号"
+    snprintf(buf+end, sizeof buf - end, ":%u", port); // buf末尾拼接 ":端口号"
     return buf;
 }
 
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+#include <endian.h>
+
+#include "LengthHeaderCodec.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+#include "Crc32c.h"
+#include "Logger.h"
+
+const size_t LengthHeaderCodec::kMaxReserveBytes; // std::min按引用取值 需要定义
+
+namespace
+{
+void defaultErrorCallback(const TcpConnectionPtr& conn, LengthHeaderCodec::Error error)
+{
+    LOG_ERROR("LengthHeaderCodec [%s] %s, closing\n", conn->name().c_str(),
+              error == LengthHeaderCodec::kFrameTooLarge ? "frame too large" : "checksum mismatch");
+}
+}
+
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback& cb, bool checksum, size_t maxFrameBytes)
+    : frameCallback_(cb)
+    , errorCallback_(defaultErrorCallback)
+    , checksum_(checksum)
+    , maxFrameBytes_(maxFrameBytes)
+{
+}
+
+
+// 循环取出缓冲区中所有完整的帧
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+    const size_t headerLen = this->headerLen();
+    while (buf->readableBytes() >= headerLen)
+    {
+        const int32_t len = buf->peekInt32();
+        if (len < 0 || static_cast<size_t>(len) > maxFrameBytes_)
+        {
+            errorCallback_(conn, kFrameTooLarge);
+            buf->retrieveAll();
+            conn->shutdown();
+            break;
+        }
+
+        const size_t frameLen = headerLen + len;
+        if (buf->readableBytes() < frameLen)
+        {
+            // 为剩余部分预留空间 避免接收过程中反复扩容搬移
+            // 只预留有限的大小：length来自对端，空连接发一个帧头就能让每个连接分配maxFrameBytes
+            buf->ensureWritableBytes(std::min(frameLen - buf->readableBytes(), kMaxReserveBytes));
+            break;
+        }
+
+        StringPiece frame(buf->peek() + headerLen, len);
+        if (checksum_)
+        {
+            uint32_t be32 = 0;
+            ::memcpy(&be32, buf->peek() + kLengthLen, sizeof be32);
+            if (be32toh(be32) != Crc32c::value(frame.data(), frame.size()))
+            {
+                errorCallback_(conn, kChecksumMismatch);
+                buf->retrieveAll();
+                conn->shutdown();
+                break;
+            }
+        }
+        frameCallback_(conn, frame, receiveTime);
+        buf->retrieve(frameLen);
+    }
+}
+
+
+void LengthHeaderCodec::fillHeader(char* header, const StringPiece* pieces, size_t count) const
+{
+    size_t len = 0;
+    uint32_t crc = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        len += pieces[i].size();
+        if (checksum_)
+        {
+            crc = Crc32c::extend(crc, pieces[i].data(), pieces[i].size());
+        }
+    }
+    uint32_t be32 = htobe32(static_cast<uint32_t>(len));
+    ::memcpy(header, &be32, sizeof be32);
+    if (checksum_)
+    {
+        be32 = htobe32(crc);
+        ::memcpy(header + kLengthLen, &be32, sizeof be32);
+    }
+}
+
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, const StringPiece& payload) const
+{
+    send(conn, &payload, 1);
+}
+
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, const StringPiece* pieces, size_t count) const
+{
+    assert(count <= kMaxPieces);
+    char header[kLengthLen + kChecksumLen];
+    fillHeader(header, pieces, count);
+    StringPiece vec[kMaxPieces + 1];
+    vec[0] = StringPiece(header, headerLen());
+    for (size_t i = 0; i < count; ++i)
+    {
+        vec[i + 1] = pieces[i];
+    }
+    conn->sendv(vec, count + 1);
+}
+
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, Buffer* message) const
+{
+    encode(message);
+    StringPiece frame(message->peek(), message->readableBytes());
+    conn->sendv(&frame, 1);
+    message->retrieveAll();
+}
+
+
+void LengthHeaderCodec::encode(Buffer* message) const
+{
+    char header[kLengthLen + kChecksumLen];
+    StringPiece payload(message->peek(), message->readableBytes());
+    fillHeader(header, &payload, 1);
+    message->prepend(header, headerLen());
+}
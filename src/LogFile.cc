@@ -0,0 +1,232 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>  // gethostname getpid fdatasync
+
+#include "LogFile.h"
+
+namespace
+{
+std::string getHostname()
+{
+    char buf[256];
+    if (::gethostname(buf, sizeof buf) == 0)
+    {
+        buf[sizeof(buf) - 1] = '\0';
+        return buf;
+    }
+    return "unknownhost";
+}
+
+// 主机名只取一次
+const std::string& hostname()
+{
+    static const std::string name = getHostname();
+    return name;
+}
+}
+
+
+LogFile::LogFile(const std::string& basename, off_t rollSize, bool threadSafe,
+                 int flushInterval, int fsyncInterval)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushInterval)
+    , fsyncInterval_(fsyncInterval)
+    , utcOffset_(0)
+    , mutex_(threadSafe ? new std::mutex : nullptr)
+    , count_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+    , lastFlush_(0)
+    , lastFsync_(0)
+    , dirty_(false)
+    , fp_(nullptr)
+    , writtenBytes_(0)
+    , rolledFiles_(0)
+    , buffer_(new char[kBufferSize])
+{
+    time_t now = ::time(nullptr);
+    struct tm tmTime;
+    ::localtime_r(&now, &tmTime);
+    utcOffset_ = tmTime.tm_gmtoff;
+
+    if (rollSize_ > 0)
+    {
+        rollFile();
+    }
+    else
+    {
+        openFile(basename_); // 不滚动 直接追加到basename
+        lastFlush_ = lastFsync_ = now;
+    }
+}
+
+LogFile::~LogFile()
+{
+    closeFile();
+}
+
+
+void LogFile::append(const char* logline, size_t len)
+{
+    if (mutex_)
+    {
+        std::unique_lock<std::mutex> lock(*mutex_);
+        appendUnlocked(logline, len);
+    }
+    else
+    {
+        appendUnlocked(logline, len);
+    }
+}
+
+
+void LogFile::flush()
+{
+    if (mutex_)
+    {
+        std::unique_lock<std::mutex> lock(*mutex_);
+        flushUnlocked(::time(nullptr));
+    }
+    else
+    {
+        flushUnlocked(::time(nullptr));
+    }
+}
+
+
+void LogFile::appendUnlocked(const char* logline, size_t len)
+{
+    size_t n = ::fwrite_unlocked(logline, 1, len, fp_); // 调用方已保证同一时刻只有一个线程写fp_
+    writtenBytes_ += static_cast<off_t>(n);
+    dirty_ = true;
+
+    if (rollSize_ <= 0)
+    {
+        if (++count_ >= kCheckTimeRoll)
+        {
+            count_ = 0;
+            time_t now = ::time(nullptr);
+            if (now - lastFlush_ >= flushInterval_)
+            {
+                flushUnlocked(now);
+            }
+        }
+        return;
+    }
+
+    if (writtenBytes_ >= rollSize_)
+    {
+        rollFile();
+    }
+    else if (++count_ >= kCheckTimeRoll)
+    {
+        count_ = 0;
+        time_t now = ::time(nullptr);
+        if (periodOf(now) != startOfPeriod_) // 跨天
+        {
+            rollFile();
+        }
+        else if (now - lastFlush_ >= flushInterval_)
+        {
+            flushUnlocked(now);
+        }
+    }
+}
+
+
+void LogFile::flushUnlocked(time_t now)
+{
+    ::fflush(fp_);
+    lastFlush_ = now;
+    if (fsyncInterval_ > 0 && dirty_ && now - lastFsync_ >= fsyncInterval_)
+    {
+        ::fdatasync(::fileno(fp_)); // 失败(如/dev/null不支持)时忽略 日志已进入page cache
+        lastFsync_ = now;
+        dirty_ = false;
+    }
+}
+
+
+bool LogFile::rollFile()
+{
+    if (rollSize_ <= 0)
+    {
+        return false;
+    }
+    if (::time(nullptr) <= lastRoll_ && fp_ != nullptr) // 同一秒内文件名相同 继续写当前文件
+    {
+        return false;
+    }
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+
+    closeFile();
+    openFile(filename);
+    lastRoll_ = now;
+    lastFlush_ = now;
+    lastFsync_ = now;
+    startOfPeriod_ = periodOf(now);
+    count_ = 0;
+    ++rolledFiles_;
+    return true;
+}
+
+
+void LogFile::openFile(const std::string& filename)
+{
+    fp_ = ::fopen(filename.c_str(), "ae"); // e: O_CLOEXEC
+    if (fp_ == nullptr)
+    {
+        // 不能用LOG_*：日志输出可能正是本对象
+        fprintf(stderr, "LogFile: open %s failed: %s, writing to stderr\n", filename.c_str(), strerror(errno));
+        fp_ = stderr;
+        return;
+    }
+    ::setvbuf(fp_, buffer_.get(), _IOFBF, kBufferSize);
+    writtenBytes_ = 0;
+    dirty_ = false;
+}
+
+
+// 关闭前把缓冲区和page cache中的内容都写到磁盘
+void LogFile::closeFile()
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    if (fp_ != stderr)
+    {
+        ::fflush(fp_);
+        if (dirty_)
+        {
+            ::fdatasync(::fileno(fp_));
+        }
+        ::fclose(fp_);
+    }
+    fp_ = nullptr;
+}
+
+
+// basename.YYYYmmdd-HHMMSS.hostname.pid.log
+std::string LogFile::getLogFileName(const std::string& basename, time_t* now)
+{
+    std::string filename;
+    filename.reserve(basename.size() + 64);
+    filename = basename;
+
+    char timebuf[32];
+    struct tm tmTime;
+    *now = ::time(nullptr);
+    ::localtime_r(now, &tmTime);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tmTime);
+    filename += timebuf;
+
+    filename += hostname();
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
@@ -1,9 +1,20 @@
-#include <iostream>
+#include <stdio.h>
+#include <stdlib.h> // getenv
+#include <string.h>
 
 #include "Logger.h"
 #include "Timestamp.h"
 
 
+// 运行期默认级别 INFO  设置环境变量MUDUO_LOG_DEBUG时打开调试日志
+static int initLogLevel()
+{
+    return ::getenv("MUDUO_LOG_DEBUG") ? DEBUG : INFO;
+}
+
+std::atomic_int Logger::s_logLevel(initLogLevel());
+
+
 // 获取日志唯一的实例对象 单例
 Logger& Logger::instance()
 {
@@ -11,19 +22,30 @@ Logger& Logger::instance()
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level)
+// 默认输出到stdout
+static void defaultOutput(const char* msg, size_t len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+    ::fflush(stdout);
+}
+
+Logger::Logger()
+    : output_(defaultOutput)
+    , flush_(defaultFlush)
 {
-    loglevel_ = level;
 }
 
 
 // 写日志 (将日志输出到控制台)
-// 格式：[级别信息] time : msg  例如 [INFO] 2025-04-01 12:34:56 : This is a log message.
-void Logger::log(std::string msg)
+// 格式：[级别信息] time : msg  例如 [INFO]20250401 12:34:56.123456 : This is a log message.
+void Logger::log(int level, const char* msg)
 {
-    std::string pre = ""; // 日志级别前缀
-    switch(loglevel_) // 根据日志级别确定前缀
+    const char* pre = ""; // 日志级别前缀
+    switch(level) // 根据日志级别确定前缀
     {
     case INFO:
         pre = "[INFO]";
@@ -41,7 +63,34 @@ void Logger::log(std::string msg)
         break;
     }
 
-    // 打印 前缀pre + 时间 + 日志msg
-    // 格式：[级别信息] time : msg  例如 [INFO] 2025-04-01 12:34:56 : This is a log message.
-    std::cout << pre + Timestamp::now().toString() << " : " << msg << std::endl; 
+    // 在栈上拼出完整的一行 前缀pre + 时间 + 日志msg，一次交给输出函数
+    // 格式：[级别信息] time : msg  例如 [INFO]20250401 12:34:56.123456 : This is a log message.
+    // 不再每行std::endl刷新，由输出端(stdout缓冲/AsyncLogging后端)决定何时写出
+    char line[1280];
+    size_t msgLen = ::strlen(msg);
+    if (msgLen > 0 && msg[msgLen - 1] == '\n') // 日志内容自带换行的不再重复添加
+    {
+        --msgLen;
+    }
+    // 时间直接格式化到line中 同一秒内复用本线程缓存的日期和时分秒 (见Timestamp::format)
+    char timebuf[32];
+    Timestamp::now().format(timebuf, sizeof timebuf);
+    int n = snprintf(line, sizeof line, "%s%s : %.*s\n",
+                     pre, timebuf, static_cast<int>(msgLen), msg);
+    if (n < 0)
+    {
+        return;
+    }
+    size_t len = static_cast<size_t>(n);
+    if (len >= sizeof line) // 被截断 保证以换行结尾
+    {
+        len = sizeof line - 1;
+        line[len - 1] = '\n';
+    }
+    output_(line, len);
+
+    if (level == FATAL) // 进程马上退出 先把缓冲中的日志写出去
+    {
+        flush_();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "MemoryBudget.h"
+#include "Logger.h"
+
+__thread int64_t MemoryBudget::t_localDelta = 0;
+
+
+// 获取唯一的实例对象 单例
+MemoryBudget& MemoryBudget::instance()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget()
+    : usage_(0)
+    , pressure_(false)
+    , limit_(0)                            // 默认不限制
+    , highMark_(0)
+    , lowMark_(0)
+    , heavyConnectionBytes_(1024 * 1024)   // 1MB
+{
+}
+
+
+// 设置预算
+void MemoryBudget::setLimit(size_t limit)
+{
+    limit_ = limit;
+    highMark_ = limit / 10 * 9;
+    lowMark_ = limit / 10 * 7;
+}
+
+
+// 合并本线程的计数
+void MemoryBudget::reconcile()
+{
+    int64_t delta = t_localDelta;
+    if (delta == 0)
+    {
+        return;
+    }
+    t_localDelta = 0;
+    int64_t usage = usage_.fetch_add(delta, std::memory_order_relaxed) + delta;
+
+    if (limit_ == 0)
+    {
+        return;
+    }
+
+    // 进入紧张状态  只有第一个发现的线程打印日志
+    if (usage >= static_cast<int64_t>(highMark_) && !pressure_.load(std::memory_order_relaxed))
+    {
+        bool expected = false;
+        if (pressure_.compare_exchange_strong(expected, true))
+        {
+            LOG_ERROR("MemoryBudget under pressure, usage:%ld limit:%lu\n", (long)usage, limit_);
+        }
+    }
+    // 解除紧张状态  先清标志再取回调，与runWhenRelieved配合保证不漏掉回调
+    else if (usage <= static_cast<int64_t>(lowMark_) && pressure_.load(std::memory_order_relaxed))
+    {
+        bool expected = true;
+        if (pressure_.compare_exchange_strong(expected, false))
+        {
+            LOG_INFO("MemoryBudget relieved, usage:%ld limit:%lu\n", (long)usage, limit_);
+
+            std::vector<Functor> callbacks;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                callbacks.swap(relievedCallbacks_);
+            }
+            for (const Functor& cb : callbacks)
+            {
+                cb();
+            }
+        }
+    }
+}
+
+
+// 连接是否应该暂停读
+bool MemoryBudget::shouldPauseRead(size_t connectionBytes, bool outputPending) const
+{
+    // 没有待发送数据的连接暂停读也不会释放任何内存 (所有连接都这样时用量再也降不下来)
+    if (!underPressure() || !outputPending)
+    {
+        return false;
+    }
+    // 超过硬上限 => 所有连接都停止读，只发不收
+    if (usage() >= limit_)
+    {
+        return true;
+    }
+    return connectionBytes >= heavyConnectionBytes_;
+}
+
+
+// 紧张解除时执行cb
+void MemoryBudget::runWhenRelieved(Functor cb)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (pressure_.load())
+        {
+            relievedCallbacks_.push_back(std::move(cb));
+            return;
+        }
+    }
+    cb(); // 已经解除
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <string.h>
+
+#include "PubSubServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+
+PubSubServer::PubSubServer(EventLoop* loop,
+                           const InetAddress& listenAddr,
+                           const std::string& name,
+                           TcpServer::Option option)
+    : maxLagBytes_(4 * 1024 * 1024)
+    , published_(0)
+    , dropped_(0)
+    , server_(loop, listenAddr, name, option)
+{
+    server_.setThreadInitCallback(std::bind(&PubSubServer::onThreadInit, this, std::placeholders::_1));
+    server_.setConnectionCallback(std::bind(&PubSubServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&PubSubServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+PubSubServer::~PubSubServer()
+{
+}
+
+
+void PubSubServer::start()
+{
+    server_.start(); // 返回前每个IO线程都已经创建了自己的Shard
+}
+
+
+// 每个IO线程启动时调用一次 (没有子线程时在主loop上调用)
+void PubSubServer::onThreadInit(EventLoop* loop)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    shards_.push_back(std::unique_ptr<Shard>(new Shard(loop)));
+}
+
+
+int64_t PubSubServer::deliveredMessages() const
+{
+    int64_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        total += shard->delivered.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+
+void PubSubServer::onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        std::shared_ptr<Session> session = std::make_shared<Session>();
+        session->shard = nullptr;
+        for (const auto& shard : shards_)
+        {
+            if (shard->loop == conn->getLoop())
+            {
+                session->shard = shard.get();
+            }
+        }
+        conn->setContext(session);
+        conn->setDeferredFlush(true); // 一轮循环中投递给该连接的消息合并发送
+        conn->setTcpNoDelay(true);    // 已经自己合并，不再等Nagle
+    }
+    else
+    {
+        // 对端关闭或者因积压过多被断开  从本线程的订阅表中移除
+        Session* session = static_cast<Session*>(conn->getContext().get());
+        if (session)
+        {
+            std::vector<std::string> topics;
+            topics.swap(session->topics);
+            for (const std::string& topic : topics)
+            {
+                unsubscribe(conn, session, topic);
+            }
+        }
+        conn->setContext(nullptr);
+    }
+}
+
+
+void PubSubServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    Session* session = static_cast<Session*>(conn->getContext().get());
+    std::shared_ptr<MessageBatch> batch; // 本次读到的所有pub 最后一起扇出
+    while (session && conn->connected())
+    {
+        const char* begin = buf->peek();
+        size_t readable = buf->readableBytes();
+        const char* crlf = static_cast<const char*>(::memmem(begin, readable, "\r\n", 2));
+        if (crlf == nullptr)
+        {
+            if (readable > kMaxLineBytes)
+            {
+                LOG_ERROR("PubSubServer [%s] line too long, closing\n", conn->name().c_str());
+                conn->shutdown();
+            }
+            break;
+        }
+
+        const char* space = static_cast<const char*>(::memchr(begin, ' ', crlf - begin));
+        StringPiece command(begin, (space ? space : crlf) - begin);
+        StringPiece topic;
+        if (space)
+        {
+            topic = StringPiece(space + 1, crlf - space - 1);
+        }
+        if (topic.empty())
+        {
+            LOG_ERROR("PubSubServer [%s] bad command, closing\n", conn->name().c_str());
+            conn->shutdown();
+            break;
+        }
+
+        if (command == "pub")
+        {
+            // 内容是下一行  命令原样就是要发给订阅者的字节，只编码(拷贝)这一次
+            size_t lineLen = crlf + 2 - begin;
+            const char* end = static_cast<const char*>(::memmem(crlf + 2, readable - lineLen, "\r\n", 2));
+            if (end == nullptr)
+            {
+                if (readable > kMaxLineBytes)
+                {
+                    LOG_ERROR("PubSubServer [%s] message too long, closing\n", conn->name().c_str());
+                    conn->shutdown();
+                }
+                break;
+            }
+            size_t total = end + 2 - begin;
+            std::shared_ptr<Message> message = std::make_shared<Message>();
+            message->topic = topic.as_string();
+            message->wire.assign(begin, total);
+            buf->retrieve(total);
+            if (!batch)
+            {
+                batch = std::make_shared<MessageBatch>();
+            }
+            batch->push_back(std::move(message));
+        }
+        else if (command == "sub")
+        {
+            std::string name = topic.as_string();
+            buf->retrieve(crlf + 2 - begin);
+            subscribe(conn, session, name);
+        }
+        else if (command == "unsub")
+        {
+            std::string name = topic.as_string();
+            buf->retrieve(crlf + 2 - begin);
+            auto it = std::find(session->topics.begin(), session->topics.end(), name);
+            if (it != session->topics.end())
+            {
+                session->topics.erase(it);
+                unsubscribe(conn, session, name);
+            }
+        }
+        else
+        {
+            LOG_ERROR("PubSubServer [%s] unknown command, closing\n", conn->name().c_str());
+            conn->shutdown();
+            break;
+        }
+    }
+    if (batch)
+    {
+        publishBatch(batch);
+    }
+}
+
+
+void PubSubServer::subscribe(const TcpConnectionPtr& conn, Session* session, const std::string& topic)
+{
+    if (std::find(session->topics.begin(), session->topics.end(), topic) != session->topics.end())
+    {
+        return; // 已经订阅
+    }
+    session->topics.push_back(topic);
+    session->shard->topics[topic].push_back(conn);
+    session->shard->subscriptions.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void PubSubServer::unsubscribe(const TcpConnectionPtr& conn, Session* session, const std::string& topic)
+{
+    Shard* shard = session->shard;
+    auto it = shard->topics.find(topic);
+    if (it == shard->topics.end())
+    {
+        return;
+    }
+    std::vector<TcpConnectionPtr>& subscribers = it->second;
+    auto pos = std::find(subscribers.begin(), subscribers.end(), conn);
+    if (pos != subscribers.end())
+    {
+        *pos = subscribers.back(); // 订阅者之间没有顺序要求
+        subscribers.pop_back();
+        shard->subscriptions.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (subscribers.empty())
+    {
+        shard->topics.erase(it);
+    }
+}
+
+
+void PubSubServer::publish(const std::string& topic, const StringPiece& content)
+{
+    std::shared_ptr<Message> message = std::make_shared<Message>();
+    message->topic = topic;
+    message->wire.reserve(topic.size() + content.size() + 8);
+    message->wire.append("pub ", 4);
+    message->wire.append(topic);
+    message->wire.append("\r\n", 2);
+    message->wire.append(content.data(), content.size());
+    message->wire.append("\r\n", 2);
+    publishBatch(std::make_shared<MessageBatch>(1, message));
+}
+
+
+// 扇出  每个有订阅者的IO线程投递一次，当前线程的直接执行
+void PubSubServer::publishBatch(const MessageBatchPtr& batch)
+{
+    published_.fetch_add(static_cast<int64_t>(batch->size()), std::memory_order_relaxed);
+    for (const auto& shard : shards_)
+    {
+        if (shard->subscriptions.load(std::memory_order_relaxed) > 0)
+        {
+            shard->loop->runInLoop(std::bind(&PubSubServer::distribute, this, shard.get(), batch));
+        }
+    }
+}
+
+
+void PubSubServer::distribute(Shard* shard, const MessageBatchPtr& batch)
+{
+    int64_t delivered = 0;
+    for (const MessagePtr& message : *batch)
+    {
+        auto it = shard->topics.find(message->topic);
+        if (it == shard->topics.end())
+        {
+            continue;
+        }
+
+        // 与message共享引用计数的payload  所有订阅者的输出队列引用同一块内存
+        SharedPayload payload(message, &message->wire);
+        size_t size = payload->size();
+        for (const TcpConnectionPtr& conn : it->second)
+        {
+            if (!conn->connected())
+            {
+                continue; // 已经被断开，等待关闭回调移除
+            }
+            if (conn->bufferedOutputBytes() + size > maxLagBytes_)
+            {
+                // forceClose在下一轮执行关闭回调，不会在遍历中修改订阅表
+                LOG_INFO("PubSubServer [%s] subscriber lagging %lu bytes, dropped\n",
+                         conn->name().c_str(), conn->bufferedOutputBytes());
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                conn->forceClose();
+                continue;
+            }
+            conn->send(payload);
+            ++delivered;
+        }
+    }
+    shard->delivered.fetch_add(delivered, std::memory_order_relaxed);
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <functional>
+
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+
+RpcClient::RpcClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name, bool checksum)
+    : loop_(loop)
+    , client_(loop, serverAddr, name)
+    , codec_(std::bind(&RpcClient::onFrame, this, std::placeholders::_1,
+                       std::placeholders::_2, std::placeholders::_3), checksum, RpcMessage::kMaxMessageBytes)
+    , nextId_(1)
+{
+    client_.setConnectionCallback(std::bind(&RpcClient::onConnection, this, std::placeholders::_1));
+    client_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+RpcClient::~RpcClient()
+{
+    if (timer_.valid())
+    {
+        loop_->cancel(timer_);
+    }
+}
+
+
+void RpcClient::call(const StringPiece& method, const StringPiece& request, const RpcCallback& done, double timeout)
+{
+    if (loop_->isInLoopThread())
+    {
+        if (!connected())
+        {
+            done(kRpcConnectionClosed, StringPiece());
+            return;
+        }
+        int64_t id = nextId_++;
+        Call& c = pending_[id];
+        c.done = done;
+        if (timeout > 0)
+        {
+            c.deadline = addTime(Timestamp::now(), timeout);
+            addDeadline(c.deadline, id);
+        }
+
+        char header[RpcMessage::kRequestHeaderLen];
+        int32_t timeoutMs = timeout > 0 ? std::max(1, static_cast<int32_t>(timeout * 1000 + 0.5)) : 0;
+        RpcMessage::encodeRequestHeader(header, id, timeoutMs, method.size());
+        StringPiece pieces[3] = { StringPiece(header, sizeof header), method, request };
+        codec_.send(connection_, pieces, 3);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&RpcClient::callInLoop, this, method.as_string(), request.as_string(), done, timeout));
+    }
+}
+
+
+void RpcClient::callInLoop(const std::string& method, const std::string& request, const RpcCallback& done, double timeout)
+{
+    call(method, request, done, timeout);
+}
+
+
+void RpcClient::onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setDeferredFlush(true); // 同一轮循环发出的请求合并成一次写
+        connection_ = conn;
+    }
+    else
+    {
+        connection_.reset();
+        failAll(kRpcConnectionClosed);
+    }
+    if (connectionCallback_)
+    {
+        connectionCallback_(conn->connected());
+    }
+}
+
+
+void RpcClient::onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp)
+{
+    RpcMessage::Response response;
+    if (!RpcMessage::parseResponse(frame, &response))
+    {
+        LOG_ERROR("RpcClient [%s] bad response frame, closing\n", conn->name().c_str());
+        conn->shutdown();
+        return;
+    }
+    auto it = pending_.find(response.id);
+    if (it == pending_.end())
+    {
+        return; // 已经超时的调用
+    }
+    RpcCallback done;
+    done.swap(it->second.done);
+    pending_.erase(it); // 堆中的截止时间留到出堆时跳过
+    done(response.status, response.payload);
+}
+
+
+void RpcClient::addDeadline(Timestamp deadline, int64_t id)
+{
+    // 已完成调用留下的过期条目太多时按在途调用重建堆
+    if (deadlines_.size() > 2 * pending_.size() + 1024)
+    {
+        deadlines_.clear();
+        for (const auto& p : pending_)
+        {
+            if (p.second.deadline.valid())
+            {
+                deadlines_.push_back(Deadline(p.second.deadline, p.first));
+            }
+        }
+        std::make_heap(deadlines_.begin(), deadlines_.end(), std::greater<Deadline>());
+    }
+    else
+    {
+        deadlines_.push_back(Deadline(deadline, id));
+        std::push_heap(deadlines_.begin(), deadlines_.end(), std::greater<Deadline>());
+    }
+    if (!timerAt_.valid() || deadline < timerAt_)
+    {
+        armTimer(deadline);
+    }
+}
+
+
+void RpcClient::armTimer(Timestamp when)
+{
+    if (timer_.valid())
+    {
+        loop_->cancel(timer_);
+    }
+    timer_ = loop_->runAt(when, std::bind(&RpcClient::onTimer, this));
+    timerAt_ = when;
+}
+
+
+// 最早的截止时间到了  让所有到期且还在途的调用失败，再对准新的堆顶
+void RpcClient::onTimer()
+{
+    timer_ = TimerId();
+    timerAt_ = Timestamp::invalid();
+    Timestamp now = Timestamp::now();
+    while (!deadlines_.empty() && !(now < deadlines_.front().first))
+    {
+        int64_t id = deadlines_.front().second;
+        std::pop_heap(deadlines_.begin(), deadlines_.end(), std::greater<Deadline>());
+        deadlines_.pop_back();
+
+        auto it = pending_.find(id);
+        if (it == pending_.end())
+        {
+            continue; // 已经完成
+        }
+        RpcCallback done;
+        done.swap(it->second.done);
+        pending_.erase(it);
+        done(kRpcDeadlineExceeded, StringPiece()); // 回调中可能发起新调用 (会修改堆)
+    }
+    if (!deadlines_.empty() && !timerAt_.valid())
+    {
+        armTimer(deadlines_.front().first);
+    }
+}
+
+
+void RpcClient::failAll(RpcStatus status)
+{
+    std::unordered_map<int64_t, Call> pending;
+    pending.swap(pending_); // 回调中可能再次发起调用
+    deadlines_.clear();
+    if (timer_.valid())
+    {
+        loop_->cancel(timer_);
+        timer_ = TimerId();
+        timerAt_ = Timestamp::invalid();
+    }
+    for (auto& p : pending)
+    {
+        p.second.done(status, StringPiece());
+    }
+}
@@ -0,0 +1,124 @@
+#include "RpcServer.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+
+RpcServer::RpcServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     const std::string& name,
+                     bool checksum,
+                     TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , codec_(std::bind(&RpcServer::onFrame, this, std::placeholders::_1,
+                       std::placeholders::_2, std::placeholders::_3), checksum, RpcMessage::kMaxMessageBytes)
+    , computeThreads_(1)
+    , nextCompute_(0)
+{
+    server_.setConnectionCallback(std::bind(&RpcServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+RpcServer::~RpcServer()
+{
+}
+
+
+void RpcServer::registerMethod(const std::string& method, const RpcHandler& handler, Dispatch dispatch)
+{
+    methods_[method] = Method{ handler, dispatch };
+}
+
+
+void RpcServer::start()
+{
+    bool needPool = false;
+    for (const auto& m : methods_)
+    {
+        needPool = needPool || m.second.dispatch == kInPool;
+    }
+    if (needPool && !computePool_)
+    {
+        computePool_.reset(new EventLoopThreadPool(loop_, "RpcCompute"));
+        computePool_->setThreadNum(computeThreads_ > 0 ? computeThreads_ : 1);
+        computePool_->start();
+        computeLoops_ = computePool_->getAllLoops();
+    }
+    server_.start();
+}
+
+
+void RpcServer::onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setDeferredFlush(true); // 同一轮循环的应答合并发送
+    }
+}
+
+
+void RpcServer::onFrame(const TcpConnectionPtr& conn, const StringPiece& frame, Timestamp receiveTime)
+{
+    RpcMessage::Request request;
+    if (!RpcMessage::parseRequest(frame, &request))
+    {
+        LOG_ERROR("RpcServer [%s] bad request frame, closing\n", conn->name().c_str());
+        conn->shutdown();
+        return;
+    }
+
+    auto it = methods_.find(std::string(request.method.data(), request.method.size()));
+    if (it == methods_.end())
+    {
+        sendResponse(conn, request.id, kRpcNoSuchMethod, request.method);
+        return;
+    }
+
+    const Method& method = it->second;
+    if (method.dispatch == kInLoop)
+    {
+        std::string response;
+        RpcStatus status = method.handler(request.payload, &response);
+        sendResponse(conn, request.id, status, response);
+    }
+    else
+    {
+        Timestamp deadline = request.timeoutMs > 0
+            ? addTime(receiveTime, request.timeoutMs / 1000.0)
+            : Timestamp();
+        EventLoop* worker = computeLoops_[nextCompute_++ % computeLoops_.size()];
+        // 请求数据只在本回调期间有效 投递到计算线程前拷贝一份
+        worker->queueInLoop(std::bind(&RpcServer::runInPool, this, conn, &method, request.id,
+                                      request.payload.as_string(), deadline));
+    }
+}
+
+
+// 在计算线程中执行  结果转回连接所在的IO线程发送
+void RpcServer::runInPool(const TcpConnectionPtr& conn, const Method* method, int64_t id,
+                          const std::string& request, Timestamp deadline)
+{
+    std::shared_ptr<std::string> response = std::make_shared<std::string>();
+    RpcStatus status;
+    if (deadline.valid() && deadline < Timestamp::now())
+    {
+        status = kRpcDeadlineExceeded; // 排队期间已经超时 不再执行
+    }
+    else
+    {
+        status = method->handler(StringPiece(request), response.get());
+    }
+    conn->getLoop()->queueInLoop([this, conn, id, status, response]() {
+        sendResponse(conn, id, status, *response);
+    });
+}
+
+
+void RpcServer::sendResponse(const TcpConnectionPtr& conn, int64_t id, RpcStatus status, const StringPiece& payload)
+{
+    char header[RpcMessage::kResponseHeaderLen];
+    RpcMessage::encodeResponseHeader(header, id, status);
+    StringPiece pieces[2] = { StringPiece(header, sizeof header), payload };
+    codec_.send(conn, pieces, 2);
+}
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <endian.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SegmentLog.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include "Crc32c.h"
+#include "Logger.h"
+
+namespace
+{
+
+uint32_t readBe32(const char* p)
+{
+    uint32_t be32 = 0;
+    ::memcpy(&be32, p, sizeof be32);
+    return be32toh(be32);
+}
+
+void writeBe32(char* p, uint32_t x)
+{
+    uint32_t be32 = htobe32(x);
+    ::memcpy(p, &be32, sizeof be32);
+}
+
+size_t pageSize()
+{
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace
+
+
+SegmentLog::Segment::~Segment()
+{
+    if (data)
+    {
+        ::munmap(data, capacity);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+
+SegmentLog::SegmentLog(EventLoop* loop, const std::string& dir, size_t segmentBytes, size_t indexIntervalBytes)
+    : loop_(loop)
+    , dir_(dir)
+    , segmentBytes_(segmentBytes)
+    , indexInterval_(indexIntervalBytes)
+    , syncInterval_(0)
+    , maxSegments_(0)
+    , nextSeq_(0)
+    , syncedSeq_(0)
+    , dirtyBegin_(0)
+    , syncPending_(false)
+    , alive_(std::make_shared<bool>(true))
+{
+}
+
+SegmentLog::~SegmentLog()
+{
+    alive_.reset(); // 之后执行的提交任务不再访问this
+    if (syncTimer_.valid())
+    {
+        loop_->cancel(syncTimer_);
+    }
+    if (!segments_.empty())
+    {
+        Segment* seg = segments_.back().get();
+        syncSegment(seg, dirtyBegin_, seg->size);
+    }
+}
+
+
+bool SegmentLog::open()
+{
+    if (::mkdir(dir_.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        LOG_ERROR("SegmentLog::open mkdir %s errno=%d\n", dir_.c_str(), errno);
+        return false;
+    }
+
+    DIR* d = ::opendir(dir_.c_str());
+    if (d == nullptr)
+    {
+        LOG_ERROR("SegmentLog::open opendir %s errno=%d\n", dir_.c_str(), errno);
+        return false;
+    }
+    std::vector<int64_t> bases;
+    while (struct dirent* entry = ::readdir(d))
+    {
+        // <20位十进制序号>.seg
+        const char* name = entry->d_name;
+        if (::strlen(name) == 24 && ::strcmp(name + 20, ".seg") == 0)
+        {
+            bases.push_back(::strtoll(name, nullptr, 10));
+        }
+    }
+    ::closedir(d);
+    std::sort(bases.begin(), bases.end());
+
+    segments_.clear();
+    for (int64_t base : bases)
+    {
+        char name[32];
+        snprintf(name, sizeof name, "/%020lld.seg", static_cast<long long>(base));
+        SegmentPtr seg = openSegment(dir_ + name, base, false);
+        if (!seg || !recover(seg.get()))
+        {
+            segments_.clear();
+            return false;
+        }
+        if (!segments_.empty())
+        {
+            const Segment* prev = segments_.back().get();
+            if (prev->baseSeq + prev->count != base)
+            {
+                LOG_ERROR("SegmentLog::open %s: records %lld..%lld missing\n", dir_.c_str(),
+                          static_cast<long long>(prev->baseSeq + prev->count), static_cast<long long>(base - 1));
+            }
+        }
+        segments_.push_back(seg);
+    }
+
+    if (segments_.empty())
+    {
+        nextSeq_ = 0;
+        dirtyBegin_ = 0;
+    }
+    else
+    {
+        const Segment* last = segments_.back().get();
+        nextSeq_ = last->baseSeq + last->count;
+        dirtyBegin_ = last->size;
+    }
+    syncedSeq_ = nextSeq_;
+    retire();
+    LOG_INFO("SegmentLog::open %s: %lu segments, records [%lld, %lld)\n", dir_.c_str(), segments_.size(),
+             static_cast<long long>(firstSeq()), static_cast<long long>(nextSeq_));
+    return true;
+}
+
+
+SegmentLog::SegmentPtr SegmentLog::openSegment(const std::string& path, int64_t baseSeq, bool create)
+{
+    SegmentPtr seg(new Segment);
+    seg->baseSeq = baseSeq;
+    seg->path = path;
+    seg->fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (seg->fd < 0)
+    {
+        LOG_ERROR("SegmentLog::openSegment open %s errno=%d\n", path.c_str(), errno);
+        return SegmentPtr();
+    }
+
+    if (create)
+    {
+        // 预先分配磁盘块  稀疏文件在磁盘满时写mmap会收到SIGBUS
+        int err = ::posix_fallocate(seg->fd, 0, static_cast<off_t>(segmentBytes_));
+        if (err != 0)
+        {
+            LOG_ERROR("SegmentLog::openSegment fallocate %s error=%d\n", path.c_str(), err);
+            ::unlink(path.c_str());
+            return SegmentPtr();
+        }
+        seg->capacity = segmentBytes_;
+    }
+    else
+    {
+        struct stat st;
+        if (::fstat(seg->fd, &st) < 0 || static_cast<size_t>(st.st_size) < kHeaderLen)
+        {
+            LOG_ERROR("SegmentLog::openSegment %s is not a segment\n", path.c_str());
+            return SegmentPtr();
+        }
+        seg->capacity = static_cast<size_t>(st.st_size);
+    }
+
+    void* data = ::mmap(nullptr, seg->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("SegmentLog::openSegment mmap %s errno=%d\n", path.c_str(), errno);
+        return SegmentPtr();
+    }
+    seg->data = static_cast<char*>(data);
+    return seg;
+}
+
+
+// 从头扫描一个已有的段  遇到length为0(数据结尾)或者不完整/校验失败的记录时停下，后面的内容清零
+bool SegmentLog::recover(Segment* seg)
+{
+    size_t pos = 0;
+    int64_t count = 0;
+    while (pos + kHeaderLen <= seg->capacity)
+    {
+        uint32_t len = readBe32(seg->data + pos);
+        if (len == 0)
+        {
+            break;
+        }
+        if (len > static_cast<uint32_t>(INT32_MAX) || pos + kHeaderLen + len > seg->capacity
+            || readBe32(seg->data + pos + 4) != Crc32c::value(seg->data + pos + kHeaderLen, len))
+        {
+            LOG_ERROR("SegmentLog::recover %s: bad record at offset %lu, truncated\n", seg->path.c_str(), pos);
+            ::memset(seg->data + pos, 0, seg->capacity - pos);
+            syncSegment(seg, pos, seg->capacity);
+            break;
+        }
+        addIndex(seg, seg->baseSeq + count, pos);
+        pos += kHeaderLen + len;
+        ++count;
+    }
+    seg->size = pos;
+    seg->count = count;
+    return true;
+}
+
+
+// 封存当前段(全部落盘)，以下一条记录的序号新建一个段
+bool SegmentLog::roll()
+{
+    if (!segments_.empty())
+    {
+        Segment* seg = segments_.back().get();
+        syncSegment(seg, dirtyBegin_, seg->size);
+    }
+
+    char name[32];
+    snprintf(name, sizeof name, "/%020lld.seg", static_cast<long long>(nextSeq_));
+    SegmentPtr seg = openSegment(dir_ + name, nextSeq_, true);
+    if (!seg)
+    {
+        return false;
+    }
+    segments_.push_back(seg);
+    dirtyBegin_ = 0;
+    retire();
+    return true;
+}
+
+
+void SegmentLog::addIndex(Segment* seg, int64_t seq, size_t pos)
+{
+    // 段的第一条记录总是有索引点，之后每隔indexInterval_字节一个
+    if (seg->index.empty() || pos - seg->index.back().pos >= indexInterval_)
+    {
+        seg->index.push_back(IndexEntry{ seq, pos });
+    }
+}
+
+
+int64_t SegmentLog::append(const StringPiece* pieces, size_t count)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        len += pieces[i].size();
+    }
+    if (len == 0 || len > static_cast<size_t>(INT32_MAX) || kHeaderLen + len > segmentBytes_)
+    {
+        LOG_ERROR("SegmentLog::append %s: bad record size %lu\n", dir_.c_str(), len);
+        return -1;
+    }
+
+    Segment* seg = segments_.empty() ? nullptr : segments_.back().get();
+    if (seg == nullptr || seg->size + kHeaderLen + len > seg->capacity)
+    {
+        if (!roll())
+        {
+            return -1;
+        }
+        seg = segments_.back().get();
+    }
+
+    // 先拷贝payload，在缓存还热的时候算校验和
+    char* frame = seg->data + seg->size;
+    char* p = frame + kHeaderLen;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ::memcpy(p, pieces[i].data(), pieces[i].size());
+        p += pieces[i].size();
+    }
+    writeBe32(frame + 4, Crc32c::value(frame + kHeaderLen, len));
+    writeBe32(frame, static_cast<uint32_t>(len));
+
+    int64_t seq = nextSeq_++;
+    addIndex(seg, seq, seg->size);
+    seg->size += kHeaderLen + len;
+    ++seg->count;
+    scheduleSync();
+    return seq;
+}
+
+
+// 组提交  同一轮循环(或同一个syncInterval)中的所有追加只msync一次
+void SegmentLog::scheduleSync()
+{
+    if (syncPending_)
+    {
+        return;
+    }
+    syncPending_ = true;
+    std::weak_ptr<bool> alive(alive_);
+    auto task = [this, alive]() {
+        if (alive.lock())
+        {
+            syncTimer_ = TimerId();
+            if (syncPending_)
+            {
+                sync();
+            }
+        }
+    };
+    if (syncInterval_ > 0)
+    {
+        syncTimer_ = loop_->runAfter(syncInterval_, task);
+    }
+    else
+    {
+        loop_->runAtIterationEnd(task);
+    }
+}
+
+
+void SegmentLog::sync()
+{
+    syncPending_ = false;
+    if (syncTimer_.valid())
+    {
+        loop_->cancel(syncTimer_);
+        syncTimer_ = TimerId();
+    }
+    if (!segments_.empty())
+    {
+        Segment* seg = segments_.back().get();
+        syncSegment(seg, dirtyBegin_, seg->size); // 之前的段在roll时已经落盘
+        dirtyBegin_ = seg->size;
+    }
+    if (syncedSeq_ != nextSeq_)
+    {
+        syncedSeq_ = nextSeq_;
+        if (syncCallback_)
+        {
+            syncCallback_(syncedSeq_);
+        }
+    }
+}
+
+
+void SegmentLog::syncSegment(Segment* seg, size_t begin, size_t end)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    size_t aligned = begin / pageSize() * pageSize(); // msync的起点必须按页对齐
+    if (::msync(seg->data + aligned, end - aligned, MS_SYNC) < 0)
+    {
+        LOG_ERROR("SegmentLog::sync %s errno=%d\n", seg->path.c_str(), errno);
+    }
+}
+
+
+void SegmentLog::retire()
+{
+    while (maxSegments_ > 0 && segments_.size() > maxSegments_)
+    {
+        // 正在重放的段由sendFile的回调持有，文件描述符在发完或放弃后才关闭
+        ::unlink(segments_.front()->path.c_str());
+        segments_.pop_front();
+    }
+}
+
+
+// seq在段内的文件偏移  从最近的索引点沿着帧头向后跳
+size_t SegmentLog::locate(const Segment* seg, int64_t seq) const
+{
+    auto it = std::upper_bound(seg->index.begin(), seg->index.end(), seq,
+                               [](int64_t s, const IndexEntry& e) { return s < e.seq; });
+    size_t pos = 0;
+    int64_t cur = seg->baseSeq;
+    if (it != seg->index.begin())
+    {
+        --it;
+        pos = it->pos;
+        cur = it->seq;
+    }
+    while (cur < seq && pos < seg->size)
+    {
+        pos += kHeaderLen + readBe32(seg->data + pos);
+        ++cur;
+    }
+    return pos;
+}
+
+
+int64_t SegmentLog::replay(const TcpConnectionPtr& conn, int64_t fromSeq, const FileCompleteCallback& done)
+{
+    int64_t start = std::max(fromSeq, firstSeq());
+    if (start >= nextSeq_)
+    {
+        return nextSeq_;
+    }
+
+    // 第一个包含start的段  之后的段整段发送
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), start,
+                               [](int64_t s, const SegmentPtr& seg) { return s < seg->baseSeq; });
+    if (it != segments_.begin())
+    {
+        --it;
+    }
+
+    struct Range
+    {
+        SegmentPtr seg;
+        size_t pos;
+    };
+    std::vector<Range> ranges;
+    for (bool first = true; it != segments_.end(); ++it, first = false)
+    {
+        size_t pos = first ? locate(it->get(), start) : 0;
+        if (pos < (*it)->size)
+        {
+            ranges.push_back(Range{ *it, pos });
+        }
+    }
+
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        const SegmentPtr& seg = ranges[i].seg;
+        FileCompleteCallback cb;
+        if (i + 1 == ranges.size())
+        {
+            cb = [seg, done](const TcpConnectionPtr& c, bool completed) { if (done) done(c, completed); };
+        }
+        else
+        {
+            cb = [seg](const TcpConnectionPtr&, bool) {}; // 持有段直到这一段发完或被放弃 (出错/连接关闭)
+        }
+        // 只发到当前写入的位置  之后追加的记录由调用方实时推送
+        conn->sendFile(seg->fd, static_cast<off_t>(ranges[i].pos), seg->size - ranges[i].pos, cb);
+    }
+    return start;
+}
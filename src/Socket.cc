@@ -3,6 +3,11 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <netinet/tcp.h>    // TCP_NODELAY选项
+#include <errno.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60          // 旧版本头文件中没有定义 (Linux 4.14+)
+#endif
 
 #include "Socket.h"
 #include "Logger.h"
@@ -20,7 +25,7 @@ Socket::~Socket()
 void Socket::bindAddress(const InetAddress &localaddr)
 {
     // 将 socket fd 绑定到一个本地地址localaddr，如果绑定失败，打印日志并终止程序
-    if (0 != ::bind(sockfd_, (sockaddr*)localaddr.getSockAddr(), sizeof(sockaddr_in)))
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockLen())) // 长度随地址族(IPv4/IPv6/Unix)不同
     {
         LOG_FATAL("bind sockfd:%d fail\n", sockfd_);
     }
@@ -45,7 +50,7 @@ int Socket::accept(InetAddress* peeraddr) // 参数peeraddr 用于存储客户
      * Reactor模型 one loop per thread
      * poller + non-blocking IO
      */
-    sockaddr_in addr;                   // 临时变量 addr，用于存储客户端地址
+    sockaddr_un addr;                   // 临时变量 addr，用于存储客户端地址 (sockaddr_un足以容纳IPv4/IPv6/Unix三种地址)
     socklen_t len = sizeof(addr);       // 地址长度，传入 accept4() 时需要指针
     ::memset(&addr, 0, sizeof(addr));   // 清空，避免未初始化字段导致意外
 
@@ -55,7 +60,7 @@ int Socket::accept(InetAddress* peeraddr) // 参数peeraddr 用于存储客户
     // 如果 connfd 有效（连接成功）
     if (connfd >= 0)
     {
-        peeraddr->setSockAddr(addr); // 保存客户端地址信息到调用者传入的 peeraddr 
+        peeraddr->setSockAddr((sockaddr*)&addr, len); // 保存客户端地址信息到调用者传入的 peeraddr 
     }
     
     return connfd;
@@ -109,4 +114,27 @@ void Socket::setKeepAlive (bool on)
     // TCP 本身对连接断开不敏感，如对方断电不会立即察觉。启用后，内核会周期性发送探测包检测连接存活性。
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-}
\ No newline at end of file
+}
+
+// TCP_CORK
+void Socket::setTcpCork (bool on)
+{
+    // 开启后内核不发送不满一个MSS的段，直到取消TCP_CORK (或超时200ms)
+    // 在连续的write/sendfile前后开启/取消，可以把多次小写合并成尽量满的TCP段
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_CORK, &optval, sizeof(optval));
+}
+
+// 启用 SO_ZEROCOPY
+bool Socket::setZeroCopy (bool on)
+{
+    // SO_ZEROCOPY 开启后，send(MSG_ZEROCOPY) 直接引用用户内存页而不拷贝到内核
+    // 发送完成后内核通过socket的错误队列 (MSG_ERRQUEUE) 通知，用户内存在收到通知前不能释放或修改
+    int optval = on ? 1 : 0;
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0)
+    {
+        LOG_ERROR("setsockopt SO_ZEROCOPY fail sockfd:%d errno:%d\n", sockfd_, errno);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+#include <string.h>
+#include <sys/socket.h>
+
+#include "TcpClient.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Buffer.h"
+
+namespace
+{
+// TcpClient析构后还存在的连接 关闭时直接在loop中销毁
+void removeConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+EventLoop* CheckLoopNotNull(EventLoop* loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d loop is null!\n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+}
+
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , connectionCallback_([](const TcpConnectionPtr&) { }) // 用户没有设置时什么也不做
+    , messageCallback_([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); })
+    , retry_(false)
+    , connect_(false)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_INFO("TcpClient::TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient()
+{
+    LOG_INFO("TcpClient::~TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+    if (conn)
+    {
+        // 连接比TcpClient活得久：关闭回调不能再访问this
+        CloseCallback cb = std::bind(&::removeConnection, loop_, std::placeholders::_1);
+        loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
+        if (unique) // 没有其他人持有连接 关闭它
+        {
+            conn->shutdown();
+        }
+    }
+    else
+    {
+        connector_->stop();
+    }
+}
+
+
+void TcpClient::setRetryDelay(int initMs, int maxMs)
+{
+    connector_->setRetryDelay(initMs, maxMs);
+}
+
+
+void TcpClient::connect()
+{
+    LOG_INFO("TcpClient::connect[%s] - connecting to %s\n",
+             name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (connection_)
+    {
+        connection_->shutdown();
+    }
+}
+
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+
+// 连接建立  和TcpServer::newConnection一样创建TcpConnection
+void TcpClient::newConnection(int sockfd)
+{
+    InetAddress peerAddr(InetAddress::getPeerAddr(sockfd));
+    InetAddress localAddr(InetAddress::getLocalAddr(sockfd));
+
+    char buf[64] = {0};
+    snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+    std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddr, peerAddr));
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    if (tlsContext_)
+    {
+        conn->startTls(tlsContext_, tlsHostname_);
+    }
+    conn->connectEstablished(); // 已经在loop线程中
+}
+
+
+// 连接关闭  retry时重新连接
+void TcpClient::removeConnection(const TcpConnectionPtr& conn)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_)
+    {
+        LOG_INFO("TcpClient::removeConnection[%s] - reconnecting to %s\n",
+                 name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
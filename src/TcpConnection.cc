@@ -1,5 +1,6 @@
 #include <functional>       // std::bind绑定回调函数
 #include <string>           
+#include <algorithm>        // std::min
 #include <errno.h>
 #include <sys/types.h>      // 系统类型 如ssize_t
 #include <sys/socket.h>
@@ -8,12 +9,18 @@
 #include <sys/sendfile.h>   // 提供sendfile()
 #include <fcntl.h>          // 提供open函数以及文件打开的flag
 #include <unistd.h>         // close read write函数
+#include <sys/uio.h>        // writev iovec
+#include <limits.h>         // IOV_MAX
+#include <linux/errqueue.h> // sock_extended_err 零拷贝完成通知
 
 #include "TcpConnection.h"
 #include "Logger.h"
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "TcpRelay.h"
+#include "MemoryBudget.h"
+#include "TlsSession.h"
 
 // 辅助函数 检查EventLoop是否为null
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
@@ -40,6 +47,21 @@ TcpConnection::TcpConnection(EventLoop* loop,               // 连接所属的Ev
     , localAddr_(localAddr) 
     , peerAddr_(peerAddr)   
     , highWaterMark_(64 * 1024 * 1024) // 写缓冲区高水位标记 64M
+    , pendingBytes_(0)
+    , zeroCopyThreshold_(0)         // 默认不开启零拷贝
+    , zeroCopyNextId_(0)
+    , zeroCopyBytes_(0)
+    , zeroCopyCopiedBytes_(0)
+    , flowHighMark_(0)              // 默认不开启流控
+    , flowLowMark_(0)
+    , flowPaused_(false)
+    , hasFlowSource_(false)
+    , readThrottled_(0)
+    , budgetPaused_(false)
+    , budgetWatching_(false)
+    , deferredFlush_(false)
+    , corkOnFlush_(false)
+    , flushScheduled_(false)
 
 {
     // 设置channel相应事件的回调函数  当sockfd上事件发生 -> 回调TcpConnection::handlexxx
@@ -77,8 +99,9 @@ void TcpConnection::send(const std::string& buf)
         }
         else // 否则，通过 runInLoop() 将任务加入事件循环队列，由 IO 线程执行
         {
+            // 拷贝一份数据投递过去，buf在任务执行时可能已经被调用方释放
             loop_->runInLoop(
-                std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf));
         }
     }
 
@@ -86,28 +109,105 @@ void TcpConnection::send(const std::string& buf)
 }
 
 
+// 分散/聚集发送  多段数据在sendvInLoop中通过一次writev写出，避免先拼接成一个string
+void TcpConnection::sendv(const StringPiece* pieces, size_t count)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendvInLoop(pieces, count);
+        }
+        else
+        {
+            // 跨线程：pieces指向的内存在任务执行时可能已失效，只能合并拷贝一份再投递
+            std::string data;
+            size_t total = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                total += pieces[i].size();
+            }
+            data.reserve(total);
+            for (size_t i = 0; i < count; ++i)
+            {
+                data.append(pieces[i].data(), pieces[i].size());
+            }
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(data)));
+        }
+    }
+}
+
+
+// 发送引用计数的数据块  payload由shared_ptr持有，跨线程投递时不需要拷贝
+void TcpConnection::send(const SharedPayload& payload)
+{
+    if (state_ == kConnected && payload)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendPayloadInLoop(payload);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendPayloadInLoop, shared_from_this(), payload));
+        }
+    }
+}
+
+
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+}
+
+
+// 开启/关闭零拷贝发送
+void TcpConnection::setZeroCopyThreshold(size_t threshold)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::setZeroCopyThresholdInLoop, shared_from_this(), threshold));
+}
+
+void TcpConnection::setZeroCopyThresholdInLoop(size_t threshold)
+{
+    // 只在第一次开启时设置socket选项 内核不支持则保持拷贝发送
+    if (threshold > 0 && zeroCopyThreshold_ == 0 && !socket_->setZeroCopy(true))
+    {
+        return;
+    }
+    zeroCopyThreshold_ = threshold;
+}
+
+
 // 发送文件内容  线程选择
 void TcpConnection::sendFile(int fileDescriptor, // 文件描述符，必须是一个已打开的普通文件
                              off_t offset, // 文件起始偏移
-                             size_t count) // 要发送的字节数
+                             size_t count, // 要发送的字节数
+                             const FileCompleteCallback& cb) // 该文件段发完后的回调
 {
     // 只有在连接已建立（state_ == kConnected）的状态下，才能发送数据
     if (connected())
     {
         if (loop_->isInLoopThread()) // 判断当前线程是否是loop循环的线程
         {
-            sendFileInLoop(fileDescriptor, offset, count);
+            sendFileInLoop(fileDescriptor, offset, count, cb);
         }
         else // 如果不是 则唤醒运行这个TcpConnection的线程执行loop循环
         {
             loop_->runInLoop(
                 std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), // shared_from_this() 保证当前对象在任务执行前不会被销毁
-                          fileDescriptor, offset, count));
+                          fileDescriptor, offset, count, cb));
         }
     }
     else // 连接未建立 记录错误日志
     {
         LOG_ERROR("TcpConnection::sendFile - not connected");
+        if (cb)
+        {
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), false));
+        }
     }
 }
 
@@ -123,12 +223,82 @@ void TcpConnection::shutdown() // 关闭写端，不再发送数据，但仍可
 }
 
 
+// 强制关闭连接  不等输出队列发完
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        // 放到下一轮执行：调用方可能正在遍历持有该连接的容器，handleClose会回调用户的连接回调
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose(); // 和对端关闭一样走关闭流程，未发出的数据随连接一起释放
+    }
+}
+
+
+// 恢复读  线程安全
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+// 暂停读  线程安全
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+
+// 开启自动流控
+void TcpConnection::setFlowControl(size_t highMark, size_t lowMark)
+{
+    flowHighMark_ = highMark;
+    flowLowMark_ = lowMark < highMark ? lowMark : highMark / 2;
+
+    // 关闭流控时撤销已有的暂停 否则按新水位重新判断
+    if (flowHighMark_ == 0)
+    {
+        releaseFlowControl();
+    }
+    else
+    {
+        checkFlowControl();
+    }
+}
+
+
+// 指定生产者连接 (代理场景: 上游连接读到的数据send到本连接)
+void TcpConnection::setFlowControlSource(const TcpConnectionPtr& source)
+{
+    releaseFlowControl(); // 先恢复旧的生产者
+    flowSource_ = source;
+    hasFlowSource_ = true;
+    checkFlowControl();
+}
+
+
 // 连接建立后 由 TcpServer 调用
 void TcpConnection::connectEstablished()
 {
+    if (tls_)
+    {
+        // TLS连接先握手 状态保持kConnecting，握手完成后再通知用户 (handshakeInLoop)
+        channel_->tie(shared_from_this());
+        channel_->enableReading();
+        handshakeInLoop();
+        return;
+    }
+
     setState(kConnected);              // 修改连接状态为 已连接
     channel_->tie(shared_from_this()); // 将当前连接的shared_ptr绑定给该连接的Channel
-    channel_->enableReading();         // 向poller注册该连接的fd的读事件 EPOLLIN
+    updateReading();                   // 向poller注册该连接的fd的读事件 EPOLLIN (建立前调用过stopRead则不注册)
 
     // 执行用户注册的“连接建立”回调
     connectionCallback_(shared_from_this()); // 通知用户（业务代码层）连接建立 
@@ -142,7 +312,9 @@ void TcpConnection::connectDestroyed()
     {
         setState(kDisconnected);                 // 连接状态设置为已断开
         channel_->disableAll();                  // 清除channel所有感兴趣事件
+        releaseFlowControl();                    // 不能让上游连接一直停在暂停状态
         connectionCallback_(shared_from_this()); // 通知用户连接销毁
+        abandonPendingFiles();
     }
 
     channel_->remove(); // 从 Poller 中移除 Channel
@@ -155,59 +327,281 @@ void TcpConnection::connectDestroyed()
 // 读是相对服务器而言的，当对端客户有数据到达，服务器端检测EPOLLIN，就会触发该fd上的回调，handleRead读走对端发来的数据
 void TcpConnection::handleRead(Timestamp receiveTime) 
 {
+    if (tls_ && state_ == kConnecting) // TLS握手中
+    {
+        handshakeInLoop();
+        return;
+    }
+
+    // 转发模式：数据由TcpRelay直接在内核中搬到对端 (拷贝一份指针，relay可能在处理中被释放)
+    std::shared_ptr<TcpRelay> relay(relay_);
+    if (relay && relay->handleReadable(shared_from_this()))
+    {
+        return;
+    }
+
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno); // fd--> inputbuffer
+    ssize_t n = readSocket(&inputBuffer_, &savedErrno); // fd--> inputbuffer (TLS时为解密后的数据)
     if (n > 0) // 有数据被读取成功
     {
         // 已建立连接的用户有可读事件发生了 调用用户传入的消息处理回调
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+
+        // TLS: 和数据一起收到了对端的close_notify
+        if (tls_ && tls_->peerClosed() && state_ != kDisconnected)
+        {
+            handleClose();
+            return;
+        }
+
+        // 内存预算紧张 => 占用大的连接先停止读
+        if (MemoryBudget::instance().underPressure())
+        {
+            checkMemoryBudget();
+        }
     }
     else if (n == 0) // 对端关闭连接 处理连接关闭
     {
         handleClose();
     }
+    else if (savedErrno == EAGAIN) // TLS: 记录还没有收全
+    {
+        // 等待下一次可读事件
+    }
     else // n < 0 出错了 处理错误流程
     {
         errno = savedErrno;
         LOG_ERROR("TcpConnection::handleRead");
         handleError();
+        if (tls_)
+        {
+            handleClose(); // TLS会话出错后不能再使用 (socket中未读的数据会让LT模式反复触发)
+        }
     }
 }
 
-// 处理写事件  outbuffer --> fd 
+// 处理写事件  输出队列 --> fd 
 void TcpConnection::handleWrite() 
 {
+    if (tls_ && state_ == kConnecting) // TLS握手中
+    {
+        handshakeInLoop();
+        return;
+    }
+
     if (channel_->isWriting()) // 判断当前Channel是否监听写事件 EPOLLOUT
     {
-        int savedErrno = 0;
+        // 转发模式：输出队列为空时的EPOLLOUT是为了继续搬运pipe中滞留的数据
+        if (relay_ && outputIdle())
+        {
+            std::shared_ptr<TcpRelay> relay(relay_);
+            relay->handleWritable(shared_from_this());
+            return;
+        }
 
-        // outbuffer --> fd 
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno); 
-        if (n > 0) // 写入成功
+        // 依次发送 outputBuffer_ 和排队的文件段，直到全部发完或者内核发送缓冲区写满
+        bool drained = drainOutput();
+        checkFlowControl(); // 队列降到低水位以下 => 恢复读生产者
+        if (drained) 
         {
-            outputBuffer_.retrieve(n); // 从缓冲区中读取readable区域的数据 移动readerIndex_
-            // 如果待发送的数据已经全部写完
-            if (outputBuffer_.readableBytes() == 0) 
+            channel_->disableWriting();  // 关闭写事件监听 输出队列已空，不再需要监听 EPOLLOUT
+            if (MemoryBudget::instance().underPressure())
+            {
+                outputBuffer_.shrink(0); // 内存紧张 归还发送积压时扩容的空间
+            }
+            if (budgetPaused_) // 输出发完了 本连接不再占用预算 恢复读 (还紧张时下次读到数据会重新检查)
+            {
+                resumeFromBudget();
+            }
+            if (writeCompleteCallback_)  // 若设置了写完成回调 投递到所属 EventLoop 中延迟执行
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            if (relay_) // 转发模式：缓冲区发完后轮到pipe中的数据
+            {
+                std::shared_ptr<TcpRelay> relay(relay_);
+                relay->handleWritable(shared_from_this());
+            }
+            if (state_ == kDisconnecting) // 若处于“半关闭”状态，此时满足!channel_->isWriting()，真正关闭连接
             {
-                channel_->disableWriting();  // 关闭写事件监听 写缓冲区已空，不再需要监听 EPOLLOUT
-                if (writeCompleteCallback_)  // 若设置了写完成回调 投递到所属 EventLoop 中延迟执行
+                shutdownInLoop();
+            }
+        }
+        // 没发完则保持监听EPOLLOUT，等socket再次可写
+    }
+    else // 当前Channel没有监听写事件却调用了 handleWrite()，是异常情况
+    {
+        LOG_ERROR("TcpConnection fd=%d is down, no more writing", channel_->fd());
+    }
+}
+
+
+/**
+ * 输出队列：outputBuffer_ -> pendingFiles_[0] -> pendingFiles_[0].trailer -> pendingFiles_[1] -> ...
+ * 
+ * - 没有排队的文件时，数据直接追加到 outputBuffer_
+ * - 有排队的文件时，数据追加到最后一个文件的 trailer，等该文件发完后 trailer 成为新的 outputBuffer_
+ * - send(SharedPayload) 没写完的部分作为payload段排队，只持有引用；相邻的普通数据和payload段用一次writev发出
+ * - 全部由 handleWrite 在 EPOLLOUT 时驱动，文件用 sendfile 发送，不会忙轮询
+ */
+
+// 队列中待发送的内存数据字节数 (含按引用排队的payload，不含文件段)
+// 每次send都会检查水位，排队的段可能很多 所以pendingFiles_中的字节数单独累计，不遍历
+size_t TcpConnection::bufferedOutputBytes() const
+{
+    return outputBuffer_.readableBytes() + pendingBytes_;
+}
+
+
+// 追加数据到输出队列的末尾
+void TcpConnection::appendToOutput(const char* data, size_t len)
+{
+    if (pendingFiles_.empty())
+    {
+        outputBuffer_.append(data, len);
+    }
+    else
+    {
+        pendingFiles_.back().trailer.append(data, len); // 排在最后一个文件段之后
+        pendingBytes_ += len;
+    }
+}
+
+
+// 按引用把payload[offset, size)排到输出队列末尾  队列持有payload直到这一段发完
+void TcpConnection::appendPayloadToOutput(const SharedPayload& payload, size_t offset)
+{
+    PendingFile segment;
+    segment.offset = static_cast<off_t>(offset);
+    segment.remaining = payload->size() - offset;
+    segment.payload = payload;
+    pendingBytes_ += segment.remaining;
+    pendingFiles_.push_back(std::move(segment));
+}
+
+
+// 尽量发送输出队列中的数据  返回true表示队列已清空，false表示内核发送缓冲区已满(或出错)需要等待EPOLLOUT
+bool TcpConnection::drainOutput()
+{
+    for (;;)
+    {
+        // 先发普通数据，连同紧跟其后的payload段及它们的trailer一次writev写出
+        if (outputBuffer_.readableBytes() > 0 || (!pendingFiles_.empty() && pendingFiles_.front().payload))
+        {
+            struct iovec vec[IOV_MAX];
+            int iovcnt = 0;
+            size_t total = 0;
+            if (outputBuffer_.readableBytes() > 0)
+            {
+                vec[iovcnt].iov_base = const_cast<char*>(outputBuffer_.peek());
+                vec[iovcnt].iov_len = outputBuffer_.readableBytes();
+                total += vec[iovcnt++].iov_len;
+            }
+            for (auto it = pendingFiles_.begin(); it != pendingFiles_.end() && it->payload && iovcnt < IOV_MAX; ++it)
+            {
+                vec[iovcnt].iov_base = const_cast<char*>(it->payload->data() + it->offset);
+                vec[iovcnt].iov_len = it->remaining;
+                total += vec[iovcnt++].iov_len;
+                if (it->trailer.readableBytes() > 0 && iovcnt < IOV_MAX)
                 {
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                    vec[iovcnt].iov_base = const_cast<char*>(it->trailer.peek());
+                    vec[iovcnt].iov_len = it->trailer.readableBytes();
+                    total += vec[iovcnt++].iov_len;
                 }
-                if (state_ == kDisconnecting) // 若处于“半关闭”状态，此时满足!channel_->isWriting()，真正关闭连接
+            }
+
+            int savedErrno = 0;
+            ssize_t n = writevSocket(vec, iovcnt, &savedErrno); // 输出队列 --> fd
+            if (n <= 0)
+            {
+                if (n < 0 && savedErrno != EWOULDBLOCK) // 真正的写错误
                 {
-                    shutdownInLoop();
+                    errno = savedErrno;
+                    LOG_ERROR("TcpConnection::handleWrite");
                 }
+                return false;
+            }
+
+            // 按队列顺序消耗写出的字节  payload段发完后释放引用，它的trailer成为新的outputBuffer_
+            size_t left = static_cast<size_t>(n);
+            for (;;)
+            {
+                size_t take = std::min(left, outputBuffer_.readableBytes());
+                outputBuffer_.retrieve(take); // 移动readerIndex_
+                left -= take;
+                if (outputBuffer_.readableBytes() > 0 || pendingFiles_.empty() || !pendingFiles_.front().payload)
+                {
+                    break;
+                }
+                PendingFile& segment = pendingFiles_.front();
+                take = std::min(left, segment.remaining);
+                segment.offset += take;
+                segment.remaining -= take;
+                pendingBytes_ -= take;
+                left -= take;
+                if (segment.remaining > 0)
+                {
+                    break;
+                }
+                if (segment.trailer.readableBytes() > 0) // trailer为空时保留outputBuffer_已有的容量
+                {
+                    pendingBytes_ -= segment.trailer.readableBytes();
+                    outputBuffer_.swap(segment.trailer);
+                }
+                pendingFiles_.pop_front();
+            }
+            if (static_cast<size_t>(n) < total)
+            {
+                return false; // 只写出一部分 说明内核发送缓冲区已满
             }
         }
-        else // n <= 0 写入失败，记录错误日志
+        else if (!pendingFiles_.empty()) // 再发排在后面的文件段
         {
-            LOG_ERROR("TcpConnection::handleWrite");
+            PendingFile& file = pendingFiles_.front();
+            if (file.remaining > 0)
+            {
+                // sendfile 文件内容直接在内核中拷贝到socket，offset会被自动推进 (kTLS时由内核加密)
+                ssize_t n = userTlsSend() ? sendFileTls(file.fd, &file.offset, file.remaining)
+                                          : ::sendfile(channel_->fd(), file.fd, &file.offset, file.remaining);
+                if (n < 0)
+                {
+                    if (errno != EWOULDBLOCK)
+                    {
+                        // 文件出错(EBADF EIO等)：对端收到的字节流已经不完整，只能关闭连接
+                        // (socket仍然可写，保留这一段会让LT模式的EPOLLOUT反复触发)  各文件段的cb在关闭时以false通知
+                        LOG_ERROR("TcpConnection::sendfile fd=%d errno=%d, closing connection\n", file.fd, errno);
+                        forceClose();
+                    }
+                    return false;
+                }
+                if (n == 0) // 文件比请求的范围短 已读到文件末尾
+                {
+                    LOG_ERROR("TcpConnection::sendfile fd=%d reached EOF with %lu bytes remaining\n", file.fd, file.remaining);
+                    file.remaining = 0;
+                }
+                else
+                {
+                    file.remaining -= n;
+                }
+                if (file.remaining > 0)
+                {
+                    return false;
+                }
+            }
+
+            // 文件段发完：它的trailer成为新的outputBuffer_ (此时outputBuffer_一定为空)
+            pendingBytes_ -= file.trailer.readableBytes();
+            outputBuffer_.swap(file.trailer);
+            if (file.cb)
+            {
+                loop_->queueInLoop(std::bind(file.cb, shared_from_this(), true));
+            }
+            pendingFiles_.pop_front();
+        }
+        else
+        {
+            return true; // 队列已清空
         }
-    }
-    else // 当前Channel没有监听写事件却调用了 handleWrite()，是异常情况
-    {
-        LOG_ERROR("TcpConnection fd=%d is down, no more writing", channel_->fd());
     }
 }
 
@@ -217,11 +611,17 @@ void TcpConnection::handleClose()
 {
     LOG_INFO("TcpConneciton::handleClose fd=%d state=%d\n", channel_->fd(), (int)state_);
 
+    bool established = state_ != kConnecting; // TLS握手没有完成的连接 用户没有收到过连接建立的回调
     setState(kDisconnected);        // 设置状态为已关闭，不再收发数据
     channel_->disableAll();         // 关闭所有感兴趣的事件
+    releaseFlowControl();           // 恢复被本连接暂停读的上游连接
 
     TcpConnectionPtr connPtr(shared_from_this());
-    connectionCallback_(connPtr);   // 用户设置的连接状态回调（通知用户连接状态发生变化）
+    if (established)
+    {
+        connectionCallback_(connPtr);   // 用户设置的连接状态回调（通知用户连接状态发生变化）
+    }
+    abandonPendingFiles();          // 没发完的文件段通知调用方 (之后可以关闭fd)
     
     // must be the last line 必须放在最后，因为closeCallback_内部有可能直接删除TcpConnection
     closeCallback_(connPtr);        // 服务端设置的关闭连接回调 绑定TcpServer::removeConnection回调方法
@@ -235,6 +635,13 @@ void TcpConnection::handleError()
     socklen_t optlen = sizeof optval; 
     int err = 0;// 存储getsockopt()失败的错误码
 
+    // 零拷贝完成通知也通过EPOLLERR上报，先把错误队列读空
+    int notifications = 0;
+    if (zeroCopyThreshold_ > 0 || !zeroCopyPending_.empty())
+    {
+        notifications = handleZeroCopyCompletions();
+    }
+
     // getsocket() 通过SO_ERROR选项读取Socket错误状态
     if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0 )
     {
@@ -245,6 +652,12 @@ void TcpConnection::handleError()
         err = optval;// 如果成功，说明 optval 中就是 socket 的错误码
     }
 
+    // 只是零拷贝完成通知 不是真正的错误
+    if (notifications > 0 && err == 0)
+    {
+        return;
+    }
+
     // 打印连接名 和对应的错误码
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
 }
@@ -254,31 +667,64 @@ void TcpConnection::handleError()
  * 发送数据  应用写的快  而内核发送数据慢 需要把待发送数据写入缓冲区 而且设置了水位回调
  */
 
-// 在EventLoop中发送数据
+// 在EventLoop中发送数据 (单段数据即只有一个切片的sendv)
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
+    StringPiece piece(static_cast<const char*>(data), len);
+    sendvInLoop(&piece, 1);
+}
+
+void TcpConnection::sendStringInLoop(const std::string& data)
+{
+    sendInLoop(data.data(), data.size());
+}
+
+
+// 在EventLoop中发送多段数据  所有切片通过一次writev写入socket，只把没写完的尾部追加到输出队列
+void TcpConnection::sendvInLoop(const StringPiece* pieces, size_t count, const SharedPayload* owner)
+{
+    size_t len = 0; // 所有切片的总长度
+    for (size_t i = 0; i < count; ++i)
+    {
+        len += pieces[i].size();
+    }
+
     ssize_t nwrote = 0;      // 实际写到Socket的字节数
-    ssize_t remaining = len; // 剩余还未写的数据长度
+    size_t remaining = len;  // 剩余还未写的数据长度
     bool faultError = false; // 标记是否出现致命错误
 
     // 若连接断开，不再发送，记录日志
     if (state_ == kDisconnected) 
     {
         LOG_ERROR("disconnected, give up writing");
+        return;
     }
 
     /**
-     * sendInLoop 先尝试直接写 socket，
+     * sendvInLoop 先尝试直接写 socket，
      * 若未写完则将剩余数据存入 outputBuffer，并注册写事件
-     * epoll 通知 socket 可写时调用handleWrite()，继续把 outputBuffer_ 中的数据写入 socket，直到写完
+     * epoll 通知 socket 可写时调用handleWrite()，继续把输出队列中的数据写入 socket，直到写完
      */
 
 
-    // 如果当前 channel 没有注册写事件，且 outputBuffer_ 为空，表示可以尝试直接写 socket 
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) 
+    // 如果当前 channel 没有注册写事件，且输出队列为空，表示可以尝试直接写 socket 
+    // (队列里还有数据或文件时必须排在它们后面，保证与先前send/sendFile的顺序一致)
+    // 延迟flush模式不直接写，全部进入输出队列，在本轮循环末尾合并发送
+    if (!deferredFlush_ && !channel_->isWriting() && outputIdle() && len > 0) 
     {
-        // 尝试直接将 data 写入 socket （不用缓冲区）
-        nwrote = ::write(channel_->fd(), data, len);
+        // 组装iovec 一次系统调用写出所有切片 (超过IOV_MAX的部分留给handleWrite)
+        struct iovec vec[IOV_MAX];
+        int iovcnt = 0;
+        for (size_t i = 0; i < count && iovcnt < IOV_MAX; ++i)
+        {
+            if (pieces[i].empty()) continue;
+            vec[iovcnt].iov_base = const_cast<char*>(pieces[i].data());
+            vec[iovcnt].iov_len = pieces[i].size();
+            ++iovcnt;
+        }
+
+        int savedErrno = 0;
+        nwrote = writevSocket(vec, iovcnt, &savedErrno);
 
         if (nwrote >= 0) // 写入成功
         {
@@ -292,11 +738,12 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         else // nwrote < 0 写入失败
         {
             nwrote = 0; // 写入字节数置0
-            if (errno != EWOULDBLOCK) // 若失败原因不是 “资源暂时不可用”，即真正的写错误
+            if (savedErrno != EWOULDBLOCK) // 若失败原因不是 “资源暂时不可用”，即真正的写错误
             {
-                LOG_ERROR("TcpConnection::sendInLoop");
+                errno = savedErrno;
+                LOG_ERROR("TcpConnection::sendvInLoop");
                 // 如果是 EPIPE（对端已关闭写）或 ECONNRESET（对端复位连接），标记出现错误
-                if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE RESET
+                if (savedErrno == EPIPE || savedErrno == ECONNRESET) // SIGPIPE RESET
                 {
                     faultError = true;
                 }
@@ -306,16 +753,16 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
 
     /**
      * 若还有未发送的数据（remaining > 0）且没有发生严重错误：
-     * - 说明当前这一次write并没有把数据全部发送出去，剩余的数据需要保存到outputbuffer中
+     * - 说明当前这一次writev并没有把数据全部发送出去，剩余的数据需要保存到输出队列中
      * - 然后给channel注册EPOLLOUT写事件，以便后续在 handleWrite 中继续发送
      * 
      * Poller发现tcp的发送缓冲区有可读空间后，通知相应的sock->channel => 调用channel对应注册的writeCallback_
-     * channel的writeCallback_就是TcpConnection设置的handleWrite，把outputBuffer_的内容全部发送
+     * channel的writeCallback_就是TcpConnection设置的handleWrite，把输出队列的内容全部发送
      **/
 
     if (!faultError && remaining > 0)
     {
-       size_t oldLen = outputBuffer_.readableBytes(); // 原先outputbuffer剩余待发送的数据的长度
+       size_t oldLen = bufferedOutputBytes(); // 原先输出队列剩余待发送的数据的长度
 
        // 如果写入后超过了高水位线，且原本没超过，则触发高水位回调
        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
@@ -324,11 +771,37 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
        }
 
-       // 将未写完的数据(data + nwrote之后长remianing的数据) 追加到 outputbuffer
-       outputBuffer_.append((char*)data + nwrote, remaining);
+       // 跳过已写出的nwrote字节，把各切片未写完的部分依次追加到输出队列
+       size_t skip = static_cast<size_t>(nwrote);
+       for (size_t i = 0; i < count; ++i)
+       {
+           size_t n = pieces[i].size();
+           if (skip >= n)
+           {
+               skip -= n; // 整段已写出
+               continue;
+           }
+           if (owner) // 来自SharedPayload 按引用排队
+           {
+               appendPayloadToOutput(*owner, pieces[i].data() - (*owner)->data() + skip);
+           }
+           else
+           {
+               appendToOutput(pieces[i].data() + skip, n - skip);
+           }
+           skip = 0;
+       }
+
+       // 输出队列积压到流控高水位 => 暂停读生产者，等handleWrite发到低水位再恢复
+       checkFlowControl();
 
+       // 延迟flush模式：本轮循环末尾统一发送 (已经在等EPOLLOUT的话交给handleWrite即可)
+       if (deferredFlush_ && !channel_->isWriting())
+       {
+           scheduleFlush();
+       }
        // 如果之前没有注册写事件，现在需要注册
-       if (!channel_->isWriting())
+       else if (!channel_->isWriting())
        {
            channel_->enableWriting(); 
            // 注册写事件，等待 poller 通知 socket 可写时执行 handleWrite
@@ -339,69 +812,560 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
 }
 
 
-// 在EventLoop中执行sendFile
+// 在EventLoop中发送payload  大块数据尝试MSG_ZEROCOPY，其余情况普通写，没写完的部分按引用排队
+void TcpConnection::sendPayloadInLoop(const SharedPayload& payload)
+{
+    const char* data = payload->data();
+    size_t len = payload->size();
+    StringPiece piece(data, len);
+
+    // 未开启零拷贝、数据太小，或者前面还有排队的数据(必须保证顺序) => 普通路径
+    // TLS连接(包括kTLS)不支持MSG_ZEROCOPY
+    if (zeroCopyThreshold_ == 0 || len < zeroCopyThreshold_ || tls_
+        || state_ == kDisconnected || channel_->isWriting() || !outputIdle())
+    {
+        sendvInLoop(&piece, 1, &payload);
+        return;
+    }
+
+    // 内核直接引用payload的内存页 调用成功即占用一个通知序号
+    ssize_t nwrote = ::send(channel_->fd(), data, len, MSG_ZEROCOPY);
+    if (nwrote < 0)
+    {
+        // ENOBUFS(optmem不足) EAGAIN等 => 交给普通路径处理 (会重试write或按引用排队)
+        sendvInLoop(&piece, 1, &payload);
+        return;
+    }
+
+    // 在完成通知到达之前持有payload
+    ZeroCopyPending pending;
+    pending.id = zeroCopyNextId_++;
+    pending.bytes = static_cast<size_t>(nwrote);
+    pending.payload = payload;
+    zeroCopyPending_.push_back(std::move(pending));
+
+    if (static_cast<size_t>(nwrote) < len)
+    {
+        // 没写完的尾部走普通路径 按引用排队等待EPOLLOUT
+        piece = StringPiece(data + nwrote, len - nwrote);
+        sendvInLoop(&piece, 1, &payload);
+    }
+    else if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+}
+
+
+// 读取零拷贝完成通知 (MSG_ERRQUEUE)，内核确认后释放对应的payload
+int TcpConnection::handleZeroCopyCompletions()
+{
+    int notifications = 0;
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // 错误队列为空时返回EAGAIN
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            bool recvErr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                        || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recvErr) continue;
+
+            const struct sock_extended_err* serr = 
+                reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+            // 一条通知覆盖序号区间 [ee_info, ee_data]
+            uint32_t hi = serr->ee_data;
+            bool copied = serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED; // 内核回退成了拷贝
+            ++notifications;
+
+            while (!zeroCopyPending_.empty() 
+                   && static_cast<int32_t>(hi - zeroCopyPending_.front().id) >= 0)
+            {
+                if (copied)
+                {
+                    zeroCopyCopiedBytes_ += zeroCopyPending_.front().bytes;
+                }
+                else
+                {
+                    zeroCopyBytes_ += zeroCopyPending_.front().bytes;
+                }
+                zeroCopyPending_.pop_front(); // 释放payload引用
+            }
+        }
+    }
+    return notifications;
+}
+
+
+// 在EventLoop中执行sendFile  文件段进入输出队列，由EPOLLOUT驱动发送
 void TcpConnection::sendFileInLoop( int fileDescriptor, // 要发送的源文件的fd
                                     off_t offset,       // 源文件中的偏移量，从offset开始发送
-                                    size_t count)       // 最多发送多少字节
+                                    size_t count,       // 最多发送多少字节
+                                    const FileCompleteCallback& cb)
 {
-    ssize_t bytesSent = 0;      // 实际发送的字节数
-    ssize_t remaining = count;  // 还有多少字节要发送（初始为全部）
-    bool faultError = false;    // 是否发生了致命错误
-
     // 表示此时连接已经断开 就不需要发送数据了
-    if (state_ == kDisconnecting) 
+    if (state_ == kDisconnecting || state_ == kDisconnected) 
     {
         LOG_ERROR("disconnected, give up writing");
+        if (cb)
+        {
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), false));
+        }
         return;
     }
 
-    // 当前没有监听写事件，且 outputBuffer_ 中没有待发送的数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
-    {
-        // 调用sendfile 系统调用  fileDescriptor指向的文件内容 --> socket fd
-        bytesSent = sendfile(socket_->fd(), fileDescriptor, &offset, remaining); 
+    // 排到输出队列末尾 (在它之前send的数据会先发出)
+    PendingFile file;
+    file.fd = fileDescriptor;
+    file.offset = offset;
+    file.remaining = count;
+    file.cb = cb;
+    pendingFiles_.push_back(std::move(file));
 
-        if (bytesSent >= 0) // 成功发送 bytesSent字节
+    // 当前没有在等待EPOLLOUT => 立即尝试发送，发不完再注册写事件
+    if (deferredFlush_ && !channel_->isWriting())
+    {
+        scheduleFlush();
+    }
+    else if (!channel_->isWriting())
+    {
+        bool drained = drainOutput();
+        checkFlowControl();
+        if (drained)
         {
-            remaining -= bytesSent; 
-            // 如果全部写完，并设置了写完成回调，投递到所属EventLoop中执行
-            if (remaining == 0 && writeCompleteCallback_)
+            if (writeCompleteCallback_)
             {
                 loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
             }
         }
-        else // bytesSend < 0 发送失败
+        else
         {
-            if (errno != EWOULDBLOCK) // 如果是非阻塞 socket 的正常现象（写缓冲区满）否则就异常情况
-            {
-                LOG_ERROR("TcpConneciton::sendFileInLoop");
-            }
-            if (errno == EPIPE || errno == ECONNRESET) // EPIPE（写端对方已关闭）或 ECONNRESET（连接被重置）
-            {
-                faultError = true;
-            }
+            channel_->enableWriting();
         }
     }
+}
+
+
+// 安排在本轮循环末尾flush  同一轮中多次send只安排一次
+void TcpConnection::scheduleFlush()
+{
+    if (!flushScheduled_)
+    {
+        flushScheduled_ = true;
+        loop_->runAtIterationEnd(std::bind(&TcpConnection::flushOutput, shared_from_this()));
+    }
+}
 
-    // 如果还有剩余数据，且没有致命错误
-    if (!faultError && remaining > 0)
+
+// 延迟flush：把本轮循环累积的数据一次发出
+void TcpConnection::flushOutput()
+{
+    flushScheduled_ = false;
+
+    // 连接已断开，或者已经在等EPOLLOUT(由handleWrite负责)
+    if (state_ == kDisconnected || channel_->isWriting())
+    {
+        return;
+    }
+
+    if (corkOnFlush_)
+    {
+        socket_->setTcpCork(true); // 合并outputBuffer_和文件段，凑满TCP段再发
+    }
+
+    bool drained = drainOutput(); // outputBuffer_是连续内存，一次write即可发出本轮所有小块数据
+    checkFlowControl();
+
+    if (corkOnFlush_)
+    {
+        socket_->setTcpCork(false); // 取消cork 剩余不满MSS的数据立即发出
+    }
+
+    if (drained)
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting) // shutdown时数据还没flush 现在可以关闭写端了
+        {
+            shutdownInLoop();
+        }
+    }
+    else
+    {
+        channel_->enableWriting(); // 没发完 等EPOLLOUT
+    }
+}
+
+
+/**
+ * 读控制
+ * - reading_ 是用户意愿 (startRead/stopRead)
+ * - readThrottled_ 是流控暂停计数 (下游连接输出队列积压时暂停读本连接)
+ * 两者都允许时channel才监听EPOLLIN  用户的stopRead不会被流控恢复，反之亦然
+ */
+
+void TcpConnection::startReadInLoop()
+{
+    reading_ = true;
+    updateReading();
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    reading_ = false;
+    updateReading();
+}
+
+void TcpConnection::throttleReadInLoop(bool on)
+{
+    readThrottled_ += on ? 1 : -1;
+    updateReading();
+}
+
+void TcpConnection::updateReading()
+{
+    // 已断开的连接不再注册事件 (handleClose中已经disableAll)
+    if (state_ != kConnected && state_ != kDisconnecting)
+    {
+        return;
+    }
+
+    bool wantRead = reading_ && readThrottled_ == 0;
+    if (wantRead && !channel_->isReading())
+    {
+        channel_->enableReading();
+    }
+    else if (!wantRead && channel_->isReading())
+    {
+        channel_->disableReading();
+    }
+}
+
+
+// 输出队列达到高水位 => 暂停生产者  降到低水位 => 恢复
+void TcpConnection::checkFlowControl()
+{
+    if (flowHighMark_ == 0)
+    {
+        return;
+    }
+
+    size_t buffered = bufferedOutputBytes();
+    if (!flowPaused_ && buffered >= flowHighMark_)
+    {
+        flowPaused_ = true;
+        throttleSource(true);
+    }
+    else if (flowPaused_ && buffered <= flowLowMark_)
     {
-        // 递归地将 sendFileInLoop 继续投递进 EventLoop 中处理
-        loop_->queueInLoop(
-            std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, remaining));
+        flowPaused_ = false;
+        throttleSource(false);
     }
+}
 
+
+void TcpConnection::throttleSource(bool on)
+{
+    if (!hasFlowSource_)
+    {
+        throttleReadInLoop(on);
+        return;
+    }
+
+    // 上游连接可能属于其他loop  同一线程投递的暂停/恢复按顺序执行
+    TcpConnectionPtr source = flowSource_.lock();
+    if (source)
+    {
+        source->getLoop()->runInLoop(
+            std::bind(&TcpConnection::throttleReadInLoop, source, on));
+    }
+}
+
+
+void TcpConnection::releaseFlowControl()
+{
+    if (flowPaused_)
+    {
+        flowPaused_ = false;
+        throttleSource(false);
+    }
+}
+
+
+// 连接关闭时调用  输出队列中的段不会再发出
+void TcpConnection::abandonPendingFiles()
+{
+    std::deque<PendingFile> files;
+    files.swap(pendingFiles_);
+    pendingBytes_ = 0;
+    TcpConnectionPtr guard(shared_from_this());
+    for (PendingFile& file : files)
+    {
+        if (file.cb)
+        {
+            file.cb(guard, false);
+        }
+    }
+}
+
+
+// 内存预算紧张时调用
+void TcpConnection::checkMemoryBudget()
+{
+    if (budgetPaused_)
+    {
+        return;
+    }
+
+    // 空闲的缓冲区只保留初始大小
+    if (inputBuffer_.readableBytes() == 0 && inputBuffer_.internalCapacity() > Buffer::kCheapPrepend + Buffer::kInitialSize)
+    {
+        inputBuffer_.shrink(Buffer::kInitialSize);
+    }
+    if (outputBuffer_.readableBytes() == 0 && outputBuffer_.internalCapacity() > Buffer::kCheapPrepend + Buffer::kInitialSize)
+    {
+        outputBuffer_.shrink(Buffer::kInitialSize);
+    }
+
+    size_t held = inputBuffer_.internalCapacity() + outputBuffer_.internalCapacity();
+    for (const PendingFile& file : pendingFiles_)
+    {
+        held += file.trailer.internalCapacity();
+    }
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    if (budget.shouldPauseRead(held, !outputIdle()))
+    {
+        budgetPaused_ = true;
+        throttleReadInLoop(true);
+        LOG_INFO("TcpConnection::checkMemoryBudget [%s] pause reading, holding %lu bytes\n", name_.c_str(), held);
+
+        if (budgetWatching_)
+        {
+            return;
+        }
+        budgetWatching_ = true;
+        // 紧张解除时回到本连接的loop恢复读 (连接可能已经销毁)
+        std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+        EventLoop* loop = loop_;
+        budget.runWhenRelieved([weakConn, loop]() {
+            TcpConnectionPtr conn = weakConn.lock();
+            if (conn)
+            {
+                loop->queueInLoop([conn]() {
+                    conn->budgetWatching_ = false;
+                    conn->resumeFromBudget();
+                });
+            }
+        });
+    }
+}
+
+
+void TcpConnection::resumeFromBudget()
+{
+    if (budgetPaused_)
+    {
+        budgetPaused_ = false;
+        throttleReadInLoop(false);
+    }
 }
 
 
 // 在EventLoop中关闭连接写端
 void TcpConnection::shutdownInLoop()
 {
-    // Channel没有在监听写事件 说明当前outputBuffer_的数据全部向外发送完成，可以关闭写端
-    if (!channel_->isWriting()) 
+    // Channel没有在监听写事件 说明当前输出队列的数据全部向外发送完成，可以关闭写端
+    // (延迟flush模式下还可能有等待本轮末尾flush的数据)
+    if (!channel_->isWriting() && outputIdle()) 
     {
+        if (tls_ && state_ != kConnecting)
+        {
+            tls_->shutdown(); // 先发送close_notify
+        }
         socket_->shutdownWrite(); // 调用Socket封装的 shutdown(SHUT_WR)，关闭写端，触发半关闭
     }
 
     // 如果channel还在监听 EPOLLOUT 写事件，表示还有数据未写入 socket，不能立即关闭写端。
-}
\ No newline at end of file
+}
+
+
+/**
+ * TLS
+ * - 握手由OpenSSL在用户态完成 (非阻塞，由可读/可写事件推进)
+ * - 握手后OpenSSL尝试kTLS，成功的方向上连接照常使用readv/write/writev/sendfile，由内核加解密
+ * - 没有kTLS的方向经过TlsSession在用户态加解密，输出队列、流控、写完成回调等逻辑不变
+ */
+
+void TcpConnection::startTls(const TlsContextPtr& ctx, const std::string& hostname)
+{
+    tls_.reset(new TlsSession(ctx, channel_->fd(), hostname));
+}
+
+bool TcpConnection::ktlsSend() const
+{
+    return tls_ && tls_->ktlsSend();
+}
+
+bool TcpConnection::ktlsRecv() const
+{
+    return tls_ && tls_->ktlsRecv();
+}
+
+bool TcpConnection::userTlsSend() const
+{
+    return tls_ && !tls_->ktlsSend();
+}
+
+
+// 推进TLS握手
+void TcpConnection::handshakeInLoop()
+{
+    TlsSession::Result result = tls_->handshake();
+    if (result == TlsSession::kWantRead)
+    {
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        return;
+    }
+    if (result == TlsSession::kWantWrite)
+    {
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+        return;
+    }
+    if (result == TlsSession::kError)
+    {
+        LOG_ERROR("TcpConnection::handshakeInLoop [%s] TLS handshake failed\n", name_.c_str());
+        handleClose();
+        return;
+    }
+
+    LOG_INFO("TcpConnection [%s] TLS established %s kTLS tx:%d rx:%d\n", name_.c_str(),
+             tls_->description().c_str(), tls_->ktlsSend(), tls_->ktlsRecv());
+    if (channel_->isWriting())
+    {
+        channel_->disableWriting();
+    }
+    setState(kConnected);
+    updateReading(); // 握手期间一直在读 恢复用户的设置
+    connectionCallback_(shared_from_this());
+
+    // 随握手最后一批数据到达的应用数据已经被OpenSSL读走并解密，epoll不会再通知
+    if (state_ == kConnected && tls_->hasPending())
+    {
+        handleRead(Timestamp::now());
+    }
+}
+
+
+ssize_t TcpConnection::readSocket(Buffer* buf, int* savedErrno)
+{
+    if (tls_ && !tls_->ktlsRecv())
+    {
+        return tls_->read(buf, savedErrno);
+    }
+    ssize_t n = buf->readFd(channel_->fd(), savedErrno);
+    if (n < 0 && *savedErrno == EIO && tls_)
+    {
+        // kTLS接收: 下一个记录不是应用数据(alert等)，普通read读不了 交给OpenSSL处理
+        return tls_->read(buf, savedErrno);
+    }
+    return n;
+}
+
+
+ssize_t TcpConnection::writeSocket(const void* data, size_t len, int* savedErrno)
+{
+    if (userTlsSend())
+    {
+        return tls_->write(data, len, savedErrno);
+    }
+    ssize_t n = ::write(channel_->fd(), data, len);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+    return n;
+}
+
+
+// 用户态TLS时每个切片单独SSL_write (各自成为一个或多个TLS记录)
+ssize_t TcpConnection::writevSocket(const struct iovec* vec, int iovcnt, int* savedErrno)
+{
+    if (!userTlsSend())
+    {
+        ssize_t n = ::writev(channel_->fd(), vec, iovcnt);
+        if (n < 0)
+        {
+            *savedErrno = errno;
+        }
+        return n;
+    }
+
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        ssize_t n = tls_->write(vec[i].iov_base, vec[i].iov_len, savedErrno);
+        if (n < 0)
+        {
+            return total > 0 ? total : -1;
+        }
+        total += n;
+        if (static_cast<size_t>(n) < vec[i].iov_len)
+        {
+            break; // 内核发送缓冲区已满
+        }
+    }
+    return total;
+}
+
+
+// 用户态TLS发送文件段  文件内容读到栈上加密后发送
+// 用pread不移动文件偏移 SSL_write返回EWOULDBLOCK后下次从同样的数据重试
+ssize_t TcpConnection::sendFileTls(int fd, off_t* offset, size_t count)
+{
+    char chunk[65536];
+    ssize_t total = 0;
+    while (static_cast<size_t>(total) < count)
+    {
+        size_t want = count - total < sizeof chunk ? count - total : sizeof chunk;
+        ssize_t r = ::pread(fd, chunk, want, *offset);
+        if (r <= 0)
+        {
+            return total > 0 ? total : r; // 出错或到达文件末尾
+        }
+        int savedErrno = 0;
+        ssize_t n = tls_->write(chunk, r, &savedErrno);
+        if (n < 0)
+        {
+            errno = savedErrno;
+            return total > 0 ? total : -1;
+        }
+        *offset += n;
+        total += n;
+        if (n < r)
+        {
+            break;
+        }
+    }
+    return total;
+}
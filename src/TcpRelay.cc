@@ -0,0 +1,338 @@
+#include <fcntl.h>      // splice SPLICE_F_* O_NONBLOCK
+#include <unistd.h>     // pipe2 close
+#include <errno.h>
+
+#include "TcpRelay.h"
+#include "TcpConnection.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+// 单次splice最多搬运的字节数 (默认pipe容量64KB)
+static const size_t kSpliceChunk = 64 * 1024;
+
+// 该方向能否splice  用户态TLS的数据必须经过OpenSSL (kTLS的方向由内核加解密，可以splice)
+static bool canSplice(const TcpConnectionPtr& src, const TcpConnectionPtr& dst)
+{
+    return !(src->tlsEnabled() && !src->ktlsRecv()) && !(dst->tlsEnabled() && !dst->ktlsSend());
+}
+
+
+TcpRelay::TcpRelay(const TcpConnectionPtr& first, const TcpConnectionPtr& second)
+    : bytesRelayed_(0)
+{
+    // 两条连接必须由同一个loop线程操作，否则无法无锁地读写双方状态
+    if (first->getLoop() != second->getLoop())
+    {
+        LOG_FATAL("%s:%s:%d relay connections must belong to the same loop!\n", __FILE__, __FUNCTION__, __LINE__);
+    }
+
+    dirs_[0].src = first;
+    dirs_[0].dst = second;
+    dirs_[1].src = second;
+    dirs_[1].dst = first;
+
+    for (Direction& dir : dirs_)
+    {
+        dir.pipeBytes = 0;
+        dir.eof = false;
+        dir.done = false;
+        dir.srcPaused = false;
+        dir.splice = canSplice(dir.src.lock(), dir.dst.lock());
+
+        // 每个方向一条非阻塞pipe作为splice的中转
+        if (!dir.splice)
+        {
+            dir.pipeFds[0] = dir.pipeFds[1] = -1;
+        }
+        else if (::pipe2(dir.pipeFds, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            LOG_ERROR("TcpRelay pipe2 error:%d, fall back to buffered relay\n", errno);
+            dir.pipeFds[0] = dir.pipeFds[1] = -1;
+            dir.splice = false;
+        }
+    }
+}
+
+TcpRelay::~TcpRelay()
+{
+    for (Direction& dir : dirs_)
+    {
+        // 转发结束时撤销背压 还存活的连接交回普通读流程
+        TcpConnectionPtr src = dir.src.lock();
+        if (src)
+        {
+            pauseSource(dir, src, false);
+        }
+        disableSplice(dir);
+    }
+}
+
+
+// 开始转发
+void TcpRelay::start()
+{
+    for (Direction& dir : dirs_)
+    {
+        TcpConnectionPtr src = dir.src.lock();
+        TcpConnectionPtr dst = dir.dst.lock();
+        if (!src || !dst)
+        {
+            LOG_ERROR("TcpRelay::start - connection already gone\n");
+            return;
+        }
+
+        // 由连接持有relay 任一连接存活时relay都有效
+        src->relay_ = shared_from_this();
+
+        // 转发开始前已经读进inputBuffer_的数据先按普通方式发过去
+        Buffer& input = src->inputBuffer_;
+        if (input.readableBytes() > 0)
+        {
+            bytesRelayed_ += input.readableBytes();
+            dst->sendInLoop(input.peek(), input.readableBytes());
+            input.retrieveAll();
+        }
+
+        src->updateReading();
+    }
+}
+
+
+// 源连接可读
+bool TcpRelay::handleReadable(const TcpConnectionPtr& conn)
+{
+    Direction& dir = (dirs_[0].src.lock() == conn) ? dirs_[0] : dirs_[1];
+    TcpConnectionPtr dst = dir.dst.lock();
+
+    // 对端已经关闭 => 该连接退出转发，交回用户的消息回调处理
+    if (!dst || !dst->connected())
+    {
+        conn->relay_.reset(); // 可能析构this 之后不能再访问成员
+        return false;
+    }
+
+    if (dir.splice)
+    {
+        spliceRead(dir, conn, dst);
+    }
+    else
+    {
+        bufferedRead(dir, conn, dst);
+    }
+    return true;
+}
+
+
+// 目标连接的输出队列已发完 继续搬运pipe中的数据
+void TcpRelay::handleWritable(const TcpConnectionPtr& conn)
+{
+    Direction& dir = (dirs_[0].dst.lock() == conn) ? dirs_[0] : dirs_[1];
+    TcpConnectionPtr src = dir.src.lock();
+
+    if (dir.splice)
+    {
+        flush(dir, src, conn);
+    }
+    else
+    {
+        // 普通转发：目标已发完，恢复读源连接
+        if (conn->channel_->isWriting())
+        {
+            conn->channel_->disableWriting();
+        }
+        if (src && !dir.eof)
+        {
+            pauseSource(dir, src, false);
+        }
+    }
+    closeIfDone(); // 半关闭等待的输出可能刚刚发完
+}
+
+
+// socket -> pipe
+void TcpRelay::spliceRead(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst)
+{
+    ssize_t n = ::splice(src->channel_->fd(), nullptr, dir.pipeFds[1], nullptr,
+                         kSpliceChunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0)
+    {
+        dir.pipeBytes += n;
+        flush(dir, src, dst);
+    }
+    else if (n == 0) // 对端半关闭 反方向继续转发
+    {
+        dir.eof = true;
+        pauseSource(dir, src, true); // EOF一直可读 不再监听
+        if (dir.pipeBytes == 0)
+        {
+            finish(dir, dst);
+        }
+    }
+    else
+    {
+        if (errno == EAGAIN || errno == EINTR)
+        {
+            return;
+        }
+        // 内核/fd类型不支持splice => 该方向退回普通转发
+        if ((errno == EINVAL || errno == ENOSYS) && dir.pipeBytes == 0)
+        {
+            LOG_ERROR("TcpRelay splice unsupported errno:%d, fall back to buffered relay\n", errno);
+            disableSplice(dir);
+            bufferedRead(dir, src, dst);
+            return;
+        }
+        LOG_ERROR("TcpRelay::spliceRead errno:%d\n", errno);
+        abort(src, dst);
+    }
+}
+
+
+// 不支持splice时的普通转发  socket -> inputBuffer_ -> dst
+void TcpRelay::bufferedRead(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst)
+{
+    int savedErrno = 0;
+    Buffer& input = src->inputBuffer_;
+    ssize_t n = src->readSocket(&input, &savedErrno); // TLS时为解密后的数据
+    if (n > 0)
+    {
+        bytesRelayed_ += input.readableBytes();
+        dst->sendInLoop(input.peek(), input.readableBytes());
+        input.retrieveAll();
+
+        // 背压：dst没能一次写完 先停止读src，等dst发完再恢复
+        if (dst->channel_->isWriting())
+        {
+            pauseSource(dir, src, true);
+        }
+    }
+    else if (n == 0)
+    {
+        dir.eof = true;
+        pauseSource(dir, src, true);
+        finish(dir, dst); // shutdown会等输出队列发完
+    }
+    else
+    {
+        LOG_ERROR("TcpRelay::bufferedRead errno:%d\n", savedErrno);
+        abort(src, dst);
+    }
+}
+
+
+// pipe -> socket
+void TcpRelay::flush(Direction& dir, const TcpConnectionPtr& src, const TcpConnectionPtr& dst)
+{
+    // dst的输出队列里还有数据时必须等它先发完，保证字节顺序
+    if (dst->outputIdle())
+    {
+        while (dir.pipeBytes > 0)
+        {
+            ssize_t n = ::splice(dir.pipeFds[0], nullptr, dst->channel_->fd(), nullptr,
+                                 dir.pipeBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                dir.pipeBytes -= n;
+                bytesRelayed_ += n;
+            }
+            else
+            {
+                if (n < 0 && errno != EAGAIN && errno != EINTR)
+                {
+                    LOG_ERROR("TcpRelay::flush errno:%d\n", errno);
+                }
+                break; // EAGAIN: dst内核发送缓冲区已满
+            }
+        }
+    }
+
+    if (dir.pipeBytes > 0)
+    {
+        // 背压：dst不可写 => 暂停读src，等待dst的EPOLLOUT
+        if (src)
+        {
+            pauseSource(dir, src, true);
+        }
+        if (!dst->channel_->isWriting())
+        {
+            dst->channel_->enableWriting();
+        }
+    }
+    else
+    {
+        // pipe已清空 => 不再需要EPOLLOUT，恢复读src
+        if (dst->channel_->isWriting() && dst->outputIdle())
+        {
+            dst->channel_->disableWriting();
+        }
+        if (src && !dir.eof)
+        {
+            pauseSource(dir, src, false);
+        }
+        if (dir.eof && !dir.done)
+        {
+            finish(dir, dst);
+        }
+    }
+}
+
+
+// src的数据已经全部转给dst => 半关闭dst，把EOF传递过去
+void TcpRelay::finish(Direction& dir, const TcpConnectionPtr& dst)
+{
+    dir.done = true; // 只传递一次
+    dst->shutdown();
+    closeIfDone();
+}
+
+
+// 两个方向的EOF都已传递：连接已经读到EOF且自己的输出发完(已半关闭)，可以关闭了
+// 还有输出没发完的连接等handleWritable再来检查
+void TcpRelay::closeIfDone()
+{
+    if (!dirs_[0].done || !dirs_[1].done)
+    {
+        return;
+    }
+    for (Direction& dir : dirs_)
+    {
+        TcpConnectionPtr conn = dir.src.lock();
+        if (conn && conn->state_ == TcpConnection::kDisconnecting && conn->outputIdle() && !conn->channel_->isWriting())
+        {
+            conn->handleClose();
+        }
+    }
+}
+
+
+void TcpRelay::abort(const TcpConnectionPtr& src, const TcpConnectionPtr& dst)
+{
+    dst->forceClose();
+    src->handleError();
+    src->handleClose();
+}
+
+
+void TcpRelay::pauseSource(Direction& dir, const TcpConnectionPtr& src, bool on)
+{
+    if (dir.srcPaused != on)
+    {
+        dir.srcPaused = on;
+        src->throttleReadInLoop(on);
+    }
+}
+
+
+void TcpRelay::disableSplice(Direction& dir)
+{
+    dir.splice = false;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (dir.pipeFds[i] >= 0)
+        {
+            ::close(dir.pipeFds[i]);
+            dir.pipeFds[i] = -1;
+        }
+    }
+}
@@ -94,14 +94,7 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
               name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
     
     // 获取sockfd绑定的本地地址localAddr（服务端）
-    sockaddr_in local; // 保存本地地址信息（服务端）
-    ::memset(&local, 0, sizeof(local));
-    socklen_t addrlen = sizeof(local);
-    if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0) // 调用 getsockname() 获取sockfd对应的本地地址
-    {
-        LOG_ERROR("sockets::getLocalAddr"); // 调用失败 打印日志
-    }
-    InetAddress localAddr(local); // 将获取的 sockaddr_in 包装成 InetAddress 类对象
+    InetAddress localAddr(InetAddress::getLocalAddr(sockfd)); // 调用 getsockname() 获取sockfd对应的本地地址 (IPv4/IPv6/Unix域)
     
     // 创建TcpConnectionPtr智能指针 conn
     TcpConnectionPtr conn( new TcpConnection(ioLoop,     
@@ -120,6 +113,11 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1) ); // 关闭连接时的回调
     
+    if (tlsContext_)
+    {
+        conn->startTls(tlsContext_); // 握手在subloop中进行
+    }
+
     // 将连接建立的后续工作TcpConnection::connectEstablished封装成一个任务，扔进 subLoop 的事件循环中去执行
     ioLoop->runInLoop(
         std::bind(&TcpConnection::connectEstablished, conn) );
@@ -1,6 +1,47 @@
 #include <time.h> // 引入时间相关库
+#include <stdio.h>
+#include <string.h>
 #include "Timestamp.h"
 
+namespace
+{
+// 每个线程缓存上一次格式化的秒数和对应的 "YYYYMMDD HH:MM:SS"
+// localtime_r 每次都要取libc内部的时区锁，日志每行都调用时多个线程会在这里互相竞争
+// 同一秒内的时间戳只需补上微秒部分
+__thread time_t t_lastSecond = -1;
+__thread char t_secondText[32];
+__thread size_t t_secondTextLen = 0;
+
+const char* formatSecond(time_t seconds, size_t* len)
+{
+    if (seconds != t_lastSecond)
+    {
+        struct tm tm_time;
+        ::localtime_r(&seconds, &tm_time); // 将时间戳转换为本地时间结构体tm
+
+        // 格式化时间为 "YYYYMMDD HH:MM:SS" 形式
+        int n = snprintf(t_secondText, sizeof t_secondText, "%4d%02d%02d %02d:%02d:%02d",
+                         tm_time.tm_year + 1900,   // 年
+                         tm_time.tm_mon + 1,       // 月
+                         tm_time.tm_mday,          // 日
+                         tm_time.tm_hour,          // 时
+                         tm_time.tm_min,           // 分
+                         tm_time.tm_sec);          // 秒
+        t_secondTextLen = n > 0 ? static_cast<size_t>(n) : 0;
+        t_lastSecond = seconds;
+    }
+    *len = t_secondTextLen;
+    return t_secondText;
+}
+
+int64_t readClock(clockid_t clock)
+{
+    struct timespec ts;
+    ::clock_gettime(clock, &ts); // vDSO实现 不陷入内核
+    return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+}
+
 // 默认构造
 Timestamp::Timestamp() : microSecondSinceEpoch_(0) // 初始化时间戳为0
 {
@@ -17,32 +58,68 @@ Timestamp::Timestamp(int64_t microSecondSinceEpoch)
 // 获取当前时间点的时间戳
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(nullptr)); // time(nullptr)返回以秒为单位的当前时间，存入microSecondSinceEpoch_
+    return Timestamp(readClock(CLOCK_REALTIME));
+}
+
+
+// 粗粒度的当前时间 只读内核在时钟中断时更新的值
+Timestamp Timestamp::nowCoarse()
+{
+    return Timestamp(readClock(CLOCK_REALTIME_COARSE));
+}
+
+
+// 格式化到buf  返回写入的长度(不含结尾的'\0')
+size_t Timestamp::format(char* buf, size_t size, bool showMicroseconds) const
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    size_t len = 0;
+    const char* text = formatSecond(secondsSinceEpoch(), &len);
+    if (len >= size)
+    {
+        len = size - 1;
+    }
+    ::memcpy(buf, text, len);
+
+    if (showMicroseconds && len + 8 <= size) // ".uuuuuu" 逐位写出，不走snprintf
+    {
+        int micro = static_cast<int>(microSecondSinceEpoch_ % kMicroSecondsPerSecond);
+        buf[len] = '.';
+        for (int i = 6; i >= 1; --i)
+        {
+            buf[len + i] = static_cast<char>('0' + micro % 10);
+            micro /= 10;
+        }
+        len += 7;
+    }
+    buf[len] = '\0';
+    return len;
 }
 
 
 // 时间戳转换为字符串格式
 std::string Timestamp::toString() const
 {
-    char buf[128] = {0}; // 存储格式化时间字符串
-    tm* tm_time = localtime(&microSecondSinceEpoch_); // 将时间戳转换为本地时间结构体tm
+    char buf[32];
+    size_t len = format(buf, sizeof buf, false);
+    return std::string(buf, len);
+}
 
-    // 格式化时间为 "YYYY/MM/DD HH:MM:SS" 形式，并存放到buf数组中
-    snprintf(buf, 128, "%4d%02d%02d %02d:%02d:%02d", 
-             tm_time->tm_year + 1900,   // 年
-             tm_time->tm_mon + 1,       // 月
-             tm_time->tm_mday,          // 日
-             tm_time->tm_hour,          // 时
-             tm_time->tm_min,           // 分
-             tm_time->tm_sec);          // 秒
-    
-    return buf; // 返回格式化后的事件字符串
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+    char buf[32];
+    size_t len = format(buf, sizeof buf, showMicroseconds);
+    return std::string(buf, len);
 }
 
 /* 测试代码 （需要时可取消注释）*/
 // #include <iostream>
 // int main()
 // {
-//     std::cout << Timestamp::now().toString() << std::endl;
+//     std::cout << Timestamp::now().toFormattedString() << std::endl;
 //     return 0; 
-// }
\ No newline at end of file
+// }
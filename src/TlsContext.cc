@@ -0,0 +1,152 @@
+#include "TlsContext.h"
+#include "Logger.h"
+
+#ifdef MUDUO_HAVE_OPENSSL
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+namespace
+{
+// 取出OpenSSL错误队列中最早的一条
+std::string lastError()
+{
+    char buf[256];
+    ERR_error_string_n(ERR_get_error(), buf, sizeof buf);
+    ERR_clear_error();
+    return buf;
+}
+
+SSL_CTX* newContext(bool server)
+{
+    SSL_CTX* ctx = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+    if (ctx == nullptr)
+    {
+        return nullptr;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    // 非阻塞socket上SSL_write可以只写出一部分，重试时数据地址可以变化 (输出缓冲区会移动)
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF); // 对端不发close_notify直接关闭 按EOF处理
+#endif
+    return ctx;
+}
+}
+
+
+TlsContext::TlsContext(ssl_ctx_st* ctx, bool server, bool verify)
+    : ctx_(ctx)
+    , server_(server)
+    , verify_(verify)
+{
+}
+
+TlsContext::~TlsContext()
+{
+    SSL_CTX_free(ctx_);
+}
+
+
+TlsContextPtr TlsContext::newServerContext(const std::string& certFile, const std::string& keyFile)
+{
+    SSL_CTX* ctx = newContext(true);
+    if (ctx == nullptr)
+    {
+        LOG_ERROR("TlsContext::newServerContext SSL_CTX_new: %s\n", lastError().c_str());
+        return nullptr;
+    }
+    if (SSL_CTX_use_certificate_chain_file(ctx, certFile.c_str()) != 1
+        || SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1
+        || SSL_CTX_check_private_key(ctx) != 1)
+    {
+        LOG_ERROR("TlsContext::newServerContext load %s %s: %s\n", certFile.c_str(), keyFile.c_str(), lastError().c_str());
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    return TlsContextPtr(new TlsContext(ctx, true, false));
+}
+
+
+TlsContextPtr TlsContext::newClientContext(const std::string& caFile)
+{
+    SSL_CTX* ctx = newContext(false);
+    if (ctx == nullptr)
+    {
+        LOG_ERROR("TlsContext::newClientContext SSL_CTX_new: %s\n", lastError().c_str());
+        return nullptr;
+    }
+    bool verify = !caFile.empty();
+    if (verify)
+    {
+        if (SSL_CTX_load_verify_locations(ctx, caFile.c_str(), nullptr) != 1)
+        {
+            LOG_ERROR("TlsContext::newClientContext load %s: %s\n", caFile.c_str(), lastError().c_str());
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    }
+    return TlsContextPtr(new TlsContext(ctx, false, verify));
+}
+
+
+void TlsContext::setKtls(bool on)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+    if (on)
+    {
+        SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+    else
+    {
+        SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+#else
+    (void)on;
+#endif
+}
+
+
+void TlsContext::setMaxTls12(bool on)
+{
+    SSL_CTX_set_max_proto_version(ctx_, on ? TLS1_2_VERSION : 0);
+}
+
+#else // 没有OpenSSL
+
+TlsContext::TlsContext(ssl_ctx_st* ctx, bool server, bool verify)
+    : ctx_(ctx)
+    , server_(server)
+    , verify_(verify)
+{
+}
+
+TlsContext::~TlsContext()
+{
+}
+
+TlsContextPtr TlsContext::newServerContext(const std::string&, const std::string&)
+{
+    LOG_ERROR("TlsContext: built without OpenSSL\n");
+    return nullptr;
+}
+
+TlsContextPtr TlsContext::newClientContext(const std::string&)
+{
+    LOG_ERROR("TlsContext: built without OpenSSL\n");
+    return nullptr;
+}
+
+void TlsContext::setKtls(bool)
+{
+}
+
+void TlsContext::setMaxTls12(bool)
+{
+}
+
+#endif
@@ -0,0 +1,235 @@
+#include <errno.h>
+#include <limits.h>
+
+#include "TlsSession.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#ifdef MUDUO_HAVE_OPENSSL
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/bio.h>
+
+namespace
+{
+const size_t kReadChunk = 16 * 1024; // 一个TLS记录最多16KB明文
+
+std::string lastError()
+{
+    char buf[256];
+    ERR_error_string_n(ERR_get_error(), buf, sizeof buf);
+    ERR_clear_error();
+    return buf;
+}
+}
+
+
+TlsSession::TlsSession(const TlsContextPtr& ctx, int sockfd, const std::string& hostname)
+    : context_(ctx)
+    , ssl_(SSL_new(ctx->native()))
+    , ktlsSend_(false)
+    , ktlsRecv_(false)
+    , peerClosed_(false)
+{
+    if (ssl_ == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d SSL_new: %s\n", __FILE__, __FUNCTION__, __LINE__, lastError().c_str());
+    }
+    SSL_set_fd(ssl_, sockfd); // socket BIO  OpenSSL握手后在这个fd上开启kTLS
+    if (ctx->isServer())
+    {
+        SSL_set_accept_state(ssl_);
+    }
+    else
+    {
+        SSL_set_connect_state(ssl_);
+        if (!hostname.empty())
+        {
+            SSL_set_tlsext_host_name(ssl_, hostname.c_str());
+            if (ctx->verifyPeer())
+            {
+                SSL_set1_host(ssl_, hostname.c_str());
+            }
+        }
+    }
+}
+
+TlsSession::~TlsSession()
+{
+    SSL_free(ssl_);
+}
+
+
+// 推进握手  完成后检查OpenSSL是否已把两个方向交给内核
+TlsSession::Result TlsSession::handshake()
+{
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1)
+    {
+#if defined(BIO_get_ktls_send) && !defined(OPENSSL_NO_KTLS)
+        ktlsSend_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+        ktlsRecv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+#endif
+        return kDone;
+    }
+
+    int err = SSL_get_error(ssl_, ret);
+    if (err == SSL_ERROR_WANT_READ)
+    {
+        return kWantRead;
+    }
+    if (err == SSL_ERROR_WANT_WRITE)
+    {
+        return kWantWrite;
+    }
+    LOG_ERROR("TlsSession::handshake error:%d errno:%d %s\n", err, errno, lastError().c_str());
+    return kError;
+}
+
+
+// 用户态解密  循环到没有完整记录为止
+ssize_t TlsSession::read(Buffer* buf, int* savedErrno)
+{
+    if (peerClosed_)
+    {
+        return 0;
+    }
+
+    ssize_t total = 0;
+    for (;;)
+    {
+        buf->ensureWritableBytes(kReadChunk);
+        size_t writable = buf->writableBytes() < INT_MAX ? buf->writableBytes() : INT_MAX;
+        ERR_clear_error();
+        int n = SSL_read(ssl_, buf->beginWrite(), static_cast<int>(writable));
+        if (n > 0)
+        {
+            buf->hasWritten(n);
+            total += n;
+            continue;
+        }
+
+        int err = SSL_get_error(ssl_, n);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+        {
+            if (total == 0)
+            {
+                *savedErrno = EAGAIN; // 记录还没收全 (或只是握手后的控制消息)
+                return -1;
+            }
+            return total;
+        }
+        if (err == SSL_ERROR_ZERO_RETURN || (err == SSL_ERROR_SYSCALL && errno == 0))
+        {
+            // 对端关闭  已读到的数据先交给用户，下次再返回0
+            peerClosed_ = true;
+            return total;
+        }
+        if (total > 0)
+        {
+            return total; // 错误留到下次读取时报告
+        }
+        *savedErrno = (err == SSL_ERROR_SYSCALL) ? errno : EPROTO;
+        LOG_ERROR("TlsSession::read error:%d %s\n", err, lastError().c_str());
+        return -1;
+    }
+}
+
+
+// 用户态加密发送
+ssize_t TlsSession::write(const void* data, size_t len, int* savedErrno)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+    ERR_clear_error();
+    int n = SSL_write(ssl_, data, static_cast<int>(len < INT_MAX ? len : INT_MAX));
+    if (n > 0)
+    {
+        return n;
+    }
+    int err = SSL_get_error(ssl_, n);
+    if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+    {
+        *savedErrno = EWOULDBLOCK;
+        return -1;
+    }
+    *savedErrno = (err == SSL_ERROR_SYSCALL && errno != 0) ? errno : EPIPE;
+    LOG_ERROR("TlsSession::write error:%d %s\n", err, lastError().c_str());
+    return -1;
+}
+
+
+bool TlsSession::hasPending() const
+{
+    return SSL_has_pending(ssl_) == 1;
+}
+
+
+void TlsSession::shutdown()
+{
+    ERR_clear_error();
+    SSL_shutdown(ssl_); // 只发出close_notify 不等待对端的close_notify
+    ERR_clear_error();
+}
+
+
+std::string TlsSession::description() const
+{
+    std::string desc = SSL_get_version(ssl_);
+    desc += " ";
+    desc += SSL_get_cipher_name(ssl_);
+    return desc;
+}
+
+#else // 没有OpenSSL  TlsContext工厂函数返回nullptr，不会创建TlsSession
+
+TlsSession::TlsSession(const TlsContextPtr& ctx, int, const std::string&)
+    : context_(ctx)
+    , ssl_(nullptr)
+    , ktlsSend_(false)
+    , ktlsRecv_(false)
+    , peerClosed_(false)
+{
+    LOG_FATAL("%s:%s:%d built without OpenSSL\n", __FILE__, __FUNCTION__, __LINE__);
+}
+
+TlsSession::~TlsSession()
+{
+}
+
+TlsSession::Result TlsSession::handshake()
+{
+    return kError;
+}
+
+ssize_t TlsSession::read(Buffer*, int* savedErrno)
+{
+    *savedErrno = EPROTO;
+    return -1;
+}
+
+ssize_t TlsSession::write(const void*, size_t, int* savedErrno)
+{
+    *savedErrno = EPROTO;
+    return -1;
+}
+
+bool TlsSession::hasPending() const
+{
+    return false;
+}
+
+void TlsSession::shutdown()
+{
+}
+
+std::string TlsSession::description() const
+{
+    return std::string();
+}
+
+#endif
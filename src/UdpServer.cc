@@ -0,0 +1,110 @@
+#include <future>
+
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+UdpServer::UdpServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& nameArg)
+    : loop_(loop)
+    , listenAddr_(listenAddr)
+    , name_(nameArg)
+    , threadPool_(new EventLoopThreadPool(loop, nameArg))
+    , maxDatagramSize_(2048)
+    , gro_(true)
+    , gso_(true)
+    , started_(0)
+{
+}
+
+// socket只能在所属loop线程中销毁：交给各自的loop执行并等待完成 (之后线程池才退出各loop)
+UdpServer::~UdpServer()
+{
+    std::vector<std::unique_ptr<UdpSocket>> sockets;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sockets.swap(sockets_);
+    }
+    for (std::unique_ptr<UdpSocket>& socket : sockets)
+    {
+        EventLoop* loop = socket->getLoop();
+        if (loop->isInLoopThread())
+        {
+            socket.reset();
+            continue;
+        }
+        UdpSocket* s = socket.release();
+        std::promise<void> done;
+        loop->runInLoop([s, &done]() {
+            delete s;
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+}
+
+
+void UdpServer::setThreadNum(int numThreads)
+{
+    threadPool_->setThreadNum(numThreads);
+}
+
+
+void UdpServer::start()
+{
+    if (started_.fetch_add(1) == 0)
+    {
+        // 没有子线程时在baseLoop上调用一次threadInit
+        threadPool_->start(std::bind(&UdpServer::threadInit, this, std::placeholders::_1));
+    }
+}
+
+
+void UdpServer::threadInit(EventLoop* loop)
+{
+    UdpSocket* socket = new UdpSocket(loop, listenAddr_, true, maxDatagramSize_, gro_, gso_);
+    socket->setMessageCallback(messageCallback_);
+    socket->start();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sockets_.emplace_back(socket);
+    }
+    if (threadInitCallback_)
+    {
+        threadInitCallback_(loop);
+    }
+}
+
+
+uint64_t UdpServer::receivedDatagrams() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const std::unique_ptr<UdpSocket>& socket : sockets_)
+    {
+        total += socket->receivedDatagrams();
+    }
+    return total;
+}
+
+uint64_t UdpServer::receiveCalls() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const std::unique_ptr<UdpSocket>& socket : sockets_)
+    {
+        total += socket->receiveCalls();
+    }
+    return total;
+}
+
+std::vector<UdpSocket*> UdpServer::sockets() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<UdpSocket*> result;
+    for (const std::unique_ptr<UdpSocket>& socket : sockets_)
+    {
+        result.push_back(socket.get());
+    }
+    return result;
+}
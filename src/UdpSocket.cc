@@ -0,0 +1,389 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103         // 旧版本头文件中没有定义 (Linux 4.18+)
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104             // Linux 5.0+
+#endif
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#include "UdpSocket.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+namespace
+{
+const size_t kControlSize = 64;                   // 每个消息的控制信息缓冲区 (UDP_GRO/UDP_SEGMENT)
+const size_t kMaxPendingBytes = 4 * 1024 * 1024;  // 发送队列超过该大小时立即flush
+const size_t kMaxGsoBytes = 65000;                // 一次GSO发送的总字节数上限 (IP包最大64KB)
+
+// 统计计数只有loop线程写：relaxed的读+写即可，不需要带锁的读-改-写
+inline void addCount(std::atomic<uint64_t>& counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// 创建非阻塞的UDP socket  IPv4或IPv6
+int createNonblockingUdp(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+// 地址都由InetAddress构造或由内核填写，未使用的字节为0，可以直接比较
+bool samePeer(const sockaddr_in6& a, socklen_t alen, const sockaddr_in6& b, socklen_t blen)
+{
+    return alen == blen && ::memcmp(&a, &b, alen) == 0;
+}
+}
+
+
+UdpSocket::UdpSocket(EventLoop* loop, const InetAddress& bindAddr, bool reusePort,
+                     size_t maxDatagramSize, bool enableGro, bool enableGso)
+    : loop_(loop)
+    , socket_(createNonblockingUdp(bindAddr.family()))
+    , channel_(loop, socket_.fd())
+    , gro_(false)
+    , gso_(false)
+    , slotSize_(maxDatagramSize < kMaxDatagram ? maxDatagramSize : kMaxDatagram)
+    , recvHeaders_(kBatch)
+    , recvIovecs_(kBatch)
+    , recvAddrs_(kBatch)
+    , recvControl_(kBatch * kControlSize)
+    , flushScheduled_(false)
+    , alive_(std::make_shared<bool>(true))
+    , sendHeaders_(kBatch)
+    , sendIovecs_(kBatch)
+    , sendControl_(kBatch * kControlSize)
+    , sendCounts_(kBatch)
+    , receivedDatagrams_(0)
+    , receiveCalls_(0)
+    , groPackets_(0)
+    , truncated_(0)
+    , sentDatagrams_(0)
+    , sendCalls_(0)
+    , droppedDatagrams_(0)
+{
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reusePort); // 每个loop一个socket绑定同一端口，内核按四元组哈希分给各个socket
+    socket_.bindAddress(bindAddr);
+
+    int on = 1;
+    if (enableGro && ::setsockopt(socket_.fd(), SOL_UDP, UDP_GRO, &on, sizeof on) == 0)
+    {
+        gro_ = true;
+        slotSize_ = kMaxDatagram; // 合并后的包可能有64KB
+    }
+    int zero = 0;
+    if (enableGso && ::setsockopt(socket_.fd(), SOL_UDP, UDP_SEGMENT, &zero, sizeof zero) == 0)
+    {
+        gso_ = true; // 内核支持UDP_SEGMENT  每次发送时用控制信息指定段长
+    }
+    LOG_INFO("UdpSocket fd=%d bound to %s gro=%d gso=%d\n",
+             socket_.fd(), bindAddr.toIpPort().c_str(), gro_, gso_);
+
+    slab_.reset(new char[kBatch * slotSize_]);
+    for (int i = 0; i < kBatch; ++i)
+    {
+        recvIovecs_[i].iov_base = slab_.get() + i * slotSize_;
+        recvIovecs_[i].iov_len = slotSize_;
+    }
+
+    channel_.setReadCallback(std::bind(&UdpSocket::handleRead, this, std::placeholders::_1));
+}
+
+UdpSocket::~UdpSocket()
+{
+    if (!pending_.empty())
+    {
+        flush();
+    }
+    channel_.disableAll();
+    channel_.remove();
+}
+
+
+void UdpSocket::start()
+{
+    loop_->runInLoop([this]() { channel_.enableReading(); });
+}
+
+
+// 每次recvmmsg前重新设置 (内核会改写地址和控制信息的长度)
+void UdpSocket::resetReceiveHeaders()
+{
+    for (int i = 0; i < kBatch; ++i)
+    {
+        struct msghdr& msg = recvHeaders_[i].msg_hdr;
+        msg.msg_name = &recvAddrs_[i];
+        msg.msg_namelen = sizeof(sockaddr_in6);
+        msg.msg_iov = &recvIovecs_[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = gro_ ? &recvControl_[i * kControlSize] : nullptr;
+        msg.msg_controllen = gro_ ? kControlSize : 0;
+        msg.msg_flags = 0;
+        recvHeaders_[i].msg_len = 0;
+    }
+}
+
+
+// 可读  一批一批地收 收满一批说明还有数据，最多连续收kMaxRounds批，避免饿死同一loop上的其他Channel
+void UdpSocket::handleRead(Timestamp receiveTime)
+{
+    static const int kMaxRounds = 8;
+    for (int round = 0; round < kMaxRounds; ++round)
+    {
+        resetReceiveHeaders();
+        int n = ::recvmmsg(socket_.fd(), recvHeaders_.data(), kBatch, MSG_DONTWAIT, nullptr);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_ERROR("UdpSocket::handleRead recvmmsg fd=%d errno=%d\n", socket_.fd(), errno);
+            }
+            break;
+        }
+        addCount(receiveCalls_);
+        for (int i = 0; i < n; ++i)
+        {
+            dispatch(i, receiveTime);
+        }
+        if (n < kBatch)
+        {
+            break;
+        }
+    }
+}
+
+
+void UdpSocket::dispatch(int index, Timestamp receiveTime)
+{
+    const struct msghdr& msg = recvHeaders_[index].msg_hdr;
+    const char* data = static_cast<const char*>(recvIovecs_[index].iov_base);
+    size_t len = recvHeaders_[index].msg_len;
+    if (msg.msg_flags & MSG_TRUNC)
+    {
+        addCount(truncated_);
+    }
+
+    // GRO合并的包：控制信息中带有每段的长度
+    size_t segment = len;
+    if (gro_)
+    {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int gsoSize = 0;
+                ::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+                if (gsoSize > 0 && static_cast<size_t>(gsoSize) < len)
+                {
+                    segment = gsoSize;
+                    addCount(groPackets_);
+                }
+                break;
+            }
+        }
+    }
+
+    InetAddress peer(reinterpret_cast<const sockaddr*>(&recvAddrs_[index]), recvHeaders_[index].msg_hdr.msg_namelen);
+    for (size_t off = 0; off < len; off += segment)
+    {
+        size_t segLen = len - off < segment ? len - off : segment;
+        addCount(receivedDatagrams_);
+        if (messageCallback_)
+        {
+            messageCallback_(this, data + off, segLen, peer, receiveTime);
+        }
+    }
+}
+
+
+// 发送数据报
+void UdpSocket::send(const void* data, size_t len, const InetAddress& peer)
+{
+    if (loop_->isInLoopThread())
+    {
+        queueSend(data, len, peer);
+    }
+    else
+    {
+        std::weak_ptr<bool> alive(alive_);
+        std::string copy(static_cast<const char*>(data), len);
+        loop_->queueInLoop([this, alive, copy, peer]() {
+            if (alive.lock())
+            {
+                sendInLoop(copy, peer);
+            }
+        });
+    }
+}
+
+void UdpSocket::sendInLoop(const std::string& data, const InetAddress& peer)
+{
+    queueSend(data.data(), data.size(), peer);
+}
+
+
+// 追加到发送队列  本轮循环末尾统一发出
+void UdpSocket::queueSend(const void* data, size_t len, const InetAddress& peer)
+{
+    PendingSend item;
+    item.offset = sendBuffer_.size();
+    item.len = len;
+    ::memset(&item.peer, 0, sizeof item.peer);
+    item.peerLen = peer.getSockLen() < sizeof item.peer ? peer.getSockLen() : sizeof item.peer;
+    ::memcpy(&item.peer, peer.getSockAddr(), item.peerLen);
+    sendBuffer_.append(static_cast<const char*>(data), len);
+    pending_.push_back(item);
+
+    if (sendBuffer_.size() >= kMaxPendingBytes)
+    {
+        flush();
+        return;
+    }
+    if (!flushScheduled_)
+    {
+        flushScheduled_ = true;
+        std::weak_ptr<bool> alive(alive_);
+        loop_->runAtIterationEnd([this, alive]() {
+            if (alive.lock())
+            {
+                flush();
+            }
+        });
+    }
+}
+
+
+// 从pending_[first]开始组装最多kBatch条消息  consumed返回用掉的数据报数
+// useGso时，同一对端、长度相同的连续数据报(最后一个可以更短)合并成一条带UDP_SEGMENT的消息
+size_t UdpSocket::buildSendBatch(size_t first, bool useGso, size_t* consumed)
+{
+    size_t count = 0;
+    size_t i = first;
+    while (i < pending_.size() && count < static_cast<size_t>(kBatch))
+    {
+        const PendingSend& head = pending_[i];
+        size_t segments = 1;
+        size_t bytes = head.len;
+        if (useGso && head.len > 0)
+        {
+            // 队列中的数据是连续追加的，相邻数据报在sendBuffer_中也相邻
+            while (i + segments < pending_.size() && segments < kMaxGsoSegments)
+            {
+                const PendingSend& next = pending_[i + segments];
+                if (!samePeer(next.peer, next.peerLen, head.peer, head.peerLen) || next.len == 0 || next.len > head.len
+                    || bytes + next.len > kMaxGsoBytes)
+                {
+                    break;
+                }
+                bytes += next.len;
+                ++segments;
+                if (next.len < head.len) // 较短的只能是最后一段
+                {
+                    break;
+                }
+            }
+        }
+
+        struct mmsghdr& hdr = sendHeaders_[count];
+        ::memset(&hdr, 0, sizeof hdr);
+        sendIovecs_[count].iov_base = &sendBuffer_[head.offset];
+        sendIovecs_[count].iov_len = bytes;
+        hdr.msg_hdr.msg_name = const_cast<sockaddr_in6*>(&head.peer);
+        hdr.msg_hdr.msg_namelen = head.peerLen;
+        hdr.msg_hdr.msg_iov = &sendIovecs_[count];
+        hdr.msg_hdr.msg_iovlen = 1;
+        if (segments > 1)
+        {
+            char* control = &sendControl_[count * kControlSize];
+            ::memset(control, 0, kControlSize);
+            hdr.msg_hdr.msg_control = control;
+            hdr.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr.msg_hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gsoSize = static_cast<uint16_t>(head.len);
+            ::memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof gsoSize);
+        }
+        sendCounts_[count] = segments;
+        ++count;
+        i += segments;
+    }
+    *consumed = i - first;
+    return count;
+}
+
+
+// sendmmsg发出队列中的所有数据报
+void UdpSocket::flush()
+{
+    flushScheduled_ = false;
+    size_t next = 0; // pending_中下一个待发送的数据报
+    while (next < pending_.size())
+    {
+        size_t consumed = 0;
+        size_t count = buildSendBatch(next, gso_, &consumed);
+        size_t done = 0; // 本批已发出的消息数
+        size_t handled = 0; // 本批已处理(发出或丢弃)的数据报数
+        bool rebuild = false;
+        while (done < count)
+        {
+            int n = ::sendmmsg(socket_.fd(), &sendHeaders_[done], static_cast<unsigned int>(count - done), 0);
+            addCount(sendCalls_);
+            if (n > 0)
+            {
+                for (int k = 0; k < n; ++k)
+                {
+                    addCount(sentDatagrams_, sendCounts_[done + k]);
+                    handled += sendCounts_[done + k];
+                }
+                done += n;
+                continue;
+            }
+
+            int savedErrno = errno;
+            if (savedErrno == EINTR)
+            {
+                continue;
+            }
+            if (gso_ && sendCounts_[done] > 1 && (savedErrno == EIO || savedErrno == EINVAL))
+            {
+                // 网卡/路径不支持GSO  关闭后重新组装剩余部分
+                LOG_ERROR("UdpSocket fd=%d GSO send failed errno=%d, disabling GSO\n", socket_.fd(), savedErrno);
+                gso_ = false;
+                rebuild = true;
+                break;
+            }
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK || savedErrno == ENOBUFS)
+            {
+                // 内核发送缓冲区满 丢弃剩余的全部数据报
+                addCount(droppedDatagrams_, pending_.size() - (next + handled));
+                sendBuffer_.clear();
+                pending_.clear();
+                return;
+            }
+            // 其他错误(如对端不可达)只丢弃这一条消息
+            LOG_ERROR("UdpSocket::flush sendmmsg fd=%d errno=%d\n", socket_.fd(), savedErrno);
+            addCount(droppedDatagrams_, sendCounts_[done]);
+            handled += sendCounts_[done];
+            ++done;
+        }
+        next += rebuild ? handled : consumed;
+    }
+    sendBuffer_.clear();
+    pending_.clear();
+}
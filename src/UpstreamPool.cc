@@ -0,0 +1,437 @@
+#include <string.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+#include "UpstreamPool.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+const int64_t UpstreamPool::kWaitBucketLimits[UpstreamPool::kWaitBuckets - 1] =
+    { 100, 1000, 10 * 1000, 100 * 1000, 1000 * 1000 }; // 100us 1ms 10ms 100ms 1s
+
+namespace
+{
+const double kMaintainInterval = 1.0; // 维护定时器间隔(秒)
+
+// 连接池析构后还存在的连接 关闭时直接在loop中销毁
+void destroyConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+}
+
+
+UpstreamPool::UpstreamPool(EventLoop* loop, const InetAddress& upstream, const std::string& name)
+    : loop_(loop)
+    , upstream_(upstream)
+    , name_(name)
+    , minSize_(0)
+    , maxSize_(16)
+    , maxWaiters_(1024)
+    , idleTimeout_(60.0)
+    , checkoutTimeout_(1.0)
+    , retryInitMs_(Connector::kInitRetryDelayMs)
+    , retryMaxMs_(Connector::kMaxRetryDelayMs)
+    , messageCallback_([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); })
+    , connectionCallback_([](const TcpConnectionPtr&) { })
+    , started_(false)
+    , nextConnId_(1)
+    , nextWaiterId_(1)
+    , alive_(std::make_shared<bool>(true))
+    , checkouts_(0)
+    , hits_(0)
+    , waits_(0)
+    , timeouts_(0)
+    , rejected_(0)
+    , connects_(0)
+    , evictions_(0)
+{
+    ::memset(waitHistogram_, 0, sizeof waitHistogram_);
+}
+
+// 需在loop线程中析构 (或loop结束之后)
+UpstreamPool::~UpstreamPool()
+{
+    alive_.reset(); // 之后到期的定时器不再访问this
+    loop_->cancel(maintainTimer_);
+
+    for (const std::shared_ptr<Connector>& connector : connectors_)
+    {
+        connector->stop();
+    }
+
+    // 还在排队的请求全部失败
+    std::deque<Waiter> waiters;
+    waiters.swap(waiters_);
+    for (Waiter& waiter : waiters)
+    {
+        loop_->cancel(waiter.timer);
+        waiter.callback(TcpConnectionPtr());
+    }
+
+    // 连接不再回调连接池  空闲的直接关闭，借出的由使用者用完后关闭
+    // 借出的连接之后收到的响应直接交给用户的消息回调 (不再经过onMessage)
+    CloseCallback closeCb = std::bind(&destroyConnection, loop_, std::placeholders::_1);
+    MessageCallback messageCb = messageCallback_;
+    auto detach = [&closeCb, &messageCb](const TcpConnectionPtr& conn) {
+        conn->setCloseCallback(closeCb);
+        conn->setConnectionCallback([](const TcpConnectionPtr&) { });
+        conn->setMessageCallback(messageCb);
+    };
+    for (const IdleConn& idle : idle_)
+    {
+        detach(idle.conn);
+        idle.conn->forceClose();
+    }
+    for (const auto& item : busy_)
+    {
+        detach(item.second);
+    }
+}
+
+
+void UpstreamPool::start()
+{
+    loop_->runInLoop(std::bind(&UpstreamPool::startInLoop, this));
+}
+
+void UpstreamPool::startInLoop()
+{
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+    if (maxSize_ < minSize_)
+    {
+        maxSize_ = minSize_;
+    }
+    while (totalCount() < minSize_)
+    {
+        connectOne();
+    }
+
+    std::weak_ptr<bool> alive(alive_);
+    maintainTimer_ = loop_->runEvery(kMaintainInterval, [this, alive]() {
+        if (alive.lock())
+        {
+            maintain();
+        }
+    });
+}
+
+
+// 借连接  转到loop线程执行
+void UpstreamPool::checkout(CheckoutCallback cb)
+{
+    if (loop_->isInLoopThread())
+    {
+        checkoutInLoop(cb);
+    }
+    else
+    {
+        // 投递期间连接池可能析构
+        std::weak_ptr<bool> alive(alive_);
+        loop_->queueInLoop([this, alive, cb]() {
+            if (alive.lock())
+            {
+                checkoutInLoop(cb);
+            }
+            else
+            {
+                cb(TcpConnectionPtr());
+            }
+        });
+    }
+}
+
+void UpstreamPool::checkoutInLoop(const CheckoutCallback& cb)
+{
+    ++checkouts_;
+
+    // 有空闲连接 取最近归还的那个
+    while (!idle_.empty())
+    {
+        TcpConnectionPtr conn = idle_.back().conn;
+        idle_.pop_back();
+        if (conn->connected())
+        {
+            ++hits_;
+            busy_[conn.get()] = conn;
+            cb(conn);
+            return;
+        }
+        // 已断开但关闭回调还没来得及执行 (不会再放回池中)
+    }
+
+    // 没有空闲连接 排队等待
+    if (waiters_.size() >= maxWaiters_)
+    {
+        ++rejected_;
+        cb(TcpConnectionPtr());
+        return;
+    }
+    ++waits_;
+
+    Waiter waiter;
+    waiter.id = nextWaiterId_++;
+    waiter.enqueued = Timestamp::now();
+    waiter.callback = cb;
+    if (checkoutTimeout_ > 0)
+    {
+        std::weak_ptr<bool> alive(alive_);
+        uint64_t id = waiter.id;
+        waiter.timer = loop_->runAfter(checkoutTimeout_, [this, alive, id]() {
+            if (alive.lock())
+            {
+                onWaiterTimeout(id);
+            }
+        });
+    }
+    waiters_.push_back(std::move(waiter));
+
+    // 还没到上限 为等待者新建连接 (正在建立的连接不够分时才新建)
+    if (totalCount() < maxSize_ && connectors_.size() < waiters_.size())
+    {
+        connectOne();
+    }
+}
+
+
+// 归还连接
+void UpstreamPool::checkin(const TcpConnectionPtr& conn, bool reusable)
+{
+    if (loop_->isInLoopThread())
+    {
+        checkinInLoop(conn, reusable);
+    }
+    else
+    {
+        // 投递期间连接池可能析构  此时连接已脱离连接池，直接关闭
+        std::weak_ptr<bool> alive(alive_);
+        loop_->queueInLoop([this, alive, conn, reusable]() {
+            if (alive.lock())
+            {
+                checkinInLoop(conn, reusable);
+            }
+            else if (reusable)
+            {
+                conn->shutdown();
+            }
+            else
+            {
+                conn->forceClose();
+            }
+        });
+    }
+}
+
+void UpstreamPool::checkinInLoop(const TcpConnectionPtr& conn, bool reusable)
+{
+    auto it = busy_.find(conn.get());
+    if (it == busy_.end())
+    {
+        return; // 不是借出的连接 (已被关闭移出)
+    }
+    busy_.erase(it);
+
+    if (!reusable || !conn->connected())
+    {
+        conn->forceClose(); // 不放回池中 (可能残留未读完的响应，不能等对端配合半关闭) 关闭后由removeConnection处理
+        if (totalCount() < maxSize_ && (!waiters_.empty() || totalCount() < minSize_))
+        {
+            connectOne();
+        }
+        return;
+    }
+    handOut(conn);
+}
+
+
+// 连接可用：先满足排队的请求，没有则放回空闲列表
+void UpstreamPool::handOut(const TcpConnectionPtr& conn)
+{
+    if (!waiters_.empty())
+    {
+        Waiter waiter = std::move(waiters_.front());
+        waiters_.pop_front();
+        loop_->cancel(waiter.timer);
+        recordWait(waiter.enqueued);
+        busy_[conn.get()] = conn;
+        waiter.callback(conn);
+        return;
+    }
+
+    IdleConn idle;
+    idle.conn = conn;
+    idle.since = Timestamp::now();
+    idle_.push_back(std::move(idle));
+}
+
+
+void UpstreamPool::onWaiterTimeout(uint64_t id)
+{
+    for (auto it = waiters_.begin(); it != waiters_.end(); ++it)
+    {
+        if (it->id == id)
+        {
+            CheckoutCallback cb = std::move(it->callback);
+            waiters_.erase(it);
+            ++timeouts_;
+            LOG_ERROR("UpstreamPool[%s] checkout timeout, upstream %s\n",
+                      name_.c_str(), upstream_.toIpPort().c_str());
+            cb(TcpConnectionPtr());
+            return;
+        }
+    }
+}
+
+
+// 新建一个到上游的连接  连接失败时Connector按指数退避重试
+void UpstreamPool::connectOne()
+{
+    std::shared_ptr<Connector> connector(new Connector(loop_, upstream_));
+    connector->setRetryDelay(retryInitMs_, retryMaxMs_);
+    std::weak_ptr<Connector> weakConnector(connector);
+    connector->setNewConnectionCallback([this, weakConnector](int sockfd) {
+        std::shared_ptr<Connector> c(weakConnector.lock());
+        newConnection(c, sockfd);
+    });
+    connectors_.insert(connector);
+    connector->start();
+}
+
+
+// 连接建立  和TcpClient::newConnection一样创建TcpConnection
+void UpstreamPool::newConnection(const std::shared_ptr<Connector>& connector, int sockfd)
+{
+    // Connector正在回调中 延后释放
+    loop_->queueInLoop([connector]() { });
+    connectors_.erase(connector);
+
+    char buf[64] = {0};
+    snprintf(buf, sizeof buf, ":%s#%d", upstream_.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, name_ + buf, sockfd, InetAddress::getLocalAddr(sockfd), upstream_));
+    conn->setConnectionCallback(std::bind(&UpstreamPool::onConnection, this, std::placeholders::_1));
+    conn->setMessageCallback(std::bind(&UpstreamPool::onMessage, this, std::placeholders::_1,
+                                       std::placeholders::_2, std::placeholders::_3));
+    conn->setCloseCallback(std::bind(&UpstreamPool::removeConnection, this, std::placeholders::_1));
+    conn->connectEstablished();
+    ++connects_;
+
+    handOut(conn);
+}
+
+
+void UpstreamPool::onConnection(const TcpConnectionPtr& conn)
+{
+    connectionCallback_(conn);
+}
+
+
+void UpstreamPool::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+    if (busy_.count(conn.get()))
+    {
+        messageCallback_(conn, buf, receiveTime);
+        return;
+    }
+    // 空闲连接收到数据：上一次的响应没有读完或上游协议出错，不能再复用
+    unsigned long unexpected = static_cast<unsigned long>(buf->readableBytes());
+    LOG_ERROR("UpstreamPool[%s] unexpected %lu bytes on idle connection %s, closing\n",
+              name_.c_str(), unexpected, conn->name().c_str());
+    buf->retrieveAll();
+    removeIdle(conn.get());
+    conn->forceClose();
+}
+
+
+// 连接关闭 (对端关闭或出错)
+void UpstreamPool::removeConnection(const TcpConnectionPtr& conn)
+{
+    removeIdle(conn.get());
+    busy_.erase(conn.get()); // 借出中的连接断开 使用者通过connected()或连接回调得知
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+
+    // 有等待者或低于最小连接数时补充连接
+    if (started_ && totalCount() < maxSize_ && (connectors_.size() < waiters_.size() || totalCount() < minSize_))
+    {
+        connectOne();
+    }
+}
+
+
+bool UpstreamPool::removeIdle(const TcpConnection* conn)
+{
+    for (auto it = idle_.begin(); it != idle_.end(); ++it)
+    {
+        if (it->conn.get() == conn)
+        {
+            idle_.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// 淘汰空闲过久的连接 补足最小连接数
+void UpstreamPool::maintain()
+{
+    Timestamp now = Timestamp::now();
+    // 队头是最久未用的连接
+    while (!idle_.empty() && totalCount() > minSize_
+           && timeDifference(now, idle_.front().since) >= idleTimeout_)
+    {
+        TcpConnectionPtr conn = idle_.front().conn;
+        idle_.pop_front();
+        ++evictions_;
+        conn->forceClose();
+    }
+
+    while (totalCount() < minSize_)
+    {
+        connectOne();
+    }
+}
+
+
+void UpstreamPool::recordWait(Timestamp enqueued)
+{
+    int64_t waited = Timestamp::now().microSecondsSinceEpoch() - enqueued.microSecondsSinceEpoch();
+    int bucket = 0;
+    while (bucket < kWaitBuckets - 1 && waited >= kWaitBucketLimits[bucket])
+    {
+        ++bucket;
+    }
+    ++waitHistogram_[bucket];
+}
+
+
+std::string UpstreamPool::statsString() const
+{
+    static const char* names[kWaitBuckets] = { "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+    char buf[512];
+    int n = snprintf(buf, sizeof buf,
+                     "pool %s -> %s: idle=%lu busy=%lu connecting=%lu waiting=%lu "
+                     "checkouts=%lu hitRate=%.2f%% waits=%lu timeouts=%lu rejected=%lu connects=%lu evictions=%lu wait:",
+                     name_.c_str(), upstream_.toIpPort().c_str(),
+                     static_cast<unsigned long>(idle_.size()), static_cast<unsigned long>(busy_.size()),
+                     static_cast<unsigned long>(connectors_.size()), static_cast<unsigned long>(waiters_.size()),
+                     static_cast<unsigned long>(checkouts_), hitRate() * 100,
+                     static_cast<unsigned long>(waits_), static_cast<unsigned long>(timeouts_),
+                     static_cast<unsigned long>(rejected_), static_cast<unsigned long>(connects_),
+                     static_cast<unsigned long>(evictions_));
+    std::string result(buf, n > 0 ? (static_cast<size_t>(n) < sizeof buf ? n : sizeof buf - 1) : 0);
+    for (int i = 0; i < kWaitBuckets; ++i)
+    {
+        n = snprintf(buf, sizeof buf, " %s=%lu", names[i], static_cast<unsigned long>(waitHistogram_[i]));
+        result.append(buf, n);
+    }
+    return result;
+}
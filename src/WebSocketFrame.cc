@@ -0,0 +1,168 @@
+#include "WebSocketFrame.h"
+
+#include <string.h>
+#include <endian.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h> // SSE2 / AVX2
+#endif
+
+namespace
+{
+// 从第i个字节开始 按8字节一个字异或到结尾，最后不足8字节的部分逐字节处理
+// i从payload开头计数且是4的倍数，8字节的key正好与之对齐
+inline void unmaskWords(unsigned char* p, size_t i, size_t n, const unsigned char* key)
+{
+    uint64_t key64;
+    ::memcpy(&key64, key, 4);
+    ::memcpy(reinterpret_cast<char*>(&key64) + 4, key, 4);
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t word;
+        ::memcpy(&word, p + i, sizeof word);
+        word ^= key64;
+        ::memcpy(p + i, &word, sizeof word);
+    }
+    for (; i < n; ++i)
+    {
+        p[i] ^= key[i & 3];
+    }
+}
+
+void unmaskScalar(char* data, size_t n, const char key[4])
+{
+    unmaskWords(reinterpret_cast<unsigned char*>(data), 0, n, reinterpret_cast<const unsigned char*>(key));
+}
+
+#if defined(__x86_64__)
+// SSE2是x86-64的基线指令集 不需要检测CPU
+void unmaskSse2(char* data, size_t n, const char key[4])
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(data);
+    int32_t key32;
+    ::memcpy(&key32, key, 4);
+    const __m128i k = _mm_set1_epi32(key32); // 按内存顺序重复 key[0..3]
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) // 每轮4个寄存器 减少循环开销
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(a, k));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 16), _mm_xor_si128(b, k));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 32), _mm_xor_si128(c, k));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 48), _mm_xor_si128(d, k));
+    }
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(a, k));
+    }
+    unmaskWords(p, i, n, reinterpret_cast<const unsigned char*>(key)); // 最后不足16字节
+}
+
+// 只有这个函数用AVX2编译 其余代码仍按基线指令集编译
+__attribute__((target("avx2")))
+void unmaskAvx2(char* data, size_t n, const char key[4])
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(data);
+    int32_t key32;
+    ::memcpy(&key32, key, 4);
+    const __m256i k = _mm256_set1_epi32(key32);
+
+    size_t i = 0;
+    for (; i + 128 <= n; i += 128)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 64));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(a, k));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i + 32), _mm256_xor_si256(b, k));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i + 64), _mm256_xor_si256(c, k));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i + 96), _mm256_xor_si256(d, k));
+    }
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(a, k));
+    }
+    if (i + 16 <= n) // 32的倍数处结束 key仍然对齐
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(a, _mm256_castsi256_si128(k)));
+        i += 16;
+    }
+    unmaskWords(p, i, n, reinterpret_cast<const unsigned char*>(key)); // 最后不足16字节
+}
+#endif
+
+using UnmaskFunc = void (*)(char*, size_t, const char*);
+
+UnmaskFunc chooseUnmask()
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return unmaskAvx2;
+    }
+    return unmaskSse2;
+#else
+    return unmaskScalar;
+#endif
+}
+
+// 运行时分派  首次调用时选定一次
+UnmaskFunc unmaskFunc()
+{
+    static const UnmaskFunc s_unmask = chooseUnmask();
+    return s_unmask;
+}
+}
+
+
+namespace WebSocketFrame
+{
+    size_t encodeHeader(char* out, Opcode opcode, size_t payloadLen)
+    {
+        out[0] = static_cast<char>(0x80 | opcode);
+        if (payloadLen <= 125)
+        {
+            out[1] = static_cast<char>(payloadLen);
+            return 2;
+        }
+        if (payloadLen <= 0xffff)
+        {
+            out[1] = 126;
+            uint16_t be16 = htobe16(static_cast<uint16_t>(payloadLen));
+            ::memcpy(out + 2, &be16, sizeof be16);
+            return 4;
+        }
+        out[1] = 127;
+        uint64_t be64 = htobe64(static_cast<uint64_t>(payloadLen));
+        ::memcpy(out + 2, &be64, sizeof be64);
+        return 10;
+    }
+
+    void unmask(char* data, size_t n, const char key[4])
+    {
+        unmaskFunc()(data, n, key);
+    }
+
+    void unmaskPortable(char* data, size_t n, const char key[4])
+    {
+        unmaskScalar(data, n, key);
+    }
+
+    const char* unmaskImplementation()
+    {
+#if defined(__x86_64__)
+        UnmaskFunc f = unmaskFunc();
+        return f == unmaskAvx2 ? "avx2" : (f == unmaskSse2 ? "sse2" : "scalar");
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,504 @@
+#include "WebSocketServer.h"
+#include "WebSocketFrame.h"
+#include "HttpContext.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+#include <endian.h>
+
+namespace
+{
+const char kAcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const size_t kKeepFragmentBytes = 64 * 1024; // 拼接缓冲超过这个容量时用完即释放
+
+inline uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+// SHA1 (FIPS 180-1)  只用于握手时计算Sec-WebSocket-Accept，输入很短，不追求速度
+void sha1(const std::string& input, unsigned char digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    // 补位: 0x80 + 若干0 + 64位大端的比特长度，凑成64字节的整数倍
+    std::string msg(input);
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56)
+    {
+        msg.push_back('\0');
+    }
+    uint64_t bits = htobe64(static_cast<uint64_t>(input.size()) * 8);
+    msg.append(reinterpret_cast<const char*>(&bits), sizeof bits);
+
+    for (size_t block = 0; block < msg.size(); block += 64)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t be32;
+            ::memcpy(&be32, msg.data() + block + i * 4, sizeof be32);
+            w[i] = be32toh(be32);
+        }
+        for (int i = 16; i < 80; ++i)
+        {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; ++i)
+    {
+        uint32_t be32 = htobe32(h[i]);
+        ::memcpy(digest + i * 4, &be32, sizeof be32);
+    }
+}
+
+std::string base64(const unsigned char* data, size_t len)
+{
+    static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t n = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < len) n |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < len) n |= data[i + 2];
+        out.push_back(kTable[(n >> 18) & 63]);
+        out.push_back(kTable[(n >> 12) & 63]);
+        out.push_back(i + 1 < len ? kTable[(n >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? kTable[n & 63] : '=');
+    }
+    return out;
+}
+
+bool equalsIgnoreCase(const StringPiece& s, const char* literal)
+{
+    size_t n = ::strlen(literal);
+    return s.size() == n && ::strncasecmp(s.data(), literal, n) == 0;
+}
+
+// Connection头是逗号分隔的列表 (如 "keep-alive, Upgrade")
+bool containsToken(const StringPiece& s, const char* token)
+{
+    size_t n = ::strlen(token);
+    for (size_t i = 0; i + n <= s.size(); ++i)
+    {
+        if (::strncasecmp(s.data() + i, token, n) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 校验升级请求并填写应答  返回true表示接受
+bool acceptHandshake(const HttpRequest& request, HttpResponse* response)
+{
+    if (request.method() != HttpRequest::kGet || request.version() != HttpRequest::kHttp11
+        || !equalsIgnoreCase(request.getHeader("Upgrade"), "websocket")
+        || !containsToken(request.getHeader("Connection"), "upgrade"))
+    {
+        response->setStatusCode(HttpResponse::k426UpgradeRequired);
+        response->addHeader("Upgrade", "websocket");
+        return false;
+    }
+    if (!(request.getHeader("Sec-WebSocket-Version") == StringPiece("13")))
+    {
+        response->setStatusCode(HttpResponse::k426UpgradeRequired);
+        response->addHeader("Sec-WebSocket-Version", "13");
+        return false;
+    }
+    StringPiece key = request.getHeader("Sec-WebSocket-Key");
+    if (key.size() != 24) // 16字节随机数的base64
+    {
+        response->setStatusCode(HttpResponse::k400BadRequest);
+        return false;
+    }
+
+    unsigned char digest[20];
+    sha1(key.as_string() + kAcceptGuid, digest);
+    response->setStatusCode(HttpResponse::k101SwitchingProtocols);
+    response->addHeader("Upgrade", "websocket");
+    response->addHeader("Sec-WebSocket-Accept", base64(digest, sizeof digest));
+    return true;
+}
+}
+
+
+WebSocketServer::Session::Session()
+    : handshake(new HttpContext(kMaxHandshakeBytes, 0))
+    , opcode(0)
+    , closing(false)
+    , active(true)
+{
+}
+
+WebSocketServer::Session::~Session() = default;
+
+
+WebSocketServer::WebSocketServer(EventLoop* loop,
+                                 const InetAddress& listenAddr,
+                                 const std::string& name,
+                                 TcpServer::Option option)
+    : maxMessageBytes_(kDefaultMaxMessageBytes)
+    , pingInterval_(0.0)
+    , zeroCopyThreshold_(0)
+    , server_(loop, listenAddr, name, option)
+{
+    server_.setConnectionCallback(std::bind(&WebSocketServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&WebSocketServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+
+void WebSocketServer::onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(std::make_shared<Session>());
+        return;
+    }
+
+    Session* session = static_cast<Session*>(conn->getContext().get());
+    if (session == nullptr)
+    {
+        return;
+    }
+    if (session->pingTimer.valid())
+    {
+        conn->getLoop()->cancel(session->pingTimer);
+    }
+    if (!session->handshake && closeCallback_)
+    {
+        closeCallback_(conn);
+    }
+}
+
+
+// 解析本次读到的所有完整帧  帧不完整时留在缓冲区等待
+void WebSocketServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+    Session* session = static_cast<Session*>(conn->getContext().get());
+    if (session == nullptr || session->closing)
+    {
+        buf->retrieveAll(); // 已经开始关闭 忽略后续数据
+        return;
+    }
+    if (session->handshake && !handshake(conn, session, buf, receiveTime))
+    {
+        return;
+    }
+
+    while (!session->closing)
+    {
+        size_t readable = buf->readableBytes();
+        if (readable < 2)
+        {
+            break;
+        }
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+        bool fin = (p[0] & 0x80) != 0;
+        int opcode = p[0] & 0x0F;
+        uint64_t length = p[1] & 0x7F;
+        size_t headerLen = 2;
+        if (length == 126)
+        {
+            if (readable < 4)
+            {
+                break;
+            }
+            uint16_t be16;
+            ::memcpy(&be16, p + 2, sizeof be16);
+            length = be16toh(be16);
+            headerLen = 4;
+        }
+        else if (length == 127)
+        {
+            if (readable < 10)
+            {
+                break;
+            }
+            uint64_t be64;
+            ::memcpy(&be64, p + 2, sizeof be64);
+            length = be64toh(be64);
+            headerLen = 10;
+        }
+
+        // 不用等payload收齐就能判断的错误
+        if ((p[0] & 0x70) != 0 || (p[1] & 0x80) == 0) // 没有协商扩展 RSV必须为0；客户端的帧必须带掩码
+        {
+            closeInLoop(conn, session, kProtocolError, "protocol error");
+            break;
+        }
+        if (WebSocketFrame::isControl(opcode) && (!fin || length > WebSocketFrame::kMaxControlPayload))
+        {
+            closeInLoop(conn, session, kProtocolError, "bad control frame");
+            break;
+        }
+        if (length > maxMessageBytes_ || (opcode == WebSocketFrame::kContinuation
+                                          && session->fragments.size() + length > maxMessageBytes_))
+        {
+            closeInLoop(conn, session, kMessageTooBig, "message too big");
+            break;
+        }
+
+        headerLen += 4; // mask key
+        if (readable < headerLen + length)
+        {
+            break;
+        }
+        char* payload = buf->mutablePeek() + headerLen;
+        WebSocketFrame::unmask(payload, static_cast<size_t>(length), buf->peek() + headerLen - 4);
+        session->active = true;
+        handleFrame(conn, session, opcode, fin, StringPiece(payload, static_cast<size_t>(length)), receiveTime);
+        buf->retrieve(headerLen + static_cast<size_t>(length)); // 切片在回调返回前一直有效
+    }
+
+    if (session->closing)
+    {
+        buf->retrieveAll();
+    }
+}
+
+
+// 握手请求完整时应答  返回true表示升级完成，缓冲区中剩下的数据按帧解析
+bool WebSocketServer::handshake(const TcpConnectionPtr& conn, Session* session, Buffer* buf, Timestamp receiveTime)
+{
+    HttpContext* context = session->handshake.get();
+    HttpContext::ParseResult result = context->parse(buf, receiveTime);
+    if (result == HttpContext::kNeedMore)
+    {
+        return false;
+    }
+
+    HttpResponse response(true);
+    if (result == HttpContext::kGotRequest && acceptHandshake(context->request(), &response))
+    {
+        StringPiece head = response.buildHead();
+        conn->sendv(&head, 1);
+        open(conn, session);
+        if (openCallback_)
+        {
+            openCallback_(conn, context->request());
+        }
+        context->finishRequest(buf);
+        session->handshake.reset();
+        return true;
+    }
+
+    if (result == HttpContext::kError)
+    {
+        response.setStatusCode(context->errorCode());
+    }
+    LOG_INFO("WebSocketServer [%s] handshake rejected\n", conn->name().c_str());
+    StringPiece head = response.buildHead();
+    conn->sendv(&head, 1);
+    session->closing = true;
+    buf->retrieveAll();
+    conn->shutdown();
+    return false;
+}
+
+
+void WebSocketServer::open(const TcpConnectionPtr& conn, Session* session)
+{
+    conn->setTcpNoDelay(true); // 推送的多是小消息 不等ACK
+    if (zeroCopyThreshold_ > 0)
+    {
+        conn->setZeroCopyThreshold(zeroCopyThreshold_);
+    }
+    if (pingInterval_ > 0)
+    {
+        std::weak_ptr<TcpConnection> weakConn(conn);
+        session->pingTimer = conn->getLoop()->runEvery(pingInterval_, [weakConn]() { onPingTimer(weakConn); });
+    }
+}
+
+
+void WebSocketServer::handleFrame(const TcpConnectionPtr& conn, Session* session, int opcode, bool fin,
+                                  const StringPiece& payload, Timestamp receiveTime)
+{
+    switch (opcode)
+    {
+    case WebSocketFrame::kText:
+    case WebSocketFrame::kBinary:
+        if (session->opcode != 0) // 上一条分片消息还没结束
+        {
+            closeInLoop(conn, session, kProtocolError, "expected continuation");
+        }
+        else if (fin)
+        {
+            if (messageCallback_)
+            {
+                messageCallback_(conn, payload, opcode == WebSocketFrame::kBinary, receiveTime);
+            }
+        }
+        else
+        {
+            session->opcode = opcode;
+            session->fragments.assign(payload.data(), payload.size());
+        }
+        break;
+
+    case WebSocketFrame::kContinuation:
+        if (session->opcode == 0)
+        {
+            closeInLoop(conn, session, kProtocolError, "unexpected continuation");
+            break;
+        }
+        session->fragments.append(payload.data(), payload.size());
+        if (fin)
+        {
+            bool binary = session->opcode == WebSocketFrame::kBinary;
+            session->opcode = 0;
+            if (messageCallback_)
+            {
+                messageCallback_(conn, session->fragments, binary, receiveTime);
+            }
+            if (session->fragments.capacity() > kKeepFragmentBytes)
+            {
+                std::string().swap(session->fragments); // 偶尔的大消息不长期占用内存
+            }
+            else
+            {
+                session->fragments.clear(); // 保留容量
+            }
+        }
+        break;
+
+    case WebSocketFrame::kPing:
+        sendFrame(conn, WebSocketFrame::kPong, payload);
+        break;
+
+    case WebSocketFrame::kPong:
+        break;
+
+    case WebSocketFrame::kClose:
+        // 回送对端的状态码后关闭  payload为 uint16状态码 + 原因 (或为空)
+        if (payload.size() == 1)
+        {
+            closeInLoop(conn, session, kProtocolError, "bad close frame");
+        }
+        else if (payload.size() >= 2)
+        {
+            uint16_t be16;
+            ::memcpy(&be16, payload.data(), sizeof be16);
+            uint16_t code = be16toh(be16);
+            // 1005/1006/1015只用于本地表示 不能出现在close帧中
+            bool valid = code >= 1000 && code != 1005 && code != 1006 && code != 1015;
+            closeInLoop(conn, session, valid ? code : static_cast<uint16_t>(kProtocolError), StringPiece());
+        }
+        else
+        {
+            closeInLoop(conn, session, kNormalClosure, StringPiece());
+        }
+        break;
+
+    default:
+        closeInLoop(conn, session, kProtocolError, "unknown opcode");
+        break;
+    }
+}
+
+
+void WebSocketServer::sendFrame(const TcpConnectionPtr& conn, int opcode, const StringPiece& payload)
+{
+    char header[WebSocketFrame::kMaxServerHeaderLen];
+    size_t headerLen = WebSocketFrame::encodeHeader(header, static_cast<WebSocketFrame::Opcode>(opcode), payload.size());
+    StringPiece pieces[2] = { StringPiece(header, headerLen), payload };
+    conn->sendv(pieces, payload.empty() ? 1 : 2);
+}
+
+
+void WebSocketServer::send(const TcpConnectionPtr& conn, const StringPiece& message, bool binary)
+{
+    sendFrame(conn, binary ? WebSocketFrame::kBinary : WebSocketFrame::kText, message);
+}
+
+
+SharedPayload WebSocketServer::makeFrame(const StringPiece& message, bool binary)
+{
+    char header[WebSocketFrame::kMaxServerHeaderLen];
+    size_t headerLen = WebSocketFrame::encodeHeader(
+        header, binary ? WebSocketFrame::kBinary : WebSocketFrame::kText, message.size());
+    std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+    frame->reserve(headerLen + message.size());
+    frame->append(header, headerLen);
+    frame->append(message.data(), message.size());
+    return frame;
+}
+
+
+void WebSocketServer::close(const TcpConnectionPtr& conn, uint16_t code, const StringPiece& reason)
+{
+    std::string reasonCopy = reason.as_string(); // 可能在其他线程中执行
+    conn->getLoop()->runInLoop([conn, code, reasonCopy]() {
+        Session* session = static_cast<Session*>(conn->getContext().get());
+        if (session != nullptr)
+        {
+            closeInLoop(conn, session, code, reasonCopy);
+        }
+    });
+}
+
+
+void WebSocketServer::closeInLoop(const TcpConnectionPtr& conn, Session* session, uint16_t code, const StringPiece& reason)
+{
+    if (session->closing)
+    {
+        return;
+    }
+    if (code == kProtocolError || code == kMessageTooBig)
+    {
+        LOG_INFO("WebSocketServer [%s] closing with %d\n", conn->name().c_str(), code);
+    }
+    session->closing = true;
+
+    char payload[WebSocketFrame::kMaxControlPayload];
+    uint16_t be16 = htobe16(code);
+    ::memcpy(payload, &be16, sizeof be16);
+    size_t reasonLen = std::min(reason.size(), sizeof payload - sizeof be16);
+    ::memcpy(payload + sizeof be16, reason.data(), reasonLen);
+    sendFrame(conn, WebSocketFrame::kClose, StringPiece(payload, sizeof be16 + reasonLen));
+    conn->shutdown(); // 输出队列发完后半关闭 等对端关闭连接
+}
+
+
+// 每个间隔检查一次：上次ping之后收到过数据就再发一个ping，否则认为对端已经失联
+void WebSocketServer::onPingTimer(const std::weak_ptr<TcpConnection>& weakConn)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (!conn || !conn->connected())
+    {
+        return;
+    }
+    Session* session = static_cast<Session*>(conn->getContext().get());
+    if (session == nullptr || session->closing)
+    {
+        return;
+    }
+    if (!session->active)
+    {
+        LOG_INFO("WebSocketServer [%s] ping timeout\n", conn->name().c_str());
+        conn->forceClose();
+        return;
+    }
+    session->active = false;
+    sendFrame(conn, WebSocketFrame::kPing, StringPiece());
+}